@@ -1,6 +1,11 @@
 /*
  * DESC: Module for block operation utilities.
  * AUTHORS: Thomas Gantz, Laura Paxton, Jan Marxen
+ *
+ * The kernels are vectorized for the instruction set detected at run time.
+ * Outputs that are written once and too large to stay in the last-level
+ * cache are written with non-temporal stores, strided quadrant reads
+ * prefetch the next row.
  */
 #include <stddef.h>
 
@@ -16,11 +21,20 @@
  * - `alpha`: Scalar to multiply elements of array `B`.
  *
  * Return:
- * Pointer to a newly allocated array containing the result of A + alpha * B.
+ * Pointer to a newly allocated array containing the result of A + alpha * B,
+ * `NULL` if memory ran out.
  */
 double *darray_add(const double *const A, const double *const B,
 		   const size_t size, const double alpha);
 
+/*
+ * Description:
+ * `darray_add` into the caller's array C (size `size`) instead of a newly
+ * allocated one.
+ */
+void darray_add_into(double *C, const double *const A, const double *const B,
+		     const size_t size, const double alpha);
+
 /*
  * Description:
  * Perform element-wise addition of two submatrices (blocks of size m/2xn/2) of
@@ -56,7 +70,8 @@ void darray_block_add(const double *const A, double *C, const size_t start1,
  * - `n`: Number of columns in A.
  *
  * Return:
- * Pointer to a newly allocated array containing the extracted block.
+ * Pointer to a newly allocated array containing the extracted block, `NULL`
+ * if memory ran out.
  *
  * Matrix format:
  * Matrices should be flattened arrays in row-major format.
@@ -64,6 +79,14 @@ void darray_block_add(const double *const A, double *C, const size_t start1,
 double *create_block(const double *const A, const size_t start, const size_t m,
 		     const size_t n);
 
+/*
+ * Description:
+ * `create_block` into the caller's array a (size m/2xn/2) instead of a newly
+ * allocated one.
+ */
+void create_block_into(double *a, const double *const A, const size_t start,
+		       const size_t m, const size_t n);
+
 /*
  * Description:
  * Perform in-place addition of two matrices (m/2xn/2) into a specified block
@@ -90,3 +113,141 @@ void mat_inplace_block_add(double *C, const double *const a,
 			   const size_t m, const size_t n, const double alpha,
 			   const double beta);
 
+/*
+ * Description:
+ * Extract an arbitrary submatrix (rows x cols) from A starting at a specified
+ * position (start).
+ *
+ * Arguments:
+ * - `A`: Pointer to the input matrix.
+ * - `start`: Starting index of the block in matrix `A`.
+ * - `rows`: Number of rows of the block.
+ * - `cols`: Number of columns of the block.
+ * - `ld`: Number of columns in A.
+ *
+ * Return:
+ * Pointer to a newly allocated array containing the extracted block, `NULL`
+ * if memory ran out.
+ *
+ * Matrix format:
+ * Matrices should be flattened arrays in row-major format.
+ */
+double *create_sub_block(const double *const A, const size_t start,
+			 const size_t rows, const size_t cols,
+			 const size_t ld);
+
+/*
+ * Description:
+ * Copy a contiguous matrix a (rows x cols) into the block of C starting at a
+ * specified position (start).
+ *
+ * Arguments:
+ * - `C`: Pointer to the output matrix.
+ * - `a`: Pointer to the block to be copied.
+ * - `start`: Starting index of the block in matrix `C`.
+ * - `rows`: Number of rows of the block.
+ * - `cols`: Number of columns of the block.
+ * - `ld`: Number of columns in C.
+ *
+ * Matrix format:
+ * Matrices should be flattened arrays in row-major format.
+ */
+void set_sub_block(double *C, const double *const a, const size_t start,
+		   const size_t rows, const size_t cols, const size_t ld);
+
+/*
+ * Description:
+ * Element-wise addition of two blocks given as strided views, scaling the
+ * second one: T = X + alpha * Y (all of size rows x cols).
+ *
+ * Arguments:
+ * - `X`, `Y`: Pointers to the first element of the input blocks.
+ * - `ldx`, `ldy`: Row strides of the input blocks.
+ * - `T`: Pointer to the first element of the output block.
+ * - `ldt`: Row stride of the output block.
+ * - `alpha`: Scalar to multiply the elements of `Y`.
+ *
+ * Matrix format:
+ * Matrices should be flattened arrays in row-major format.
+ */
+void strided_block_add(const double *const X, const size_t ldx,
+		       const double *const Y, const size_t ldy, double *T,
+		       const size_t ldt, const size_t rows, const size_t cols,
+		       const double alpha);
+
+/*
+ * Description:
+ * Accumulate a block into a strided view: C = beta * C + alpha * Q (all of
+ * size rows x cols). For beta == 0, C is only written, never read.
+ *
+ * Arguments:
+ * - `C`: Pointer to the first element of the output block.
+ * - `ldc`: Row stride of the output block.
+ * - `Q`: Pointer to the first element of the input block.
+ * - `ldq`: Row stride of the input block.
+ * - `alpha`: Scalar to multiply the elements of `Q`.
+ * - `beta`: Scalar to multiply the elements of `C`.
+ *
+ * Matrix format:
+ * Matrices should be flattened arrays in row-major format.
+ */
+void strided_block_acc(double *C, const size_t ldc, const double *const Q,
+		       const size_t ldq, const size_t rows, const size_t cols,
+		       const double alpha, const double beta);
+
+/*
+ * Description:
+ * Check whether a block (rows x cols) of A starting at a specified position
+ * (start) is zero. The scan stops at the first non-zero element, so dense
+ * blocks are usually rejected after a few elements.
+ *
+ * Arguments:
+ * - `A`: Pointer to the input matrix.
+ * - `start`: Starting index of the block in matrix `A`.
+ * - `rows`: Number of rows of the block.
+ * - `cols`: Number of columns of the block.
+ * - `ld`: Number of columns in A.
+ *
+ * Return:
+ * 1 if every element of the block is zero, 0 otherwise.
+ *
+ * Matrix format:
+ * Matrices should be flattened arrays in row-major format.
+ */
+int block_is_zero(const double *const A, const size_t start, const size_t rows,
+		  const size_t cols, const size_t ld);
+
+/*
+ * Description:
+ * Check whether a square block (size x size) of A starting at a specified
+ * position (start) is the identity. Stops at the first mismatch.
+ *
+ * Return:
+ * 1 if the block is the identity, 0 otherwise.
+ *
+ * Matrix format:
+ * Matrices should be flattened arrays in row-major format.
+ */
+int block_is_identity(const double *const A, const size_t start,
+		      const size_t size, const size_t ld);
+
+/*
+ * Description:
+ * 1-norm of A (size rows x cols), the largest sum of absolute values in a
+ * column.
+ *
+ * Return:
+ * The norm, -1 if memory ran out.
+ *
+ * Matrix format:
+ * Matrices should be flattened arrays in row-major format.
+ */
+double block_norm1(const double *const A, const size_t rows,
+		   const size_t cols);
+
+/*
+ * Description:
+ * Name of the instruction set the block kernels were dispatched to at load
+ * time ("avx2" or "generic").
+ */
+const char *block_kernel_isa(void);
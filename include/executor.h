@@ -0,0 +1,160 @@
+/*
+ * DESC: Header of module for asynchronous multiplication, inversion and solve
+ * jobs on a shared worker pool.
+ * AUTHORS: Thomas Gantz, Laura Paxton, Jan Marxen
+ *
+ * Jobs are split into tasks that run on one pool of worker threads: the seven
+ * products of the top Strassen step of a multiplication run as independent
+ * tasks and the assembly runs on the worker that finishes the last product.
+ * An inversion runs its top block step as stages: the inversions of the
+ * diagonal block and of the Schur complement are tasks, the six block
+ * products are multiplication jobs, independent ones run at the same time.
+ * Tasks of several in-flight jobs are interleaved, tasks that continue a job
+ * already in progress are queued ahead of tasks of newly submitted jobs.
+ * Plans of recently multiplied shapes are kept and shared between jobs
+ * together with a warm workspace, so repeated shapes are not planned again.
+ */
+#ifndef EXECUTOR_H
+#define EXECUTOR_H
+
+#include <stddef.h>
+
+struct strassen_executor;
+struct strassen_future;
+
+/*
+ * Completion callback of a job. It runs on a worker thread before `wait`
+ * returns for the job, `status` is 0 on success and -1 on failure.
+ */
+typedef void (*strassen_callback)(struct strassen_future *future,
+				  const int status, void *arg);
+
+/*
+ * Description:
+ * Start a worker pool.
+ *
+ * Arguments:
+ * - `num_threads`: Number of workers, 0 for one per online CPU.
+ *
+ * Return:
+ * Pointer to the executor, `NULL` if it could not be started.
+ */
+struct strassen_executor *strassen_executor_create(size_t num_threads);
+
+/*
+ * Description:
+ * Wait for all submitted jobs, stop the workers and free the executor.
+ * Futures that were not released stay valid.
+ */
+void strassen_executor_destroy(struct strassen_executor *executor);
+
+/*
+ * Description:
+ * Submit C = A*B with A (size mxn) and B (size nxk). A and B must stay
+ * valid and unchanged and C must not be accessed until the job is done.
+ *
+ * Arguments:
+ * - `callback`: Called when the job is done (can be `NULL`).
+ * - `arg`: Passed to the callback.
+ *
+ * Return:
+ * Future of the job, `NULL` if it could not be submitted. Release with
+ * `strassen_future_release`.
+ *
+ * Matrix format:
+ * Matrices should be flattened arrays in row-major format.
+ */
+struct strassen_future *strassen_submit_matmat(
+    struct strassen_executor *executor, const double *const A,
+    const double *const B, double *C, const size_t m, const size_t n,
+    const size_t k, strassen_callback callback, void *arg);
+
+/*
+ * One product of a batch: C = A*B with A (size mxn) and B (size nxk).
+ * `status` is set to 0 on success and -1 on failure once the batch is done.
+ */
+struct strassen_batch_item {
+	const double *A, *B;
+	double *C;
+	size_t m, n, k;
+	int status;
+};
+
+/*
+ * Description:
+ * Submit a batch of small independent products as one job. The items are
+ * split into one chunk per worker and every chunk runs its products back to
+ * back with the cached plans of their shapes. The items and their operands
+ * must stay valid until the job is done.
+ *
+ * Return:
+ * Future of the job, `NULL` if it could not be submitted. The job fails if
+ * any of its products failed.
+ *
+ * Matrix format:
+ * Matrices should be flattened arrays in row-major format.
+ */
+struct strassen_future *strassen_submit_batch(
+    struct strassen_executor *executor, struct strassen_batch_item *items,
+    const size_t count, strassen_callback callback, void *arg);
+
+/*
+ * Description:
+ * Submit the inversion of A (size nxn) into inverse_A with recursive block
+ * inversion and Strassen multiplication. A is not modified. Copies of the
+ * blocks of A and of the intermediate products (about 3.25 n^2 doubles) are
+ * allocated when the job is submitted.
+ *
+ * Return:
+ * Future of the job, `NULL` if it could not be submitted.
+ *
+ * Matrix format:
+ * Matrices should be flattened arrays in row-major format.
+ */
+struct strassen_future *strassen_submit_invert(
+    struct strassen_executor *executor, const double *const A,
+    double *inverse_A, const size_t n, strassen_callback callback, void *arg);
+
+/*
+ * Description:
+ * Submit the solution of A*X = B with A (size nxn) and B (size nxk) as
+ * X = A^-1 * B. The multiplication stage is queued as a continuation of the
+ * inversion stage.
+ *
+ * Return:
+ * Future of the job, `NULL` if it could not be submitted.
+ *
+ * Matrix format:
+ * Matrices should be flattened arrays in row-major format.
+ */
+struct strassen_future *strassen_submit_solve(
+    struct strassen_executor *executor, const double *const A,
+    const double *const B, double *X, const size_t n, const size_t k,
+    strassen_callback callback, void *arg);
+
+/*
+ * Description:
+ * Check whether a job is done without blocking.
+ *
+ * Return:
+ * 1 if the job is done, 0 otherwise.
+ */
+int strassen_future_done(struct strassen_future *future);
+
+/*
+ * Description:
+ * Block until a job is done.
+ *
+ * Return:
+ * 0 on success, -1 if the job failed (e.g. out of memory).
+ */
+int strassen_future_wait(struct strassen_future *future);
+
+/*
+ * Description:
+ * Give up the caller's reference to a future. The job itself is not
+ * cancelled.
+ */
+void strassen_future_release(struct strassen_future *future);
+
+#endif	// EXECUTOR_H
@@ -0,0 +1,49 @@
+/*
+ * DESC: Header of module for specialized kernels of fixed small sizes.
+ * AUTHORS: Thomas Gantz, Laura Paxton, Jan Marxen
+ *
+ * The kernels are generated by macros for the sizes 2, 4, 8 and 16. With the
+ * size known at compile time the loops are fully unrolled and a row of the
+ * result is held in registers, which removes the loop and index overhead of
+ * the generic kernels at the bottom of deep recursions.
+ */
+#ifndef FIXED_KERNELS_H
+#define FIXED_KERNELS_H
+
+#include <stddef.h>
+
+// Largest size with a specialized kernel
+#define FIXED_KERNEL_MAX 16
+
+/*
+ * Description:
+ * C = A*B + beta*C for square A, B and C (size nxn) given as strided views,
+ * beta is 0 or 1. Only sizes with a specialized kernel are handled.
+ *
+ * Arguments:
+ * - `lda`, `ldb`, `ldc`: Row strides of A, B and C.
+ *
+ * Return:
+ * 1 if a kernel for n exists and C was computed, 0 otherwise.
+ *
+ * Matrix format:
+ * Matrices should be flattened arrays in row-major format.
+ */
+int fixed_matmat(const size_t n, const double *const A, const size_t lda,
+		 const double *const B, const size_t ldb, double *C,
+		 const size_t ldc, const int beta);
+
+/*
+ * Description:
+ * Invert A (size nxn) with a specialized kernel: closed form for n <= 2,
+ * Gauss-Jordan elimination with partial pivoting otherwise.
+ *
+ * Return:
+ * 1 if a kernel for n exists and inverse_A was computed, 0 otherwise.
+ *
+ * Matrix format:
+ * Matrices should be flattened arrays in row-major format.
+ */
+int fixed_invert(const size_t n, const double *const A, double *inverse_A);
+
+#endif	// FIXED_KERNELS_H
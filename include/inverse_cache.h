@@ -0,0 +1,101 @@
+/*
+ * DESC: Header of module for an opt-in cache of matrix inverses.
+ * AUTHORS: Thomas Gantz, Laura Paxton, Jan Marxen
+ *
+ * Inputs are identified by a 128-bit fingerprint of their size and bytes, a
+ * repeated inversion or solve with the same matrix then costs one pass over
+ * A instead of a new inversion. Entries are evicted in least recently used
+ * order once their total size exceeds the byte budget of the cache. A cache
+ * can be shared by several threads.
+ */
+#ifndef INVERSE_CACHE_H
+#define INVERSE_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct inverse_cache;
+
+// 128-bit fingerprint of a matrix
+struct matrix_fingerprint {
+	uint64_t lo, hi;
+};
+
+struct inverse_cache_stats {
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+	size_t entries;
+	size_t bytes;  // held by the cached inverses
+};
+
+/*
+ * Description:
+ * Fingerprint of A (size mxn) from four independent hash lanes over its
+ * bytes, which the compiler can keep in vector registers. Matrices that
+ * differ in any bit or in shape have different fingerprints except with
+ * negligible probability.
+ *
+ * Matrix format:
+ * Matrices should be flattened arrays in row-major format.
+ */
+struct matrix_fingerprint matrix_fingerprint(const double *const A,
+					     const size_t m, const size_t n);
+
+/*
+ * Description:
+ * Create an empty cache that holds inverses of at most `byte_budget` bytes
+ * in total. Larger inverses are computed but not cached.
+ *
+ * Return:
+ * Pointer to the cache, `NULL` if allocation failed. Free with
+ * `inverse_cache_destroy`.
+ */
+struct inverse_cache *inverse_cache_create(const size_t byte_budget);
+
+/*
+ * Description:
+ * Free the cache and all cached inverses.
+ */
+void inverse_cache_destroy(struct inverse_cache *cache);
+
+/*
+ * Description:
+ * Write A^-1 (A size nxn) into inverse_A, from the cache if A was seen
+ * before and with `strassen_invert` otherwise, which then caches it.
+ * Inverses with NaN or Inf entries, e.g. of singular matrices, are not
+ * cached.
+ *
+ * Return:
+ * 0 on success, -1 if the inverse is not finite or memory ran out.
+ *
+ * Matrix format:
+ * Matrices should be flattened arrays in row-major format.
+ */
+int inverse_cache_invert(struct inverse_cache *cache, const double *const A,
+			 double *inverse_A, const size_t n);
+
+/*
+ * Description:
+ * Solve A*X = B for A (size nxn) and B (size nxk) as X = A^-1 * B, where
+ * A^-1 is taken from or added to the cache as in `inverse_cache_invert`.
+ * New right-hand sides for a cached A cost one O(n^2 k) product.
+ *
+ * Return:
+ * 0 on success, -1 if A could not be inverted or memory ran out.
+ *
+ * Matrix format:
+ * Matrices should be flattened arrays in row-major format.
+ */
+int inverse_cache_solve(struct inverse_cache *cache, const double *const A,
+			const double *const B, double *X, const size_t n,
+			const size_t k);
+
+/*
+ * Description:
+ * Hit, miss and eviction counts since the cache was created and its current
+ * size.
+ */
+struct inverse_cache_stats inverse_cache_stats(struct inverse_cache *cache);
+
+#endif	// INVERSE_CACHE_H
@@ -0,0 +1,28 @@
+/*
+ * DESC: Header of the by-products of an inversion.
+ * AUTHORS: Thomas Gantz, Laura Paxton, Jan Marxen
+ *
+ * The factorizations behind an inversion already hold the determinant:
+ * the product of the pivots for LU, the product of the determinants of the
+ * leading blocks and Schur complements for block inversion. Given the
+ * inverse, the 1-norm condition number costs two O(n^2) passes.
+ */
+#ifndef INVERSE_INFO_H
+#define INVERSE_INFO_H
+
+/*
+ * By-products of inverting A (size nxn), det(A) = det_sign *
+ * exp(log_abs_det).
+ * - `det_sign`: Sign of det(A), 0 if a pivot vanished.
+ * - `log_abs_det`: log|det(A)|, kept as a logarithm so that it neither
+ *   overflows nor underflows for large n. -INFINITY if a pivot vanished.
+ * - `cond1`: Condition number ||A||_1 * ||A^-1||_1 from the computed
+ *   inverse.
+ */
+struct inverse_info {
+	int det_sign;
+	double log_abs_det;
+	double cond1;
+};
+
+#endif	// INVERSE_INFO_H
@@ -0,0 +1,82 @@
+/*
+ * DESC: Header of module for reproducible random test matrices.
+ * AUTHORS: Thomas Gantz, Laura Paxton, Jan Marxen
+ *
+ * Entries come from a counter-based generator: entry i of the stream `seed`
+ * is a hash of seed and i, so the entries are computed independently of
+ * each other, in vector registers and on any number of threads, and the
+ * output for a seed is the same for every thread count.
+ */
+#ifndef MATRIX_GEN_H
+#define MATRIX_GEN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Description:
+ * Fill A with `count` entries uniform in [-1, 1).
+ *
+ * Arguments:
+ * - `seed`: Stream of the entries, equal seeds give equal matrices.
+ * - `threads`: Number of threads, 0 for one per online CPU. Small matrices
+ *   are filled on the calling thread.
+ */
+void gen_uniform(double *A, const size_t count, const uint64_t seed,
+		 const size_t threads);
+
+/*
+ * Description:
+ * Fill A with `count` uniform 64-bit words, the raw stream behind
+ * `gen_uniform`, for integer and modular test data.
+ *
+ * Arguments:
+ * - `seed`, `threads`: As for `gen_uniform`.
+ */
+void gen_bits(uint64_t *A, const size_t count, const uint64_t seed,
+	      const size_t threads);
+
+/*
+ * Description:
+ * Fill A (size nxn) with uniform entries and add n + 1 to its diagonal.
+ * A is strictly diagonally dominant, so it is invertible and its condition
+ * number stays small for every n.
+ *
+ * Matrix format:
+ * Matrices should be flattened arrays in row-major format.
+ */
+void gen_well_conditioned(double *A, const size_t n, const uint64_t seed,
+			  const size_t threads);
+
+/*
+ * Description:
+ * Fill A (size nxn) with a symmetric positive definite matrix: symmetric
+ * uniform entries off the diagonal and |u| + n on it. Costs O(n^2) instead
+ * of the O(n^3) of forming G*G^T.
+ *
+ * Matrix format:
+ * Matrices should be flattened arrays in row-major format.
+ */
+void gen_spd(double *A, const size_t n, const uint64_t seed,
+	     const size_t threads);
+
+/*
+ * Description:
+ * Fill A (size nxn) with H1 * D * H2, where H1 and H2 are random Householder
+ * reflections and D is diagonal with entries from 1 down to 1/cond in
+ * geometric progression. The singular values of A are those of D, so its
+ * 2-norm condition number is `cond`. Costs O(n^2).
+ *
+ * Arguments:
+ * - `cond`: Condition number, at least 1.
+ *
+ * Return:
+ * 0 on success, -1 if memory ran out.
+ *
+ * Matrix format:
+ * Matrices should be flattened arrays in row-major format.
+ */
+int gen_conditioned(double *A, const size_t n, const double cond,
+		    const uint64_t seed, const size_t threads);
+
+#endif	// MATRIX_GEN_H
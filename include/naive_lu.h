@@ -5,6 +5,8 @@
 
 #include <stddef.h>
 
+#include "inverse_info.h"
+
 /*
  * Description:
  * Decompose T (size nxn) with naive LU decomposition, store LU inplace
@@ -26,3 +28,28 @@ void lu_decomposition(const double *const A, double *T, const size_t n);
  */
 void lu_invert(const double *const A, double *inverse_A, const size_t n);
 
+/*
+ * Description:
+ * `lu_invert` that also returns the determinant of A, the product of the
+ * pivots of its LU decomposition, and its 1-norm condition number.
+ *
+ * Matrix format:
+ * Matrices should be flattened arrays in row-major format.
+ */
+void lu_invert_info(const double *const A, double *inverse_A, const size_t n,
+		    struct inverse_info *info);
+
+/*
+ * Description:
+ * Invert S (size kxk) in place by Gauss-Jordan elimination with partial
+ * pivoting. Meant for the small systems of low-rank updates and the leaves
+ * of block inversions.
+ *
+ * Return:
+ * 0 on success, -1 if a pivot vanishes relative to the largest entry of S
+ * (then S is undefined) or memory ran out.
+ *
+ * Matrix format:
+ * Matrices should be flattened arrays in row-major format.
+ */
+int gauss_jordan_invert(double *S, const size_t k);
@@ -0,0 +1,90 @@
+/*
+ * DESC: Header of module for hardware performance counters around benchmarked
+ * calls.
+ * AUTHORS: Thomas Gantz, Laura Paxton, Jan Marxen
+ *
+ * The counters are opened with perf_event_open (Linux) for the whole process.
+ * Threads started afterwards, e.g. the workers of an executor, are counted as
+ * well once they have exited. Only user space is counted, which works with
+ * the default perf_event_paranoid setting. Counters the CPU or hypervisor does
+ * not provide are reported as invalid, the others still work.
+ */
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <stdint.h>
+
+enum perf_counter {
+	PERF_CYCLES,
+	PERF_INSTRUCTIONS,
+	PERF_L1D_MISSES,   // L1 data cache read misses
+	PERF_LLC_MISSES,   // last-level cache misses
+	PERF_DTLB_MISSES,  // data TLB read misses
+	PERF_NUM_COUNTERS
+};
+
+// Bytes moved from memory per last-level cache miss
+#define PERF_LINE_BYTES 64
+
+// Counter deltas of one measured region
+struct perf_sample {
+	uint64_t values[PERF_NUM_COUNTERS];
+	int valid[PERF_NUM_COUNTERS];
+	double seconds;	 // wall time of the region
+};
+
+// Metrics derived from a sample, -1 where a needed counter is invalid
+struct perf_metrics {
+	double ipc;		      // instructions per cycle
+	double bytes;		      // LLC misses * PERF_LINE_BYTES
+	double bandwidth;	      // bytes per second
+	double flops_per_byte;	      // arithmetic intensity against memory
+	double l1d_misses_per_flop;
+	double llc_misses_per_flop;
+	double dtlb_misses_per_flop;
+};
+
+/*
+ * Description:
+ * Open the counters. Without a successful call, `perf_begin` and `perf_end`
+ * only measure time.
+ *
+ * Return:
+ * 0 if at least the cycle counter could be opened, -1 otherwise.
+ */
+int perf_open(void);
+
+/*
+ * Description:
+ * Close the counters opened by `perf_open`.
+ */
+void perf_close(void);
+
+/*
+ * Description:
+ * Start a measured region. Regions must not be nested.
+ */
+void perf_begin(void);
+
+/*
+ * Description:
+ * End the region started by `perf_begin` and store its sample, which is
+ * returned by `perf_last` until the next region ends.
+ */
+void perf_end(void);
+
+/*
+ * Description:
+ * Sample of the last region.
+ */
+const struct perf_sample *perf_last(void);
+
+/*
+ * Description:
+ * Derive rates from a sample of a region that performed `flops` floating
+ * point operations.
+ */
+struct perf_metrics perf_derive(const struct perf_sample *sample,
+				const double flops);
+
+#endif	// PERF_COUNTERS_H
@@ -0,0 +1,110 @@
+/*
+ * DESC: Header of module for per-recursion-level instrumentation.
+ * AUTHORS: Thomas Gantz, Laura Paxton, Jan Marxen
+ *
+ * The instrumentation is compiled in only if STRASSEN_PROFILE is defined
+ * (cmake -DSTRASSEN_PROFILE=ON). Otherwise all PROF_* macros expand to
+ * nothing and the recursive routines carry no overhead.
+ */
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Phases of the recursive algorithms that are timed separately
+enum prof_phase {
+	PROF_CALL,   // whole recursive call (inclusive time)
+	PROF_COPY,   // extraction of blocks into contiguous memory
+	PROF_ADD,    // block additions and assembly of the result
+	PROF_LEAF,   // multiplication/inversion at the bottom of recursion
+	PROF_ALLOC,  // allocation of temporary blocks
+	PROF_NUM_PHASES
+};
+
+// Deepest recursion level that gets its own row in the summary
+#define PROF_MAX_LEVELS 32
+
+#ifdef STRASSEN_PROFILE
+
+/*
+ * Description:
+ * Current time of a monotonic clock in nanoseconds.
+ */
+uint64_t prof_now(void);
+
+/*
+ * Description:
+ * Record one finished phase at the current recursion level of the calling
+ * thread.
+ *
+ * Arguments:
+ * - `phase`: Phase that was executed.
+ * - `start`: Time stamp from `prof_now` taken before the phase.
+ * - `bytes`: Number of bytes read and written by the phase.
+ */
+void prof_record(const enum prof_phase phase, const uint64_t start,
+		 const size_t bytes);
+
+/*
+ * Description:
+ * Enter a recursive call: increments the recursion level of the calling
+ * thread.
+ *
+ * Return:
+ * Time stamp to be passed to `prof_leave`.
+ */
+uint64_t prof_enter(void);
+
+/*
+ * Description:
+ * Leave a recursive call entered with `prof_enter` and record it as a node of
+ * the recursion tree.
+ *
+ * Arguments:
+ * - `name`: Name of the routine (string literal, not copied).
+ * - `start`: Time stamp returned by `prof_enter`.
+ * - `m`, `n`, `k`: Problem dimensions shown in the trace.
+ */
+void prof_leave(const char *name, const uint64_t start, const size_t m,
+		const size_t n, const size_t k);
+
+/*
+ * Description:
+ * Clear all recorded statistics and trace events.
+ */
+void prof_reset(void);
+
+/*
+ * Description:
+ * Print a table with time, calls, bytes moved and achieved bandwidth per
+ * recursion level and phase.
+ */
+void prof_print_summary(FILE *out);
+
+/*
+ * Description:
+ * Write all recorded events as Chrome/Perfetto trace JSON. Calls appear as
+ * nested slices (the recursion tree), one track per thread.
+ *
+ * Return:
+ * 0 on success, -1 if the file could not be written.
+ */
+int prof_export_chrome_trace(const char *path);
+
+#define PROF_BEGIN(var) const uint64_t var = prof_now()
+#define PROF_END(var, phase, bytes) prof_record((phase), (var), (bytes))
+#define PROF_ENTER(var) const uint64_t var = prof_enter()
+#define PROF_LEAVE(var, name, m, n, k) prof_leave((name), (var), (m), (n), (k))
+
+#else
+
+#define PROF_BEGIN(var)
+#define PROF_END(var, phase, bytes)
+#define PROF_ENTER(var)
+#define PROF_LEAVE(var, name, m, n, k)
+
+#endif	// STRASSEN_PROFILE
+
+#endif	// PROFILE_H
@@ -0,0 +1,51 @@
+/*
+ * DESC: Header of the protocol between the matrix service and its clients.
+ * AUTHORS: Thomas Gantz, Laura Paxton, Jan Marxen
+ *
+ * Clients talk to `strassen_server` over a Unix domain socket of type
+ * SOCK_SEQPACKET, one request or response per packet. Operands are not sent
+ * over the socket: a client attaches a shared memory segment once by passing
+ * its file descriptor, and every request names its matrices by byte offsets
+ * into that segment. Results are written into the segment in place. A
+ * request whose output overlaps one of its inputs fails with status -1.
+ */
+#ifndef SERVICE_H
+#define SERVICE_H
+
+#include <stdint.h>
+
+// Socket the server listens on unless another path is given
+#define SERVICE_SOCKET_PATH "/tmp/strassen.sock"
+
+enum service_op {
+	// Attach the segment passed with SCM_RIGHTS, its size in bytes is m
+	SERVICE_ATTACH,
+	// C = A*B, A (size mxn) at a, B (size nxk) at b, C at c
+	SERVICE_MATMAT,
+	// C = A^-1, A (size nxn) at a
+	SERVICE_INVERT,
+	// C = A^-1 * B, A (size nxn) at a, B (size nxk) at b
+	SERVICE_SOLVE,
+	// Latency and throughput statistics of the server
+	SERVICE_STATS
+};
+
+struct service_request {
+	uint32_t op;  // enum service_op
+	uint32_t id;  // echoed in the response
+	uint64_t m, n, k;
+	uint64_t a, b, c;  // byte offsets into the attached segment
+};
+
+struct service_response {
+	uint32_t id;
+	int32_t status;	 // 0 on success, -1 on failure
+	// Filled for SERVICE_STATS only, latencies in seconds
+	uint64_t count;
+	double p50, p99;
+	// Recent answers per second of busy time, i.e. time in which at
+	// least one of them was in flight
+	double throughput;
+};
+
+#endif	// SERVICE_H
@@ -0,0 +1,66 @@
+/*
+ * DESC: Header of module for matrix chain products and matrix powers.
+ * AUTHORS: Thomas Gantz, Laura Paxton, Jan Marxen
+ *
+ * The order of a chain is chosen by dynamic programming over the cost model
+ * of the shape-aware Strassen recursion. All products of a chain or power are
+ * planned up front and run in one shared workspace, no operand is padded or
+ * modified.
+ */
+#ifndef STRASSEN_CHAIN_H
+#define STRASSEN_CHAIN_H
+
+#include <stddef.h>
+
+/*
+ * Description:
+ * Choose the cheapest order for the product M_0 * M_1 * ... * M_{count-1}
+ * where M_i has size dims[i] x dims[i+1].
+ *
+ * Arguments:
+ * - `dims`: count + 1 dimensions.
+ * - `count`: Number of matrices in the chain.
+ * - `split`: count*count entries or `NULL`. For i < j, the subchain i..j is
+ *   computed as (M_i..M_s) * (M_{s+1}..M_j) with s = split[i * count + j].
+ *
+ * Return:
+ * Estimated cost of the chosen order in multiply-adds, -1 if memory ran out.
+ */
+double strassen_chain_order(const size_t *const dims, const size_t count,
+			    size_t *split);
+
+/*
+ * Description:
+ * Compute result = M_0 * M_1 * ... * M_{count-1} in the order chosen by
+ * `strassen_chain_order`.
+ *
+ * Arguments:
+ * - `mats`: The count matrices, M_i of size dims[i] x dims[i+1].
+ * - `dims`: count + 1 dimensions.
+ * - `result`: Output of size dims[0] x dims[count].
+ *
+ * Return:
+ * 0 on success, -1 if count is 0 or memory ran out.
+ *
+ * Matrix format:
+ * Matrices should be flattened arrays in row-major format.
+ */
+int strassen_chain(const double *const *mats, const size_t *const dims,
+		   const size_t count, double *result);
+
+/*
+ * Description:
+ * Compute result = A^e for A (size nxn) by repeated squaring, which takes
+ * about log2(e) squarings plus one product per set bit of e. Every product
+ * runs with the same plan and workspace.
+ *
+ * Return:
+ * 0 on success, -1 if memory ran out.
+ *
+ * Matrix format:
+ * Matrices should be flattened arrays in row-major format.
+ */
+int strassen_power(const double *const A, double *result, const size_t n,
+		   unsigned long e);
+
+#endif	// STRASSEN_CHAIN_H
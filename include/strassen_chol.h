@@ -0,0 +1,74 @@
+/*
+ * DESC: Header of module for recursive Cholesky factorization and inversion of
+ * symmetric positive definite matrices and for symmetric products.
+ * AUTHORS: Thomas Gantz, Laura Paxton, Jan Marxen
+ *
+ * Only the lower triangle of the input and of every symmetric intermediate is
+ * read or formed. Off-diagonal blocks and Schur complements are computed with
+ * the planned Strassen multiplication, blocks are split unevenly so that no
+ * padding is needed.
+ */
+#ifndef STRASSEN_CHOL_H
+#define STRASSEN_CHOL_H
+
+#include <stddef.h>
+
+// Below this size the recursion uses unblocked kernels
+#define SPD_LEAF_SIZE 64
+
+/*
+ * Description:
+ * Compute the Cholesky factor L (lower triangular, A = L*L^T) of a symmetric
+ * positive definite A (size nxn) with a recursive block algorithm. Only the
+ * lower triangle of A is read, the upper triangle of L is set to zero.
+ *
+ * Return:
+ * 0 on success, -1 if A is not positive definite or memory ran out.
+ *
+ * Matrix format:
+ * Matrices should be flattened arrays in row-major format.
+ */
+int strassen_cholesky(const double *const A, double *L, const size_t n);
+
+/*
+ * Description:
+ * Invert a symmetric positive definite A (size nxn). The recursion inverts
+ * the leading block, forms the Schur complement A22 - A21*A11^-1*A21^T (lower
+ * triangle only) and inverts it, which needs about half the work of the
+ * general block inversion. Leaves are inverted through their Cholesky
+ * factor. Only the lower triangle of A is read, inverse_A is returned with
+ * both triangles.
+ *
+ * Return:
+ * 0 on success, -1 if A is not positive definite or memory ran out.
+ *
+ * Matrix format:
+ * Matrices should be flattened arrays in row-major format.
+ */
+int strassen_invert_spd(const double *const A, double *inverse_A,
+			const size_t n);
+
+// Product formed by `strassen_syrk`
+enum strassen_syrk_op {
+	SYRK_A_AT,  // C = A*A^T for A of size nxk
+	SYRK_AT_A   // C = A^T*A for A of size kxn
+};
+
+/*
+ * Description:
+ * Compute the lower triangle of the symmetric product C (size nxn) of A with
+ * its transpose. Diagonal blocks recurse symmetrically and only the
+ * off-diagonal blocks use the planned Strassen multiplication, so about
+ * half of the work and of the writes of a general product remain. The
+ * strict upper triangle of C is not written.
+ *
+ * Return:
+ * 0 on success, -1 if memory ran out.
+ *
+ * Matrix format:
+ * Matrices should be flattened arrays in row-major format.
+ */
+int strassen_syrk(const double *const A, double *C, const size_t n,
+		  const size_t k, const enum strassen_syrk_op op);
+
+#endif	// STRASSEN_CHOL_H
@@ -0,0 +1,62 @@
+/*
+ * DESC: Header of module for complex matrix multiplication and inversion.
+ * AUTHORS: Thomas Gantz, Laura Paxton, Jan Marxen
+ *
+ * Complex matrices are stored as two real planes, the real parts and the
+ * imaginary parts, each a flattened row-major array. A complex product
+ * takes three real products with the 3M method (Gauss' trick)
+ *   Re(A*B) = Ar*Br - Ai*Bi,
+ *   Im(A*B) = (Ar + Ai)*(Br + Bi) - Ar*Br - Ai*Bi,
+ * instead of four, and each of them runs through one Strassen plan. The
+ * imaginary part loses a little accuracy when |Ar*Br| and |Ai*Bi| are much
+ * larger than the result.
+ */
+#ifndef STRASSEN_COMPLEX_H
+#define STRASSEN_COMPLEX_H
+
+#include <stddef.h>
+
+/*
+ * Description:
+ * Compute C = A*B for complex A (size mxn) and B (size nxk) in split
+ * format, with three real products. The inputs are not modified.
+ *
+ * Arguments:
+ * - `Ar`, `Ai`: Real and imaginary planes of A.
+ * - `Br`, `Bi`: Real and imaginary planes of B.
+ * - `Cr`, `Ci`: Real and imaginary planes of the output (size mxk), must
+ *   not overlap the inputs.
+ *
+ * Return:
+ * 0 on success, -1 if memory ran out.
+ *
+ * Matrix format:
+ * Matrices should be flattened arrays in row-major format.
+ */
+int strassen_zmatmat(const double *const Ar, const double *const Ai,
+		     const double *const Br, const double *const Bi,
+		     double *Cr, double *Ci, const size_t m, const size_t n,
+		     const size_t k);
+
+/*
+ * Description:
+ * Invert complex A (size nxn) in split format using recursive block
+ * inversion, whose products are complex 3M products. Small blocks are
+ * inverted by Gauss-Jordan elimination with partial pivoting. Like the
+ * real block inversion, the leading blocks and Schur complements must be
+ * invertible.
+ *
+ * Arguments:
+ * - `Ar`, `Ai`: Real and imaginary planes of A, not modified.
+ * - `Xr`, `Xi`: Real and imaginary planes of A^-1 (size nxn).
+ *
+ * Return:
+ * 0 on success, -1 if a pivot vanished or memory ran out.
+ *
+ * Matrix format:
+ * Matrices should be flattened arrays in row-major format.
+ */
+int strassen_zinvert(const double *const Ar, const double *const Ai,
+		     double *Xr, double *Xi, const size_t n);
+
+#endif	// STRASSEN_COMPLEX_H
@@ -0,0 +1,76 @@
+/*
+ * DESC: Header of module for exact integer and modular Strassen arithmetic.
+ * AUTHORS: Thomas Gantz, Laura Paxton, Jan Marxen
+ *
+ * Without rounding errors every multiplication saved by Strassen's algorithm
+ * is pure gain, so these variants recurse down to EXACT_LEAF_SIZE regardless
+ * of conditioning. Modular products are accumulated in 64 bits and reduced
+ * only when the next product could overflow. The leaf kernels are compiled
+ * for several instruction sets and dispatched at load time.
+ */
+#ifndef STRASSEN_EXACT_H
+#define STRASSEN_EXACT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Dimension below which the leaf kernels are used
+#define EXACT_LEAF_SIZE 64
+
+// Largest supported modulus, entries and products then fit 32 and 64 bits
+#define EXACT_MOD_MAX ((uint64_t)1 << 32)
+
+/*
+ * Description:
+ * C = A*B for int64 matrices A (size mxn) and B (size nxk). The arithmetic
+ * wraps modulo 2^64, so C is exact whenever the true product fits int64.
+ *
+ * Return:
+ * 0 on success, -1 if memory ran out.
+ *
+ * Matrix format:
+ * Matrices should be flattened arrays in row-major format.
+ */
+int strassen_matmat_i64(const int64_t *const A, const int64_t *const B,
+			int64_t *C, const size_t m, const size_t n,
+			const size_t k);
+
+/*
+ * Description:
+ * C = A*B mod p for A (size mxn) and B (size nxk) with entries in [0, p).
+ *
+ * Arguments:
+ * - `p`: Modulus, 2 <= p <= EXACT_MOD_MAX. Need not be prime.
+ *
+ * Return:
+ * 0 on success, -1 if p is out of range or memory ran out.
+ *
+ * Matrix format:
+ * Matrices should be flattened arrays in row-major format.
+ */
+int strassen_matmat_mod(const uint64_t *const A, const uint64_t *const B,
+			uint64_t *C, const size_t m, const size_t n,
+			const size_t k, const uint64_t p);
+
+/*
+ * Description:
+ * Invert A (size nxn, entries in [0, p)) modulo a prime p with the block
+ * recursion of `strassen_invert_strassen_matmat`: the leading block and its
+ * Schur complement are inverted recursively, the products use
+ * `strassen_matmat_mod`. If a leading block is singular although A is not,
+ * the inverse is computed by Gauss-Jordan elimination with pivoting instead.
+ *
+ * Arguments:
+ * - `p`: Prime modulus, 2 <= p <= EXACT_MOD_MAX.
+ *
+ * Return:
+ * 0 on success, -1 if A is singular modulo p, p is out of range or memory
+ * ran out.
+ *
+ * Matrix format:
+ * Matrices should be flattened arrays in row-major format.
+ */
+int strassen_invert_mod(const uint64_t *const A, uint64_t *inverse_A,
+			const size_t n, const uint64_t p);
+
+#endif	// STRASSEN_EXACT_H
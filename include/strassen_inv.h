@@ -5,22 +5,86 @@
 
 #include <stddef.h>
 
+#include "inverse_info.h"
+#include "strassen_matmat.h"  // for struct strassen_memory
+
 /*
  * Description:
- * Invert A (size nxn) using recursive block inversion and strassen
- * multiplication.
+ * Invert A (size nxn) using recursive block inversion and the planned
+ * Strassen multiplication. Odd sizes are split into blocks of floor(n/2) and
+ * ceil(n/2) instead of being padded, A is not modified. Products with a zero
+ * off-diagonal block are skipped.
+ *
+ * Return:
+ * 0 on success, -1 if memory ran out, then inverse_A is undefined.
  *
  * Matrix format:
  * Matrices should be flattened arrays in row-major format.
  */
-void strassen_invert_naive_matmat(double **A, double **inverse_A, size_t n);
+int strassen_invert(const double *const A, double *inverse_A,
+		    const size_t n);
+
+/*
+ * Description:
+ * `strassen_invert` that also returns the determinant and the 1-norm
+ * condition number of A. The determinant is collected from the leaves of
+ * the recursion, the leading blocks and Schur complements, so no second
+ * factorization is needed.
+ *
+ * Return:
+ * 0 on success, -1 if memory ran out, then inverse_A and info are
+ * undefined.
+ *
+ * Matrix format:
+ * Matrices should be flattened arrays in row-major format.
+ */
+int strassen_invert_info(const double *const A, double *inverse_A,
+			 const size_t n, struct inverse_info *info);
+
+/*
+ * Description:
+ * `strassen_invert` within a memory budget. Blocks are freed as soon as the
+ * recursion no longer needs them and the peak of the whole recursion is
+ * estimated before anything is allocated, for the most Strassen levels
+ * first and then for fewer, down to classical products. The first schedule
+ * whose estimate fits `memory->budget` is run. Small sizes go to the
+ * fixed-size kernels and need no scratch memory.
+ *
+ * Return:
+ * 0 on success, -1 if not even the classical schedule fits the budget, then
+ * nothing is computed and `memory->estimate` holds the smallest estimate,
+ * or if an allocation failed anyway.
+ *
+ * Matrix format:
+ * Matrices should be flattened arrays in row-major format.
+ */
+int strassen_invert_budget(const double *const A, double *inverse_A,
+			   const size_t n, struct strassen_memory *memory);
 
 /*
  * Description:
  * Invert A (size nxn) using recursive block inversion and naive
- * multiplication.
+ * multiplication. Same splitting as `strassen_invert`, the pointers are
+ * left unchanged.
+ *
+ * Return:
+ * 0 on success, -1 if memory ran out.
+ *
+ * Matrix format:
+ * Matrices should be flattened arrays in row-major format.
+ */
+int strassen_invert_naive_matmat(double **A, double **inverse_A, size_t n);
+
+/*
+ * Description:
+ * Invert A (size nxn) using recursive block inversion and strassen
+ * multiplication. Same as `strassen_invert`, the pointers are left
+ * unchanged.
+ *
+ * Return:
+ * 0 on success, -1 if memory ran out.
  *
  * Matrix format:
  * Matrices should be flattened arrays in row-major format.
  */
-void strassen_invert_strassen_matmat(double **A, double **inverse_A, size_t n);
+int strassen_invert_strassen_matmat(double **A, double **inverse_A, size_t n);
@@ -2,16 +2,71 @@
  * DESC: Header of module for strassen matrix multiplication.
  * AUTHORS: Thomas Gantz, Laura Paxton, Jan Marxen
  */
+#ifndef STRASSEN_MATMAT_H
+#define STRASSEN_MATMAT_H
 
 #include <stddef.h>  // for size_t
 
+// Below this size in every dimension the naive multiplication is used
+#define STRASSEN_LEAF_SIZE 512
+
+// Steps the shape-aware recursion can take for a product of size mxn * nxk
+enum strassen_step {
+	STEP_LEAF,	// naive multiplication
+	STEP_GEMV,	// k == 1: matrix times vector
+	STEP_GEVM,	// m == 1: vector times matrix
+	STEP_OUTER,	// n == 1: outer product
+	STEP_SPLIT_M,	// classic split of the rows of A and C
+	STEP_SPLIT_N,	// classic split of the inner dimension
+	STEP_SPLIT_K,	// classic split of the columns of B and C
+	STEP_STRASSEN	// one level of Strassen's algorithm
+};
+
+/*
+ * Memory contract of the budgeted entry points, all sizes in bytes.
+ * - `budget`: Limit for the scratch memory of the call, 0 for no limit.
+ * - `estimate`: Set to the peak of the chosen schedule, computed before
+ *   anything is allocated. It is an upper bound for `peak`.
+ * - `peak`: Set to the high-water mark of scratch memory actually held.
+ * - `levels`: Set to the Strassen levels of the chosen schedule, with the
+ *   meaning of `max_levels` in `struct strassen_plan_options`.
+ */
+struct strassen_memory {
+	size_t budget;
+	size_t estimate;
+	size_t peak;
+	int levels;
+};
+
+/*
+ * Description:
+ * Choose the next recursion step for a product of A (size mxn) with B (size
+ * nxk). Degenerate shapes use vector kernels, products below leaf_size in
+ * every dimension the naive leaf, elongated shapes are split classically
+ * along their largest dimension until they are near-square and a Strassen
+ * step is only taken where its saved multiplication outweighs the additional
+ * block additions.
+ */
+enum strassen_step strassen_choose_step(const size_t m, const size_t n,
+					const size_t k, const size_t leaf_size);
+
+/*
+ * Description:
+ * Estimated cost of the product of A (size mxn) with B (size nxk) along the
+ * steps chosen by `strassen_choose_step`, in multiply-adds. Block additions
+ * are weighted with the same factor the step selection uses.
+ */
+double strassen_matmat_cost(const size_t m, const size_t n, const size_t k,
+			    const size_t leaf_size);
+
 /*
  * Description:
  * Multiply A (size mxn) with B (size nxk) using Strassen's multiplication
  * algorithm, store the result in C (size mxk).
  * Notes:
- * A, B & C: data doesn't change but memory location changes.
- * m, n, k change throughout but are the same at the end of recursion.
+ * A & B are only read and none of the pointers is changed, odd sizes are
+ * peeled instead of padded. The pointers of pointers remain for the legacy
+ * interface.
  *
  * Matrix format:
  * Matrices should be flattened arrays in row-major format and pointer of
@@ -20,3 +75,41 @@
 void strassen_matmat(double **A, double **B, double **C, size_t m, size_t n,
 		     size_t k);
 
+/*
+ * Description:
+ * Multiply A (size mxn) with B (size nxk) into C (size mxk) like
+ * `strassen_matmat`, but A and B are only read, never padded or moved, and
+ * all scratch memory belongs to the call. Any number of threads can use the
+ * same A and B at once, e.g. a read-only mapping of a shared operand, as
+ * long as each writes its own C.
+ *
+ * Return:
+ * 0 on success, -1 if memory ran out.
+ *
+ * Matrix format:
+ * Matrices should be flattened arrays in row-major format.
+ */
+int strassen_matmat_r(const double *const A, const double *const B,
+		      double *C, const size_t m, const size_t n,
+		      const size_t k);
+
+/*
+ * Description:
+ * `strassen_matmat_r` within a memory budget: the planner gives up Strassen
+ * levels until the plan, its nodes and its workspace fit `memory->budget`.
+ * The plan is held as a whole for the product, so the measured peak is the
+ * size of what was allocated and equals the estimate.
+ *
+ * Return:
+ * 0 on success, -1 if memory ran out or not even the classical plan fits
+ * the budget, then nothing is computed and `memory->estimate` holds its
+ * size.
+ *
+ * Matrix format:
+ * Matrices should be flattened arrays in row-major format.
+ */
+int strassen_matmat_budget(const double *const A, const double *const B,
+			   double *C, const size_t m, const size_t n,
+			   const size_t k, struct strassen_memory *memory);
+
+#endif	// STRASSEN_MATMAT_H
@@ -0,0 +1,280 @@
+/*
+ * DESC: Header of module for reusable execution plans of Strassen
+ * multiplication.
+ * AUTHORS: Thomas Gantz, Laura Paxton, Jan Marxen
+ *
+ * A plan fixes every decision of the shape-aware recursion for one problem
+ * size: the step taken at each node, the leaf kernels and the layout of a
+ * single workspace. Executing a plan allocates nothing and takes no
+ * decisions. Odd dimensions are handled by peeling the last row/column
+ * instead of padding, so the inputs are never copied or modified.
+ */
+#ifndef STRASSEN_PLAN_H
+#define STRASSEN_PLAN_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include "strassen_matmat.h"
+
+/*
+ * Options of the planner, zero-initialized options select the defaults.
+ * - `leaf_size`: Naive multiplication below this size in every dimension
+ *   (0: STRASSEN_LEAF_SIZE).
+ * - `max_levels`: Maximal number of nested Strassen steps, 0 for no limit and
+ *   negative for none. Products that would need more are split classically.
+ * - `external_workspace`: If set, no workspace is allocated and the plan can
+ *   only be run with `strassen_execute_ws`.
+ * - `memory_budget`: Maximal bytes of the plan with its nodes and workspace
+ *   (see `strassen_plan_bytes`), 0 for no limit. Strassen levels are given
+ *   up until the plan fits; `max_levels` of the plan holds the number that
+ *   remained. A plan without Strassen levels is returned even if it does
+ *   not fit.
+ */
+struct strassen_plan_options {
+	size_t leaf_size;
+	int max_levels;
+	int external_workspace;
+	size_t memory_budget;
+};
+
+/*
+ * One node of the recursion. Nodes of equal shape are shared, the children of
+ * a Strassen step are all the same node.
+ * - `step`: Step taken for this product.
+ * - `m`, `n`, `k`: Size of the product (mxn * nxk).
+ * - `child`: Indices of the child nodes, -1 if unused. Split steps use both,
+ *   Strassen steps only the first.
+ * - `workspace`: Number of doubles of workspace needed by the subtree.
+ */
+struct strassen_plan_node {
+	enum strassen_step step;
+	size_t m, n, k;
+	int child[2];
+	size_t workspace;
+};
+
+/*
+ * Execution plan for a product of size mxn * nxk, nodes[0] is the root.
+ */
+struct strassen_plan {
+	size_t m, n, k;
+	struct strassen_plan_options options;
+	size_t num_nodes;
+	struct strassen_plan_node *nodes;
+	size_t workspace_size;	// in doubles
+	double *workspace;	// owned by the plan, NULL if external
+};
+
+/*
+ * Description:
+ * Create an execution plan for the product of A (size mxn) with B (size nxk)
+ * and allocate its workspace.
+ *
+ * Arguments:
+ * - `options`: Planner options, `NULL` for the defaults.
+ *
+ * Return:
+ * Pointer to the plan, `NULL` if allocation failed. Free with
+ * `strassen_plan_destroy`.
+ */
+struct strassen_plan *strassen_plan(
+    const size_t m, const size_t n, const size_t k,
+    const struct strassen_plan_options *options);
+
+/*
+ * Description:
+ * Free a plan and its workspace.
+ */
+void strassen_plan_destroy(struct strassen_plan *plan);
+
+/*
+ * Description:
+ * Bytes held by a plan: the plan itself, its nodes and its workspace, which
+ * is counted even if it is external.
+ */
+size_t strassen_plan_bytes(const struct strassen_plan *plan);
+
+/*
+ * Description:
+ * Compute C = A*B as described by the plan, using the plan's workspace.
+ * Two threads must not execute the same plan at the same time with this
+ * function, see `strassen_execute_ws`.
+ *
+ * Matrix format:
+ * Matrices should be flattened arrays in row-major format.
+ */
+void strassen_execute(const struct strassen_plan *plan, const double *const A,
+		      const double *const B, double *C);
+
+/*
+ * Description:
+ * Compute C = A*B as described by the plan, using a caller provided
+ * workspace of at least `plan->workspace_size` doubles.
+ *
+ * Matrix format:
+ * Matrices should be flattened arrays in row-major format.
+ */
+void strassen_execute_ws(const struct strassen_plan *plan,
+			 const double *const A, const double *const B,
+			 double *C, double *workspace);
+
+/*
+ * Left operand prepared for one plan: a copy of A and every sum of A blocks
+ * the recursion forms (such as d - a, b - d and c - a at each Strassen
+ * step), packed in the order the execution uses them.
+ * - `plan`: Plan the operand was prepared for, not owned.
+ * - `packed_size`: Number of doubles of packed sums. Strassen level l
+ *   (l = 0 at the top) of a square-ish plan packs 5 sums for each of its
+ *   7^l products, (5/4) * m*n * (7/4)^l doubles, so L levels take
+ *   (5/3) * m*n * ((7/4)^L - 1). K splits with halves of equal shape store
+ *   their sums once.
+ */
+struct strassen_prepared {
+	const struct strassen_plan *plan;
+	double *A;
+	double *packed;
+	size_t packed_size;
+};
+
+/*
+ * Description:
+ * Prepare A (size mxn of the plan) for products with many right operands.
+ * A can be freed afterwards, the plan must outlive the prepared operand.
+ *
+ * Return:
+ * Pointer to the prepared operand, `NULL` if allocation failed. Free with
+ * `strassen_prepared_destroy`.
+ */
+struct strassen_prepared *strassen_prepare_a(
+    const struct strassen_plan *plan, const double *const A);
+
+/*
+ * Description:
+ * Free a prepared operand.
+ */
+void strassen_prepared_destroy(struct strassen_prepared *prep);
+
+/*
+ * Description:
+ * Compute C = A*B for the prepared A. Only the sums of B blocks and the
+ * products are computed, the A side is read from the packed sums. Uses the
+ * plan's workspace like `strassen_execute`, `strassen_execute_prepared_ws`
+ * takes a caller provided one.
+ *
+ * Matrix format:
+ * Matrices should be flattened arrays in row-major format.
+ */
+void strassen_execute_prepared(const struct strassen_prepared *prep,
+			       const double *const B, double *C);
+
+void strassen_execute_prepared_ws(const struct strassen_prepared *prep,
+				  const double *const B, double *C,
+				  double *workspace);
+
+// Number of half-size products of one Strassen step
+#define STRASSEN_PRODUCTS 7
+
+/*
+ * Description:
+ * Workspace in doubles needed by `strassen_execute_product` for the Strassen
+ * node `idx` of a plan.
+ */
+size_t strassen_product_workspace(const struct strassen_plan *plan,
+				  const int idx);
+
+/*
+ * Description:
+ * Compute product p (0 <= p < STRASSEN_PRODUCTS) of the Strassen node `idx`
+ * of a plan into Q (size m/2 x k/2 of the node). Together with
+ * `strassen_execute_assemble` this lets the products of one step run
+ * concurrently, each with its own workspace.
+ *
+ * Arguments:
+ * - `A`, `B`: Operands of the node as strided views (row strides lda, ldb).
+ * - `Q`: Contiguous output of the product.
+ * - `ws`: Workspace of `strassen_product_workspace(plan, idx)` doubles.
+ *
+ * Matrix format:
+ * Matrices should be flattened arrays in row-major format.
+ */
+void strassen_execute_product(const struct strassen_plan *plan,
+			      const int idx, const int p,
+			      const double *const A, const size_t lda,
+			      const double *const B, const size_t ldb,
+			      double *Q, double *ws);
+
+/*
+ * Description:
+ * Combine the STRASSEN_PRODUCTS products of the Strassen node `idx` into
+ * C = A*B + beta*C (beta is 0 or 1), including the peeled odd rows/columns.
+ *
+ * Matrix format:
+ * Matrices should be flattened arrays in row-major format.
+ */
+void strassen_execute_assemble(const struct strassen_plan *plan,
+			       const int idx, const double *const *Q,
+			       const double *const A, const size_t lda,
+			       const double *const B, const size_t ldb,
+			       double *C, const size_t ldc, const int beta);
+
+/*
+ * Description:
+ * A-priori bound of the error of a product with inner dimension n and
+ * `levels` Strassen steps above classically multiplied leaves (Higham):
+ *   max|C - fl(A*B)| <= bound * max|A| * max|B|.
+ * With 0 levels this is the classical bound n^2 u, every level multiplies
+ * the leading term by 3.
+ */
+double strassen_error_bound(const size_t n, const int levels);
+
+/*
+ * Description:
+ * Choose the number of Strassen levels (at most `max_levels`) for the
+ * product of A (size mxn) with B (size nxk) such that the bound of
+ * `strassen_error_bound` stays below tolerance * max|A*B|. max|A*B| is
+ * estimated from below with one random matrix-vector product, O(mn + nk).
+ *
+ * Return:
+ * Number of levels, 0 if only classical multiplication meets the target.
+ */
+int strassen_accuracy_levels(const double *const A, const double *const B,
+			     const size_t m, const size_t n, const size_t k,
+			     const double tolerance, const int max_levels);
+
+/*
+ * Description:
+ * Compute C = A*B with the most Strassen levels that still meet a relative
+ * error target, max|C - A*B| <= tolerance * max|A*B|, according to
+ * `strassen_accuracy_levels`. Deeper products are split classically.
+ *
+ * Return:
+ * Number of Strassen levels used, -1 if memory ran out.
+ *
+ * Matrix format:
+ * Matrices should be flattened arrays in row-major format.
+ */
+int strassen_matmat_tol(const double *const A, const double *const B,
+			double *C, const size_t m, const size_t n,
+			const size_t k, const double tolerance);
+
+/*
+ * Description:
+ * Write a plan in a line based text format.
+ *
+ * Return:
+ * 0 on success, -1 on a write error.
+ */
+int strassen_plan_save(const struct strassen_plan *plan, FILE *file);
+
+/*
+ * Description:
+ * Read a plan written by `strassen_plan_save`, check that it is consistent
+ * and allocate its workspace.
+ *
+ * Return:
+ * Pointer to the plan, `NULL` if the input is malformed.
+ */
+struct strassen_plan *strassen_plan_load(FILE *file);
+
+#endif	// STRASSEN_PLAN_H
@@ -0,0 +1,65 @@
+/*
+ * DESC: Header of module for low-rank updates of an inverse.
+ * AUTHORS: Thomas Gantz, Laura Paxton, Jan Marxen
+ *
+ * When a matrix changes by a rank-k correction or grows by k rows and
+ * columns, its inverse is updated from the old one with the
+ * Sherman-Morrison-Woodbury identity or block bordering instead of being
+ * recomputed. Every large product has an inner or outer dimension k, so an
+ * update costs O(n^2 k) with the planned Strassen multiplication, only a
+ * kxk system is inverted directly.
+ */
+#ifndef STRASSEN_UPDATE_H
+#define STRASSEN_UPDATE_H
+
+#include <stddef.h>
+
+/*
+ * Description:
+ * Replace inverse_A = A^-1 by (A + U*V)^-1 with the Woodbury identity
+ *   (A + U*V)^-1 = A^-1 - A^-1*U * (I + V*A^-1*U)^-1 * V*A^-1.
+ *
+ * Arguments:
+ * - `inverse_A`: Inverse of A (size nxn), updated in place.
+ * - `U`: Left factor of the update (size nxk).
+ * - `V`: Right factor of the update (size kxn).
+ *
+ * Return:
+ * 0 on success, -1 if A + U*V is singular (within working precision) or
+ * memory ran out. On failure inverse_A is left unchanged.
+ *
+ * Matrix format:
+ * Matrices should be flattened arrays in row-major format.
+ */
+int strassen_update_inverse(double *inverse_A, const double *const U,
+			    const double *const V, const size_t n,
+			    const size_t k);
+
+/*
+ * Description:
+ * Compute the inverse of the bordered matrix
+ *   [ A  B ]
+ *   [ C  D ]
+ * from inverse_A = A^-1 through the Schur complement S = D - C*A^-1*B:
+ *   [ A^-1 + X*S^-1*Y   -X*S^-1 ]
+ *   [ -S^-1*Y            S^-1   ]   with X = A^-1*B, Y = C*A^-1.
+ *
+ * Arguments:
+ * - `inverse_A`: Inverse of A (size nxn).
+ * - `B`, `C`, `D`: New columns (size nxk), rows (size kxn) and corner (size
+ *   kxk).
+ * - `inverse_out`: Output of size (n+k)x(n+k), must not overlap inverse_A.
+ *
+ * Return:
+ * 0 on success, -1 if the bordered matrix is singular (within working
+ * precision) or memory ran out.
+ *
+ * Matrix format:
+ * Matrices should be flattened arrays in row-major format.
+ */
+int strassen_border_inverse(const double *const inverse_A,
+			    const double *const B, const double *const C,
+			    const double *const D, double *inverse_out,
+			    const size_t n, const size_t k);
+
+#endif	// STRASSEN_UPDATE_H
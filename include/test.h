@@ -4,6 +4,17 @@
  */
 
 #include <stddef.h>
+#include <stdint.h>
+
+#include "verify.h"
+
+/*
+ * Description:
+ * Select how the test functions validate results: recompute them with
+ * CBLAS/LAPACK (`VERIFY_REFERENCE`, default) or check them in O(n^2) with
+ * Freivalds' algorithm (`VERIFY_FREIVALDS`).
+ */
+void set_verify_mode(const enum verify_mode mode);
 
 /*
  * Description:
@@ -27,7 +38,8 @@ int compare_mat(const double *const A, const double *const B, const size_t m,
 
 /*
  * Description:
- * Generate a random double matrix with values [-1,1].
+ * Generate a random double matrix with values [-1,1) from the next stream
+ * of the test seed, on all CPUs for large matrices.
  *
  * Arguments:
  * - `A`: Pointer to the array where the generated matrix will be stored.
@@ -39,6 +51,24 @@ int compare_mat(const double *const A, const double *const B, const size_t m,
  */
 void gen_rand_matrix(double *A, const size_t m, const size_t n);
 
+/*
+ * Description:
+ * Seed the test matrices of the run. Every generated matrix takes the next
+ * stream after the seed, so a run repeats with the same seed.
+ */
+void set_test_seed(const uint64_t seed);
+
+/*
+ * Description:
+ * Generate a dense invertible matrix (size nxn): uniform entries in [-1,1)
+ * from the next stream of the test seed plus 2*sqrt(n) on the diagonal, so
+ * no trial factorizations are needed.
+ *
+ * Matrix format:
+ * Matrices should be flattened arrays in row-major format.
+ */
+void gen_invertible_matrix(double *A, const size_t n);
+
 /*
  * Description:
  * Call naive_matmat implementation and time, also compare to CBLAS to assert
@@ -67,6 +97,161 @@ double test_naive_matmat(double **A, double **B, const size_t m, const size_t n,
 double test_strassen_matmat(double **A, double **B, const size_t m,
 			    const size_t n, const size_t k, const double eps);
 
+/*
+ * Description:
+ * Compute the lower triangle of A*A^T for A (size mxn) with the Strassen
+ * SYRK and validate it, and untimed also A^T*A, against CBLAS.
+ *
+ * Return:
+ * time in seconds of A*A^T. If -1, wrong result.
+ *
+ * Matrix format:
+ * Matrices should be flattened arrays in row-major format.
+ */
+double test_strassen_syrk(const double *const A, const size_t m,
+			  const size_t n, const double eps);
+
+/*
+ * Description:
+ * Prepare A (size mxn) once and multiply it with `count` random right
+ * operands (size nxk) through `strassen_execute_prepared`, validate every
+ * product.
+ *
+ * Return:
+ * Time in seconds per product. If -1, wrong result.
+ */
+double test_strassen_prepared(const double *const A, const size_t m,
+			      const size_t n, const size_t k,
+			      const size_t count, const double eps);
+
+/*
+ * Description:
+ * Multiply A (size mxn) with B (size nxk) with as many Strassen levels as
+ * the relative error target allows and check max|C - A*B| <= tolerance *
+ * max|A*B| against CBLAS.
+ *
+ * Return:
+ * time in seconds. If -1, wrong result or the target was missed.
+ *
+ * Matrix format:
+ * Matrices should be flattened arrays in row-major format.
+ */
+double test_strassen_matmat_tol(const double *const A, const double *const B,
+				const size_t m, const size_t n, const size_t k,
+				const double tolerance);
+
+/*
+ * Description:
+ * Multiply read-only copies of A (size mxn) and B (size nxk) from `threads`
+ * threads at once with the reentrant `strassen_matmat_r` and validate every
+ * result.
+ *
+ * Return:
+ * Wall time in seconds for all threads. If -1, wrong result.
+ *
+ * Matrix format:
+ * Matrices should be flattened arrays in row-major format.
+ */
+double test_strassen_matmat_r(const double *const A, const double *const B,
+			      const size_t m, const size_t n, const size_t k,
+			      const size_t threads, const double eps);
+
+/*
+ * Description:
+ * Plan a Strassen multiplication outside of the timing, then time the
+ * execution of the plan and validate the result.
+ *
+ * Return:
+ * time in seconds. If -1, wrong result.
+ *
+ * Matrix format:
+ * Matrices should be flattened arrays in row-major format.
+ */
+double test_strassen_execute(const double *const A, const double *const B,
+			     const size_t m, const size_t n, const size_t k,
+			     const double eps);
+
+/*
+ * Description:
+ * Compute the chain A * B * B^T * A^T (A size mxn, B size nxk) with the chain
+ * engine and compare it to (A*B) * (A*B)^T from CBLAS. The tolerance is
+ * scaled with n*k, the magnitude of the entries.
+ *
+ * Return:
+ * time in seconds. If -1, wrong result.
+ *
+ * Matrix format:
+ * Matrices should be flattened arrays in row-major format.
+ */
+double test_strassen_chain(const double *const A, const double *const B,
+			   const size_t m, const size_t n, const size_t k,
+			   const double eps);
+
+/*
+ * Description:
+ * Multiply random int64 matrices (sizes mxn and nxk) with the exact Strassen
+ * variant and compare the result bit by bit with a naive product.
+ *
+ * Return:
+ * time in seconds. If -1, wrong result.
+ */
+double test_strassen_matmat_i64(const size_t m, const size_t n,
+				const size_t k);
+
+/*
+ * Description:
+ * Multiply random matrices (sizes mxn and nxk) modulo p with the exact
+ * Strassen variant and compare the result bit by bit with a naive product.
+ *
+ * Return:
+ * time in seconds. If -1, wrong result.
+ */
+double test_strassen_matmat_mod(const size_t m, const size_t n, const size_t k,
+				const uint64_t p);
+
+/*
+ * Description:
+ * Compute (A / sqrt(n))^e (A size nxn) by repeated squaring and compare it to
+ * e successive CBLAS multiplications.
+ *
+ * Return:
+ * time in seconds. If -1, wrong result.
+ *
+ * Matrix format:
+ * Matrices should be flattened arrays in row-major format.
+ */
+double test_strassen_power(const double *const A, const size_t n,
+			   const unsigned long e, const double eps);
+
+/*
+ * Description:
+ * Submit `jobs` multiplications of A (size mxn) with B (size nxk) to one
+ * executor at once, wait for all of them and validate every result.
+ *
+ * Return:
+ * Wall clock time in seconds for all jobs. If -1, wrong result.
+ *
+ * Matrix format:
+ * Matrices should be flattened arrays in row-major format.
+ */
+double test_executor_matmat(const double *const A, const double *const B,
+			    const size_t m, const size_t n, const size_t k,
+			    const size_t jobs, const double eps);
+
+/*
+ * Description:
+ * Solve A*X = B (A size nxn, B size nxk) with an asynchronous solve job and
+ * validate A*X against B.
+ *
+ * Return:
+ * Wall clock time in seconds. If -1, wrong result.
+ *
+ * Matrix format:
+ * Matrices should be flattened arrays in row-major format.
+ */
+double test_executor_solve(const double *const A, const double *const B,
+			   const size_t n, const size_t k, const double eps);
+
 /*
  * Description:
  * Check if a square matrix is invertible using LAPACK's LU inversion function.
@@ -103,6 +288,117 @@ int is_invertible(double *A, int n);
 double test_strassen_invert_strassen_matmat(double **A, const size_t n,
 					    const double eps);
 
+/*
+ * Description:
+ * Test the Strassen inversion on a random lower triangular matrix (size nxn),
+ * where the zero blocks let the recursion skip most products. Compares the
+ * result to LAPACK's output to validate correctness.
+ *
+ * Return:
+ * Time in seconds. If -1, wrong result.
+ */
+double test_strassen_invert_triangular(const size_t n, const double eps);
+
+/*
+ * Description:
+ * Test the SPD inversion on a random symmetric positive definite matrix
+ * (size nxn). Compares the result to LAPACK's output to validate correctness.
+ *
+ * Return:
+ * Time in seconds. If -1, wrong result.
+ */
+double test_strassen_invert_spd(const size_t n, const double eps);
+
+/*
+ * Description:
+ * Invert a random matrix (size nxn) modulo the prime p and check A*X == I
+ * exactly with a naive modular product.
+ *
+ * Return:
+ * Time in seconds. If -1, wrong result or A singular modulo p.
+ */
+double test_strassen_invert_mod(const size_t n, const uint64_t p);
+
+/*
+ * Description:
+ * Update the inverse of a random matrix A (size nxn) to the inverse of
+ * A + U*V for random U (size nxk) and V (size kxn) and validate it.
+ *
+ * Return:
+ * Time in seconds of the update. If -1, wrong result.
+ */
+double test_strassen_update_inverse(const size_t n, const size_t k,
+				    const double eps);
+
+/*
+ * Description:
+ * Extend the inverse of a random matrix A (size nxn) to the inverse of A
+ * bordered by k random rows and columns and validate it.
+ *
+ * Return:
+ * Time in seconds of the extension. If -1, wrong result.
+ */
+double test_strassen_border_inverse(const size_t n, const size_t k,
+				    const double eps);
+
+/*
+ * Description:
+ * Invert and solve with three random matrices (size nxn) through an inverse
+ * cache that holds two of them, validate the results and the hit, miss and
+ * eviction counts.
+ *
+ * Return:
+ * Time in seconds of an inversion served from the cache. If -1, wrong
+ * result or wrong statistics.
+ */
+double test_inverse_cache(const size_t n, const double eps);
+
+/*
+ * Description:
+ * Invert a random matrix (size nxn) within the smallest scratch memory
+ * possible and multiply with half of the unlimited plan (at least the
+ * classical one), validate the results and that the measured peak stays
+ * below the estimate and the estimate below the budget.
+ *
+ * Return:
+ * Time in seconds of the budgeted inversion. If -1, wrong result or budget
+ * exceeded.
+ */
+double test_strassen_budget(const size_t n, const double eps);
+
+/*
+ * Description:
+ * Generate a random matrix (size nxn) with the counter-based generator and
+ * validate that every generator gives the same output on one and on several
+ * threads, that the SPD matrix has a Cholesky factor and that the
+ * conditioned matrix has the requested singular values.
+ *
+ * Return:
+ * Time in seconds of the generation. If -1, wrong result.
+ */
+double test_gen_matrix(const size_t n);
+
+/*
+ * Description:
+ * Multiply random complex A (size mxn) and B (size nxk) in split format
+ * with `strassen_zmatmat` and compare to CBLAS's zgemm.
+ *
+ * Return:
+ * Time in seconds of the product. If -1, wrong result.
+ */
+double test_strassen_zmatmat(const size_t m, const size_t n, const size_t k,
+			     const double eps);
+
+/*
+ * Description:
+ * Invert a random complex matrix (size nxn) in split format with
+ * `strassen_zinvert` and check that A times the inverse is the identity.
+ *
+ * Return:
+ * Time in seconds of the inversion. If -1, wrong result.
+ */
+double test_strassen_zinvert(const size_t n, const double eps);
+
 /*
  * Description:
  * Test the naive block inversion algorithm implementation.
@@ -123,6 +419,18 @@ double test_strassen_invert_strassen_matmat(double **A, const size_t n,
 double test_strassen_invert_naive_matmat(double **A, const size_t n,
 					 const double eps);
 
+/*
+ * Description:
+ * Invert A (size nxn) with `strassen_invert_info` and `lu_invert_info` and
+ * compare the determinants and condition numbers to LAPACK's
+ * factorization.
+ *
+ * Return:
+ * Time in seconds of `strassen_invert_info`. If -1, wrong result.
+ */
+double test_strassen_invert_info(const double *const A, const size_t n,
+				 const double eps);
+
 /*
  * Description:
  * Test the implementation of LU decomposition inversion of a matrix.
@@ -0,0 +1,88 @@
+/*
+ * DESC: Header of module for randomized O(n^2) result verification.
+ * AUTHORS: Thomas Gantz, Laura Paxton, Jan Marxen
+ */
+#ifndef VERIFY_H
+#define VERIFY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// How results are validated: against a CBLAS/LAPACK reference or randomized
+enum verify_mode { VERIFY_REFERENCE, VERIFY_FREIVALDS };
+
+// Number of rounds used by default, i.e. a false pass probability of 2^-20
+#define FREIVALDS_ROUNDS 20
+
+// Default tolerance of `freivalds_matmat` in units of n*u, with room for
+// the error growth of a few Strassen levels
+#define FREIVALDS_MATMAT_TOL 64.0
+
+/*
+ * Outcome of a Freivalds check.
+ * - `residual`: Largest relative residual over all rounds.
+ * - `error_bound`: Upper bound on the probability that a wrong result passes
+ *   all rounds (2^-rounds).
+ * - `rounds`: Number of random projections that were checked.
+ * - `passed`: 1 if every residual was below the tolerance, 0 otherwise.
+ */
+struct verify_report {
+	double residual;
+	double error_bound;
+	int rounds;
+	int passed;
+};
+
+/*
+ * Description:
+ * Check C = A*B (A size mxn, B size nxk, C size mxk) with Freivalds' algorithm:
+ * for random x with entries +-1, compare A*(B*x) against C*x. Each round costs
+ * O(mn + nk + mk). If C is wrong, a single round misses the error with
+ * probability at most 1/2.
+ *
+ * Every row is compared on its own against the rounding error of its inner
+ * products, so a single wrong entry fails the check however large the rest
+ * of the product is.
+ *
+ * Arguments:
+ * - `rounds`: Number of independent random vectors.
+ * - `eps`: Tolerance for the componentwise residual, in units of n*u
+ *   (u the unit roundoff):
+ *   max_i |A*(B*x) - C*x|_i / (n * u * (|A|*|B|*|x|)_i).
+ * - `seed`: Seed of the random vectors, rand() is not used.
+ * - `report`: Filled with the outcome (can be `NULL`).
+ *
+ * Return:
+ * 1 if the check passed, 0 otherwise.
+ *
+ * Matrix format:
+ * Matrices should be flattened arrays in row-major format.
+ */
+int freivalds_matmat(const double *const A, const double *const B,
+		     const double *const C, const size_t m, const size_t n,
+		     const size_t k, const int rounds, const double eps,
+		     uint64_t seed, struct verify_report *report);
+
+/*
+ * Description:
+ * Check that inverse_A is the inverse of A (size nxn) by comparing
+ * A*(inverse_A*x) against x for random x with entries +-1. Each round costs
+ * O(n^2).
+ *
+ * Arguments:
+ * - `rounds`: Number of independent random vectors.
+ * - `eps`: Tolerance for the relative residual ||A*(inverse_A*x) - x|| / ||x||.
+ * - `seed`: Seed of the random vectors, rand() is not used.
+ * - `report`: Filled with the outcome (can be `NULL`).
+ *
+ * Return:
+ * 1 if the check passed, 0 otherwise.
+ *
+ * Matrix format:
+ * Matrices should be flattened arrays in row-major format.
+ */
+int freivalds_invert(const double *const A, const double *const inverse_A,
+		     const size_t n, const int rounds, const double eps,
+		     uint64_t seed, struct verify_report *report);
+
+#endif	// VERIFY_H
@@ -0,0 +1,404 @@
+/*
+ * DESC: Microbenchmark and roofline report for the block utility kernels.
+ * AUTHORS: Thomas Gantz, Laura Paxton, Jan Marxen
+ *
+ * Usage: ./bench_block_utilities [max block size] [--threshold=<fraction>]
+ *
+ * Every kernel of block_utilities.c is timed for block sizes from 64 to
+ * DRAM-resident, writing into preallocated and already touched outputs.
+ * The achieved bandwidth is compared to the peak of the memory level the
+ * blocks fit in, measured once per level: a STREAM-style triad for kernels
+ * with a separate output, an in-place update for the in-place kernels.
+ * Kernels below the given fraction of it (default 0.5) are flagged and
+ * make the run fail.
+ */
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../include/block_utilities.h"
+
+// The reference loops get an AVX2 clone like the kernels they are compared
+// with, selected at load time on capable CPUs
+#if defined(__GNUC__) && defined(__x86_64__)
+#define SIMD_CLONES __attribute__((target_clones("avx2", "default")))
+#else
+#define SIMD_CLONES
+#endif
+
+// Smallest block, below it the per-row calls of the block kernels cost
+// more than their memory traffic
+#define MIN_BLOCK 64
+// Minimal accumulated run time per measurement in seconds
+#define MIN_TIME 0.05
+// Number of repetitions over which the best time is taken
+#define NTIMES 5
+
+enum kernel {
+	K_DARRAY_ADD,
+	K_DARRAY_BLOCK_ADD,
+	K_CREATE_BLOCK,
+	K_INPLACE_ADD_ONE,
+	K_INPLACE_ADD_TWO,
+	K_STREAM_TRIAD,
+	K_STREAM_UPDATE,
+	NUM_KERNELS
+};
+
+#define NUM_REFERENCES (NUM_KERNELS - K_STREAM_TRIAD)
+
+static const char *const kernel_names[NUM_KERNELS] = {
+    "darray_add",	  "darray_block_add",	  "create_block",
+    "mat_inplace_add(a)", "mat_inplace_add(a,b)", "stream_triad",
+    "stream_update"};
+
+// Memory levels with the footprint that still fits them, the last level is
+// main memory
+enum level { L1, L2, L3, DRAM, NUM_LEVELS };
+
+static const char *const level_names[NUM_LEVELS] = {"L1", "L2", "L3",
+						      "DRAM"};
+
+// Gap between the vectors in doubles, 17 cache lines, so that equal
+// indices of x, y and z do not alias in the 4 KB page offset
+#define VECTOR_GAP 136
+
+// Buffers shared by all kernels for one block size (block is s x s, the
+// matrix the blocks are taken from is 2s x 2s)
+struct bench_data {
+	size_t s;
+	double *M;  // 2s x 2s
+	double *x;  // s x s
+	double *y;  // s x s
+	double *z;  // s x s, output of the kernels that do not write M or x
+	double *vectors;  // holds x, y and z
+};
+
+// Array of `count` doubles aligned to cache lines, so that the results do
+// not depend on where malloc places the buffers
+static double *alloc_lines(const size_t count) {
+	const size_t bytes = (count * sizeof(double) + 63) / 64 * 64;
+	return aligned_alloc(64, bytes);
+}
+
+// Allocate and touch the buffers, M is only needed by the block kernels
+static int bench_alloc(struct bench_data *d, const size_t s, const int with_m) {
+	*d = (struct bench_data){.s = s};
+	if (with_m) d->M = alloc_lines(4 * s * s);
+	d->vectors = alloc_lines(3 * s * s + 2 * VECTOR_GAP);
+	if ((with_m && d->M == NULL) || d->vectors == NULL) return -1;
+	d->x = d->vectors;
+	d->y = d->x + s * s + VECTOR_GAP;
+	d->z = d->y + s * s + VECTOR_GAP;
+	if (with_m)
+		for (size_t i = 0; i < 4 * s * s; i++)
+			d->M[i] = 1.0 / (double)(i + 1);
+	for (size_t i = 0; i < s * s; i++) {
+		d->x[i] = 1.0;
+		d->y[i] = 2.0;
+		d->z[i] = 0.0;
+	}
+	return 0;
+}
+
+static void bench_free(struct bench_data *d) {
+	free(d->M);
+	free(d->vectors);
+}
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + 1e-9 * (double)ts.tv_nsec;
+}
+
+// Bytes read plus written by one call (STREAM convention, no write-allocate)
+static double kernel_bytes(const enum kernel kern, const size_t s) {
+	const double block = (double)s * s * sizeof(double);
+	switch (kern) {
+		case K_CREATE_BLOCK:
+			return 2 * block;
+		case K_INPLACE_ADD_TWO:
+			return 4 * block;
+		default:
+			return 3 * block;
+	}
+}
+
+// Memory spanned by one call: the blocks it touches, for the quadrant
+// kernels the rows of the matrix between the first and last quadrant row,
+// which share cache sets with the quadrants
+static double kernel_footprint(const enum kernel kern, const size_t s) {
+	const double block = (double)s * s * sizeof(double);
+	switch (kern) {
+		case K_DARRAY_BLOCK_ADD:
+			return 5 * block;
+		case K_INPLACE_ADD_TWO:
+			return 4 * block;
+		default:
+			return 3 * block;
+	}
+}
+
+// Floating point operations of one call
+static double kernel_flops(const enum kernel kern, const size_t s) {
+	const double block = (double)s * s;
+	switch (kern) {
+		case K_CREATE_BLOCK:
+			return 0;
+		case K_INPLACE_ADD_TWO:
+			return 4 * block;
+		default:
+			return 2 * block;
+	}
+}
+
+// Contiguous reference: z = x + alpha*y, the write of z also reads it into
+// the cache
+SIMD_CLONES static void stream_triad(double *restrict z,
+				     const double *restrict x,
+				     const double *restrict y,
+				     const size_t size) {
+	for (size_t i = 0; i < size; i++) z[i] = x[i] + 3.0 * y[i];
+}
+
+// Contiguous in-place reference: z = z + alpha*x, all traffic is counted,
+// like for the in-place kernels
+SIMD_CLONES static void stream_update(double *restrict z,
+				      const double *restrict x,
+				      const size_t size) {
+	for (size_t i = 0; i < size; i++) z[i] += 3.0 * x[i];
+}
+
+static void run_kernel(const enum kernel kern, struct bench_data *d) {
+	const size_t s = d->s;
+	switch (kern) {
+		case K_DARRAY_ADD:
+			darray_add_into(d->z, d->x, d->y, s * s, -1.0);
+			break;
+		case K_DARRAY_BLOCK_ADD:
+			darray_block_add(d->M, d->x, s, 2 * s * s + s, 2 * s,
+					 2 * s, -1.0);
+			break;
+		case K_CREATE_BLOCK:
+			create_block_into(d->z, d->M, 2 * s * s + s, 2 * s,
+					  2 * s);
+			break;
+		case K_INPLACE_ADD_ONE:
+			mat_inplace_block_add(d->M, d->x, NULL, s, 2 * s,
+					      2 * s, 1.0, 0.0);
+			break;
+		case K_INPLACE_ADD_TWO:
+			mat_inplace_block_add(d->M, d->x, d->y, s, 2 * s,
+					      2 * s, 1.0, -1.0);
+			break;
+		case K_STREAM_TRIAD:
+			stream_triad(d->z, d->x, d->y, s * s);
+			// Keep the compiler from merging repetitions
+			__asm__ volatile("" : : : "memory");
+			break;
+		case K_STREAM_UPDATE:
+			stream_update(d->z, d->x, s * s);
+			__asm__ volatile("" : : : "memory");
+			break;
+		default:
+			break;
+	}
+}
+
+// Best time of one call over NTIMES measurements of at least MIN_TIME
+static double time_kernel(const enum kernel kern, struct bench_data *d) {
+	// Warm up and find a repetition count that takes long enough
+	size_t reps = 1;
+	for (;;) {
+		const double start = now();
+		for (size_t r = 0; r < reps; r++) run_kernel(kern, d);
+		if (now() - start >= MIN_TIME) break;
+		reps *= 2;
+	}
+
+	double best = -1.0;
+	for (int t = 0; t < NTIMES; t++) {
+		const double start = now();
+		for (size_t r = 0; r < reps; r++) run_kernel(kern, d);
+		const double time = (now() - start) / (double)reps;
+		if (best < 0 || time < best) best = time;
+	}
+	return best;
+}
+
+// Size in bytes of each cache level, with common sizes where unknown, main
+// memory is unbounded
+static void cache_sizes(size_t size[NUM_LEVELS]) {
+	const size_t fallback[NUM_LEVELS] = {32 << 10, 1 << 20, 32 << 20, 0};
+	long found[NUM_LEVELS] = {0};
+#ifdef _SC_LEVEL1_DCACHE_SIZE
+	found[L1] = sysconf(_SC_LEVEL1_DCACHE_SIZE);
+	found[L2] = sysconf(_SC_LEVEL2_CACHE_SIZE);
+	found[L3] = sysconf(_SC_LEVEL3_CACHE_SIZE);
+#endif
+	for (int l = 0; l < NUM_LEVELS; l++)
+		size[l] = found[l] > 0 ? (size_t)found[l] : fallback[l];
+}
+
+// Level of a kernel whose footprint is `bytes`, the first cache it fits in
+static enum level level_of(const double bytes,
+			   const size_t size[NUM_LEVELS]) {
+	for (int l = 0; l < DRAM; l++)
+		if (bytes <= size[l]) return (enum level)l;
+	return DRAM;
+}
+
+// Footprints at which the peak of a level is measured: just above the
+// previous level, where the level is fastest, and in the middle of the
+// footprints that count as the level. Main memory has no upper bound and is
+// measured at the footprint of the first kernel that misses the caches.
+static void level_footprints(const enum level level, const double bytes,
+			     const size_t size[NUM_LEVELS],
+			     double footprint[2]) {
+	if (level == DRAM) {
+		footprint[0] = footprint[1] = bytes;
+		return;
+	}
+	const double upper = (double)size[level];
+	const double lower = level == L1 ? upper / 16 : (double)size[level - 1];
+	footprint[0] = 2 * lower;
+	footprint[1] = sqrt(lower * upper);
+}
+
+// Reference of a kernel: kernels that write a separate output pay for
+// reading it into the cache like the triad, in-place ones do not
+static enum kernel reference_of(const enum kernel kern) {
+	return kern == K_INPLACE_ADD_ONE || kern == K_INPLACE_ADD_TWO
+		   ? K_STREAM_UPDATE
+		   : K_STREAM_TRIAD;
+}
+
+// Raise `peak` to the bandwidth in GB/s of the reference kernels for three
+// blocks taking `bytes` in total, indexed by kernel - K_STREAM_TRIAD
+// Return: 0 on success, -1 if memory ran out.
+static int measure_peaks(const double bytes, double peak[NUM_REFERENCES]) {
+	const size_t s = (size_t)sqrt(bytes / (3.0 * sizeof(double)));
+	struct bench_data d;
+	const int status = bench_alloc(&d, s > 16 ? s : 16, 0);
+	if (status == 0)
+		for (int kern = K_STREAM_TRIAD; kern < NUM_KERNELS; kern++) {
+			const double bw = kernel_bytes(kern, d.s) /
+					  time_kernel(kern, &d) * 1e-9;
+			double *best = &peak[kern - K_STREAM_TRIAD];
+			if (bw > *best) *best = bw;
+		}
+	bench_free(&d);
+	return status;
+}
+
+int main(int argc, char *argv[]) {
+	size_t max_s = 4096;	  // largest block, its matrix is 512 MB
+	double threshold = 0.5;	  // fraction of the peak below which we flag
+
+	for (int arg = 1; arg < argc; arg++) {
+		if (strncmp(argv[arg], "--threshold=", 12) == 0) {
+			threshold = strtod(argv[arg] + 12, NULL);
+			continue;
+		}
+		max_s = strtoul(argv[arg], NULL, 10);
+		if (max_s < MIN_BLOCK) {
+			fprintf(stderr,
+				"Invalid maximal block size. Please provide "
+				"an integer >= %d.\n",
+				MIN_BLOCK);
+			return EXIT_FAILURE;
+		}
+	}
+
+	FILE *file = fopen("bench_block_utilities.txt", "w");
+	if (file == NULL) {
+		fprintf(stderr, "Could not open bench_block_utilities.txt\n");
+		return EXIT_FAILURE;
+	}
+
+	// Peak bandwidth per memory level, measured when first needed
+	size_t cache_size[NUM_LEVELS];
+	cache_sizes(cache_size);
+	double peak_bw[NUM_LEVELS][NUM_REFERENCES] = {{0.0}};
+	int measured[NUM_LEVELS] = {0};
+
+	printf("# block kernels: %s\n", block_kernel_isa());
+	printf("# %-22s %8s %12s %5s %9s %9s %6s %9s %9s\n", "kernel",
+	       "block", "bytes", "level", "GB/s", "peak", "frac", "GFLOP/s",
+	       "roofline");
+	int flagged = 0;
+	for (size_t s = MIN_BLOCK; s <= max_s; s *= 2) {
+		struct bench_data d;
+		if (bench_alloc(&d, s, 1) != 0) {
+			fprintf(stderr, "Out of memory at block size %zu\n",
+				s);
+			bench_free(&d);
+			fclose(file);
+			return EXIT_FAILURE;
+		}
+
+		for (int kern = 0; kern < K_STREAM_TRIAD; kern++) {
+			const double footprint = kernel_footprint(kern, s);
+			const enum level level =
+			    level_of(footprint, cache_size);
+			if (!measured[level]) {
+				double at[2];
+				int status = 0;
+				level_footprints(level, footprint, cache_size,
+						 at);
+				for (int i = 0; i < 2 && status == 0; i++)
+					status = measure_peaks(at[i],
+							       peak_bw[level]);
+				if (status != 0) {
+					fprintf(stderr,
+						"Out of memory measuring the "
+						"%s peak\n",
+						level_names[level]);
+					bench_free(&d);
+					fclose(file);
+					return EXIT_FAILURE;
+				}
+				measured[level] = 1;
+			}
+			const double peak =
+			    peak_bw[level][reference_of(kern) - K_STREAM_TRIAD];
+			const double time = time_kernel(kern, &d);
+			const double bytes = kernel_bytes(kern, s);
+			const double bw = bytes / time * 1e-9;
+			const double gflops =
+			    kernel_flops(kern, s) / time * 1e-9;
+			// Attainable performance for the kernel's arithmetic
+			// intensity if it ran at the peak bandwidth
+			const double roofline =
+			    kernel_flops(kern, s) / bytes * peak;
+			const double fraction = bw / peak;
+			const int low = fraction < threshold;
+			flagged += low;
+
+			printf("  %-22s %8zu %9.2f MB %5s %9.2f %9.2f %6.2f "
+			       "%9.2f %9.2f%s\n",
+			       kernel_names[kern], s, bytes * 1e-6,
+			       level_names[level], bw, peak, fraction,
+			       gflops, roofline, low ? "  LOW" : "");
+			fprintf(file, "%s %zu %s %lf %lf %lf %d\n",
+				kernel_names[kern], s, level_names[level], bw,
+				peak, fraction, low);
+		}
+
+		bench_free(&d);
+	}
+
+	fclose(file);
+
+	if (flagged) {
+		printf("# %d measurement(s) below %.2f of peak bandwidth\n",
+		       flagged, threshold);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
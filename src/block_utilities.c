@@ -5,22 +5,265 @@
 #include "block_utilities.h"
 
 #include <assert.h>
+#include <math.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#define HAVE_AVX2_KERNELS
+#endif
+
+#include "../include/profile.h"
+
+// Last-level cache size assumed if the system does not report one
+#define DEFAULT_LLC_BYTES (8u << 20)
+
+/*
+ * Row kernels behind the public block functions. Every block operation is a
+ * loop over rows calling one of these, with the row stride handled by the
+ * caller. `stream` requests non-temporal stores for outputs that will not be
+ * read again soon, `pfx` and `pfy` are the offsets from the inputs to the
+ * same position in the next input row, which is prefetched (0: none).
+ */
+struct row_kernels {
+	const char *name;
+	// t = x + alpha * y
+	void (*add)(double *t, const double *x, const double *y,
+		    const double alpha, const size_t n, const ptrdiff_t pfx,
+		    const ptrdiff_t pfy, const int stream);
+	// c += alpha * a (+ beta * b if b is not NULL)
+	void (*acc)(double *c, const double *a, const double *b,
+		    const double alpha, const double beta, const size_t n);
+	// c = beta * c + alpha * q, c is only written for beta == 0
+	void (*scale)(double *c, const double *q, const double alpha,
+		      const double beta, const size_t n, const int stream);
+	// d = s
+	void (*copy)(double *d, const double *s, const size_t n,
+		     const ptrdiff_t pfs, const int stream);
+};
+
+static void generic_add(double *t, const double *x, const double *y,
+			const double alpha, const size_t n,
+			const ptrdiff_t pfx, const ptrdiff_t pfy,
+			const int stream) {
+	(void)pfx, (void)pfy, (void)stream;
+	for (size_t j = 0; j < n; j++) t[j] = x[j] + alpha * y[j];
+}
+
+static void generic_acc(double *c, const double *a, const double *b,
+			const double alpha, const double beta,
+			const size_t n) {
+	if (b == NULL)
+		for (size_t j = 0; j < n; j++) c[j] += alpha * a[j];
+	else
+		for (size_t j = 0; j < n; j++)
+			c[j] += alpha * a[j] + beta * b[j];
+}
+
+static void generic_scale(double *c, const double *q, const double alpha,
+			  const double beta, const size_t n,
+			  const int stream) {
+	(void)stream;
+	if (beta == 0.0)
+		for (size_t j = 0; j < n; j++) c[j] = alpha * q[j];
+	else
+		for (size_t j = 0; j < n; j++)
+			c[j] = beta * c[j] + alpha * q[j];
+}
+
+static void generic_copy(double *d, const double *s, const size_t n,
+			 const ptrdiff_t pfs, const int stream) {
+	(void)pfs, (void)stream;
+	memcpy(d, s, n * sizeof(double));
+}
+
+static const struct row_kernels generic_kernels = {
+    "generic", generic_add, generic_acc, generic_scale, generic_copy};
+
+#ifdef HAVE_AVX2_KERNELS
+/*
+ * AVX2 versions. They use separate multiplies and adds instead of FMA, so the
+ * results are bitwise identical to the generic kernels. Non-temporal stores
+ * need 32-byte aligned addresses, a scalar head aligns each output row.
+ */
+#define AVX2 __attribute__((target("avx2")))
+
+// Scalar elements before t is 32-byte aligned (at most n)
+static size_t head_elements(const double *t, const size_t n) {
+	const size_t misalign = ((uintptr_t)t & 31) / sizeof(double);
+	const size_t head = misalign ? 4 - misalign : 0;
+	return head < n ? head : n;
+}
+
+AVX2 static void avx2_add(double *t, const double *x, const double *y,
+			  const double alpha, const size_t n,
+			  const ptrdiff_t pfx, const ptrdiff_t pfy,
+			  const int stream) {
+	size_t j = stream ? head_elements(t, n) : 0;
+	for (size_t h = 0; h < j; h++) t[h] = x[h] + alpha * y[h];
+	const __m256d va = _mm256_set1_pd(alpha);
+	for (; j + 8 <= n; j += 8) {
+		// One cache line of each input per iteration
+		if (pfx) __builtin_prefetch(x + j + pfx);
+		if (pfy) __builtin_prefetch(y + j + pfy);
+		const __m256d r0 = _mm256_add_pd(
+		    _mm256_loadu_pd(x + j),
+		    _mm256_mul_pd(va, _mm256_loadu_pd(y + j)));
+		const __m256d r1 = _mm256_add_pd(
+		    _mm256_loadu_pd(x + j + 4),
+		    _mm256_mul_pd(va, _mm256_loadu_pd(y + j + 4)));
+		if (stream) {
+			_mm256_stream_pd(t + j, r0);
+			_mm256_stream_pd(t + j + 4, r1);
+		} else {
+			_mm256_storeu_pd(t + j, r0);
+			_mm256_storeu_pd(t + j + 4, r1);
+		}
+	}
+	for (; j < n; j++) t[j] = x[j] + alpha * y[j];
+}
+
+AVX2 static void avx2_acc(double *c, const double *a, const double *b,
+			  const double alpha, const double beta,
+			  const size_t n) {
+	const __m256d va = _mm256_set1_pd(alpha), vb = _mm256_set1_pd(beta);
+	size_t j = 0;
+	if (b == NULL) {
+		for (; j + 4 <= n; j += 4) {
+			const __m256d r = _mm256_add_pd(
+			    _mm256_loadu_pd(c + j),
+			    _mm256_mul_pd(va, _mm256_loadu_pd(a + j)));
+			_mm256_storeu_pd(c + j, r);
+		}
+		for (; j < n; j++) c[j] += alpha * a[j];
+	} else {
+		for (; j + 4 <= n; j += 4) {
+			const __m256d s = _mm256_add_pd(
+			    _mm256_mul_pd(va, _mm256_loadu_pd(a + j)),
+			    _mm256_mul_pd(vb, _mm256_loadu_pd(b + j)));
+			const __m256d r =
+			    _mm256_add_pd(_mm256_loadu_pd(c + j), s);
+			_mm256_storeu_pd(c + j, r);
+		}
+		for (; j < n; j++) c[j] += alpha * a[j] + beta * b[j];
+	}
+}
+
+AVX2 static void avx2_scale(double *c, const double *q, const double alpha,
+			    const double beta, const size_t n,
+			    const int stream) {
+	const __m256d va = _mm256_set1_pd(alpha);
+	size_t j = 0;
+	if (beta == 0.0) {
+		j = stream ? head_elements(c, n) : 0;
+		for (size_t h = 0; h < j; h++) c[h] = alpha * q[h];
+		for (; j + 4 <= n; j += 4) {
+			const __m256d r =
+			    _mm256_mul_pd(va, _mm256_loadu_pd(q + j));
+			if (stream)
+				_mm256_stream_pd(c + j, r);
+			else
+				_mm256_storeu_pd(c + j, r);
+		}
+		for (; j < n; j++) c[j] = alpha * q[j];
+	} else {
+		// c is read, so it is not streamed
+		const __m256d vb = _mm256_set1_pd(beta);
+		for (; j + 4 <= n; j += 4) {
+			const __m256d r = _mm256_add_pd(
+			    _mm256_mul_pd(vb, _mm256_loadu_pd(c + j)),
+			    _mm256_mul_pd(va, _mm256_loadu_pd(q + j)));
+			_mm256_storeu_pd(c + j, r);
+		}
+		for (; j < n; j++) c[j] = beta * c[j] + alpha * q[j];
+	}
+}
+
+AVX2 static void avx2_copy(double *d, const double *s, const size_t n,
+			   const ptrdiff_t pfs, const int stream) {
+	if (!stream && !pfs) {
+		memcpy(d, s, n * sizeof(double));
+		return;
+	}
+	size_t j = stream ? head_elements(d, n) : 0;
+	for (size_t h = 0; h < j; h++) d[h] = s[h];
+	for (; j + 8 <= n; j += 8) {
+		if (pfs) __builtin_prefetch(s + j + pfs);
+		const __m256d r0 = _mm256_loadu_pd(s + j);
+		const __m256d r1 = _mm256_loadu_pd(s + j + 4);
+		if (stream) {
+			_mm256_stream_pd(d + j, r0);
+			_mm256_stream_pd(d + j + 4, r1);
+		} else {
+			_mm256_storeu_pd(d + j, r0);
+			_mm256_storeu_pd(d + j + 4, r1);
+		}
+	}
+	for (; j < n; j++) d[j] = s[j];
+}
+
+static const struct row_kernels avx2_kernels = {"avx2", avx2_add, avx2_acc,
+						avx2_scale, avx2_copy};
+#endif	// HAVE_AVX2_KERNELS
+
+// Kernels for this CPU and the output size from which stores are streamed
+static const struct row_kernels *kernels = &generic_kernels;
+static size_t stream_bytes = DEFAULT_LLC_BYTES / 2;
+
+// Resolved once at load time, before any thread can call a block function
+__attribute__((constructor)) static void select_kernels(void) {
+#ifdef HAVE_AVX2_KERNELS
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) kernels = &avx2_kernels;
+#endif
+#ifdef _SC_LEVEL3_CACHE_SIZE
+	const long llc = sysconf(_SC_LEVEL3_CACHE_SIZE);
+	if (llc > 0) stream_bytes = (size_t)llc / 2;
+#endif
+}
+
+// Stream outputs that cannot stay in cache together with their inputs
+static int use_stream(const size_t elements) {
+	return elements * sizeof(double) >= stream_bytes;
+}
+
+// Order streamed stores before the output is handed on
+static void stream_fence(const int stream) {
+#ifdef HAVE_AVX2_KERNELS
+	if (stream) _mm_sfence();
+#else
+	(void)stream;
+#endif
+}
+
+const char *block_kernel_isa(void) { return kernels->name; }
 
 double *darray_add(const double *const A, const double *const B,
 		   const size_t size, const double alpha) {
 	// Allocate memory for the resulting array
+	PROF_BEGIN(t_alloc);
 	double *C = (double *)malloc(size * sizeof(double));
+	PROF_END(t_alloc, PROF_ALLOC, size * sizeof(double));
+	if (C == NULL) return NULL;
 
-	// Perform element-wise addition with scalar multiplication
-	for (size_t i = 0; i < size; i++) {
-		C[i] = A[i] + alpha * B[i];
-	}
-
+	darray_add_into(C, A, B, size, alpha);
 	return C;
 }
 
+void darray_add_into(double *C, const double *const A, const double *const B,
+		     const size_t size, const double alpha) {
+	// Perform element-wise addition with scalar multiplication
+	PROF_BEGIN(t_add);
+	const int stream = use_stream(size);
+	kernels->add(C, A, B, alpha, size, 0, 0, stream);
+	stream_fence(stream);
+	PROF_END(t_add, PROF_ADD, 3 * size * sizeof(double));
+}
+
 void darray_block_add(const double *const A, double *C, const size_t start1,
 		      const size_t start2, const size_t m, const size_t n,
 		      const double alpha) {
@@ -29,30 +272,43 @@ void darray_block_add(const double *const A, double *C, const size_t start1,
 	       (start2 + (m / 2 - 1) * n + (n / 2 - 1) < m * n));
 
 	// Perform block-wise addition
+	PROF_BEGIN(t_add);
+	const int stream = use_stream(m / 2 * (n / 2));
 	for (size_t i = 0; i < m / 2; i++) {
-		for (size_t j = 0; j < n / 2; j++) {
-			C[i * n / 2 + j] = A[start1 + i * n + j] +
-					   alpha * A[start2 + i * n + j];
-		}
+		// The quadrant rows are n apart, prefetch the next one
+		kernels->add(&C[i * (n / 2)], &A[start1 + i * n],
+			     &A[start2 + i * n], alpha, n / 2, n, n, stream);
 	}
+	stream_fence(stream);
+	PROF_END(t_add, PROF_ADD, 3 * (m / 2) * (n / 2) * sizeof(double));
 }
 
 double *create_block(const double *const A, const size_t start, const size_t m,
 		     const size_t n) {
-	// Ensure the block to be extracted is within bounds
-	assert((start + (m / 2 - 1) * n + (n / 2 - 1) < m * n));
-
 	// Allocate memory for the block
+	PROF_BEGIN(t_alloc);
 	double *a = (double *)malloc(m / 2 * n / 2 * sizeof(double));
+	PROF_END(t_alloc, PROF_ALLOC, m / 2 * n / 2 * sizeof(double));
+	if (a == NULL) return NULL;
+
+	create_block_into(a, A, start, m, n);
+	return a;
+}
+
+void create_block_into(double *a, const double *const A, const size_t start,
+		       const size_t m, const size_t n) {
+	// Ensure the block to be extracted is within bounds
+	assert((start + (m / 2 - 1) * n + (n / 2 - 1) < m * n));
 
 	// Extract the block submatrix
+	PROF_BEGIN(t_copy);
+	const int stream = use_stream(m / 2 * (n / 2));
 	for (size_t i = 0; i < m / 2; i++) {
-		for (size_t j = 0; j < n / 2; j++) {
-			a[i * n / 2 + j] = A[start + i * n + j];
-		}
+		kernels->copy(&a[i * (n / 2)], &A[start + i * n], n / 2, n,
+			      stream);
 	}
-
-	return a;
+	stream_fence(stream);
+	PROF_END(t_copy, PROF_COPY, 2 * (m / 2) * (n / 2) * sizeof(double));
 }
 
 void mat_inplace_block_add(double *C, const double *const a,
@@ -62,23 +318,112 @@ void mat_inplace_block_add(double *C, const double *const a,
 	// Ensure the destination block is within bounds
 	assert((start + (m / 2 - 1) * n + (n / 2 - 1) < m * n));
 
-	if (b == NULL) {
-		// Add only the first block with scalar multiplication
-		for (size_t i = 0; i < m / 2; i++) {
-			for (size_t j = 0; j < n / 2; j++) {
-				C[start + i * n + j] +=
-				    alpha * a[i * n / 2 + j];
-			}
+	PROF_BEGIN(t_add);
+	// C is read and written, so its stores go through the cache
+	for (size_t i = 0; i < m / 2; i++) {
+		kernels->acc(&C[start + i * n], &a[i * (n / 2)],
+			     b == NULL ? NULL : &b[i * (n / 2)], alpha, beta,
+			     n / 2);
+	}
+	PROF_END(t_add, PROF_ADD,
+		 (b == NULL ? 3 : 4) * (m / 2) * (n / 2) * sizeof(double));
+}
+
+double *create_sub_block(const double *const A, const size_t start,
+			 const size_t rows, const size_t cols,
+			 const size_t ld) {
+	// Allocate memory for the block
+	PROF_BEGIN(t_alloc);
+	double *a = (double *)malloc(rows * cols * sizeof(double));
+	PROF_END(t_alloc, PROF_ALLOC, rows * cols * sizeof(double));
+	if (a == NULL) return NULL;
+
+	// Extract the block submatrix row by row
+	PROF_BEGIN(t_copy);
+	const int stream = use_stream(rows * cols);
+	for (size_t i = 0; i < rows; i++) {
+		kernels->copy(&a[i * cols], &A[start + i * ld], cols, ld,
+			      stream);
+	}
+	stream_fence(stream);
+	PROF_END(t_copy, PROF_COPY, 2 * rows * cols * sizeof(double));
+
+	return a;
+}
+
+void set_sub_block(double *C, const double *const a, const size_t start,
+		   const size_t rows, const size_t cols, const size_t ld) {
+	PROF_BEGIN(t_copy);
+	const int stream = use_stream(rows * cols);
+	for (size_t i = 0; i < rows; i++) {
+		kernels->copy(&C[start + i * ld], &a[i * cols], cols, 0,
+			      stream);
+	}
+	stream_fence(stream);
+	PROF_END(t_copy, PROF_COPY, 2 * rows * cols * sizeof(double));
+}
+
+void strided_block_add(const double *const X, const size_t ldx,
+		       const double *const Y, const size_t ldy, double *T,
+		       const size_t ldt, const size_t rows, const size_t cols,
+		       const double alpha) {
+	PROF_BEGIN(t_add);
+	const int stream = use_stream(rows * cols);
+	for (size_t i = 0; i < rows; i++) {
+		kernels->add(&T[i * ldt], &X[i * ldx], &Y[i * ldy], alpha,
+			     cols, ldx, ldy, stream);
+	}
+	stream_fence(stream);
+	PROF_END(t_add, PROF_ADD, 3 * rows * cols * sizeof(double));
+}
+
+void strided_block_acc(double *C, const size_t ldc, const double *const Q,
+		       const size_t ldq, const size_t rows, const size_t cols,
+		       const double alpha, const double beta) {
+	PROF_BEGIN(t_add);
+	// For beta == 0, C is overwritten and may hold uninitialized memory
+	const int stream = beta == 0.0 && use_stream(rows * cols);
+	for (size_t i = 0; i < rows; i++) {
+		kernels->scale(&C[i * ldc], &Q[i * ldq], alpha, beta, cols,
+			       stream);
+	}
+	stream_fence(stream);
+	PROF_END(t_add, PROF_ADD,
+		 (beta == 0.0 ? 2 : 3) * rows * cols * sizeof(double));
+}
+
+int block_is_zero(const double *const A, const size_t start, const size_t rows,
+		  const size_t cols, const size_t ld) {
+	for (size_t i = 0; i < rows; i++) {
+		for (size_t j = 0; j < cols; j++) {
+			if (A[start + i * ld + j] != 0.0) return 0;
 		}
-	} else {
-		// Add both blocks with respective scalar multipliers
-		for (size_t i = 0; i < m / 2; i++) {
-			for (size_t j = 0; j < n / 2; j++) {
-				C[start + i * n + j] +=
-				    alpha * a[i * n / 2 + j] +
-				    beta * b[i * n / 2 + j];
-			}
+	}
+	return 1;
+}
+
+int block_is_identity(const double *const A, const size_t start,
+		      const size_t size, const size_t ld) {
+	for (size_t i = 0; i < size; i++) {
+		for (size_t j = 0; j < size; j++) {
+			if (A[start + i * ld + j] != (i == j ? 1.0 : 0.0))
+				return 0;
 		}
 	}
+	return 1;
 }
 
+double block_norm1(const double *const A, const size_t rows,
+		   const size_t cols) {
+	// Column sums accumulated row by row, in memory order
+	double *sums = calloc(cols > 0 ? cols : 1, sizeof(double));
+	if (sums == NULL) return -1.0;
+	for (size_t i = 0; i < rows; i++)
+		for (size_t j = 0; j < cols; j++)
+			sums[j] += fabs(A[i * cols + j]);
+	double norm = 0.0;
+	for (size_t j = 0; j < cols; j++)
+		if (sums[j] > norm) norm = sums[j];
+	free(sums);
+	return norm;
+}
@@ -0,0 +1,883 @@
+/*
+ * DESC: Module for asynchronous multiplication, inversion and solve jobs on a
+ * shared worker pool.
+ * AUTHORS: Thomas Gantz, Laura Paxton, Jan Marxen
+ */
+#include "../include/executor.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../include/block_utilities.h"
+#include "../include/fixed_kernels.h"
+#include "../include/strassen_inv.h"
+#include "../include/strassen_plan.h"
+
+// Unit of work run by one worker, embedded in the job it belongs to
+struct exec_task {
+	void (*run)(void *arg, int index);
+	void *arg;
+	int index;
+	struct exec_task *next;
+};
+
+// Number of multiplication shapes whose plans are kept warm
+#define EXEC_PLAN_CACHE 16
+
+// Plan of a recent shape, shared read-only by the jobs running with it.
+// Each job brings its own workspace, the one of the last finished job is
+// kept for the next.
+struct plan_slot {
+	struct strassen_plan *plan;  // external workspace, NULL if unused
+	size_t workspace_size;	     // doubles a job needs with the plan
+	double *spare;		     // workspace kept warm, NULL if none
+	int users;		     // jobs running with the plan
+	uint64_t last_use;
+};
+
+// Plan and workspace held by one job, slot is NULL for a private plan
+struct plan_lease {
+	struct plan_slot *slot;
+	struct strassen_plan *plan;
+	double *workspace;
+};
+
+struct strassen_executor {
+	pthread_mutex_t lock;
+	pthread_cond_t work;  // signalled when tasks are queued or on shutdown
+	pthread_cond_t idle;  // signalled when the last pending job finishes
+	struct exec_task *head, *tail;	// deque of ready tasks
+	size_t pending_jobs;
+	int shutdown;
+	size_t num_threads;
+	pthread_t *threads;
+
+	pthread_mutex_t plan_lock;
+	struct plan_slot plans[EXEC_PLAN_CACHE];
+	uint64_t plan_clock;
+};
+
+struct strassen_future {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	int done;
+	int status;
+	int refs;  // caller and executor
+	strassen_callback callback;
+	void *arg;
+};
+
+// Multiplication C = A*B, split into the products of the top Strassen step
+// when the plan starts with one. `done` is called once C is complete.
+struct matmat_job {
+	struct strassen_executor *executor;
+	struct plan_lease lease;  // plan, products and their workspaces
+	const double *A, *B;
+	double *C;
+	double *Q[STRASSEN_PRODUCTS];
+	double *ws[STRASSEN_PRODUCTS];
+	atomic_int remaining;
+	int num_tasks;
+	struct exec_task tasks[STRASSEN_PRODUCTS];
+	void (*done)(void *arg, const int status);
+	void *done_arg;
+};
+
+// Inversion of A = [a b; c d] whose top block step runs as stages on the
+// pool: e = a^-1, then ce = c*e and eb = e*b, then ceb = ce*b, then
+// t = (d - ceb)^-1, then tce = t*ce and ebt = eb*t, then ebtce = ebt*ce.
+// The products of a stage are multiplication jobs, the inversions of a and
+// of the Schur complement are single tasks. `done` is called once inverse_A
+// is complete.
+struct invert_job {
+	struct strassen_executor *executor;
+	const double *A;
+	double *inverse_A;
+	size_t n, n1, n2;
+	int b_zero, c_zero;  // products with a zero block are skipped
+	double *buffer;	     // all blocks, zero so skipped products read 0
+	double *a, *b, *c, *d, *e, *ce, *eb, *ceb, *t, *ebt, *tce, *ebtce;
+	int stage;
+	atomic_int remaining;  // products of the stage still running
+	atomic_int status;
+	struct exec_task task;
+	void (*done)(void *arg, const int status);
+	void *done_arg;
+};
+
+// Bookkeeping of a submitted job. Solves also keep the operands of the
+// multiplication X = A^-1 * B they continue with after the inversion.
+struct async_job {
+	struct strassen_executor *executor;
+	struct strassen_future *future;
+	const double *B;
+	double *inverse_A, *X;
+	size_t n, k;
+};
+
+/* ####################################################### */
+/* Task queue and workers */
+
+// Queue tasks in order, at the head for continuations of jobs in progress
+static void push_tasks(struct strassen_executor *ex, struct exec_task *tasks,
+		       const int count, const int front) {
+	for (int i = 0; i + 1 < count; i++) tasks[i].next = &tasks[i + 1];
+	struct exec_task *last = &tasks[count - 1];
+
+	pthread_mutex_lock(&ex->lock);
+	if (front) {
+		last->next = ex->head;
+		ex->head = &tasks[0];
+		if (ex->tail == NULL) ex->tail = last;
+	} else {
+		last->next = NULL;
+		if (ex->tail == NULL)
+			ex->head = &tasks[0];
+		else
+			ex->tail->next = &tasks[0];
+		ex->tail = last;
+	}
+	if (count > 1)
+		pthread_cond_broadcast(&ex->work);
+	else
+		pthread_cond_signal(&ex->work);
+	pthread_mutex_unlock(&ex->lock);
+}
+
+static void *worker(void *arg) {
+	struct strassen_executor *ex = arg;
+
+	pthread_mutex_lock(&ex->lock);
+	for (;;) {
+		while (ex->head == NULL && !ex->shutdown)
+			pthread_cond_wait(&ex->work, &ex->lock);
+		if (ex->head == NULL) break;  // shutdown with an empty queue
+
+		struct exec_task *task = ex->head;
+		ex->head = task->next;
+		if (ex->head == NULL) ex->tail = NULL;
+
+		pthread_mutex_unlock(&ex->lock);
+		task->run(task->arg, task->index);
+		pthread_mutex_lock(&ex->lock);
+	}
+	pthread_mutex_unlock(&ex->lock);
+
+	return NULL;
+}
+
+struct strassen_executor *strassen_executor_create(size_t num_threads) {
+	if (num_threads == 0) {
+		const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		num_threads = cpus > 0 ? (size_t)cpus : 1;
+	}
+
+	struct strassen_executor *ex = calloc(1, sizeof(*ex));
+	if (ex == NULL) return NULL;
+	ex->threads = malloc(num_threads * sizeof(pthread_t));
+	if (ex->threads == NULL) {
+		free(ex);
+		return NULL;
+	}
+	pthread_mutex_init(&ex->lock, NULL);
+	pthread_mutex_init(&ex->plan_lock, NULL);
+	pthread_cond_init(&ex->work, NULL);
+	pthread_cond_init(&ex->idle, NULL);
+
+	for (; ex->num_threads < num_threads; ex->num_threads++) {
+		if (pthread_create(&ex->threads[ex->num_threads], NULL, worker,
+				   ex) != 0)
+			break;
+	}
+	if (ex->num_threads == 0) {
+		strassen_executor_destroy(ex);
+		return NULL;
+	}
+
+	return ex;
+}
+
+void strassen_executor_destroy(struct strassen_executor *ex) {
+	pthread_mutex_lock(&ex->lock);
+	while (ex->pending_jobs > 0) pthread_cond_wait(&ex->idle, &ex->lock);
+	ex->shutdown = 1;
+	pthread_cond_broadcast(&ex->work);
+	pthread_mutex_unlock(&ex->lock);
+
+	for (size_t i = 0; i < ex->num_threads; i++)
+		pthread_join(ex->threads[i], NULL);
+
+	for (int i = 0; i < EXEC_PLAN_CACHE; i++) {
+		strassen_plan_destroy(ex->plans[i].plan);
+		free(ex->plans[i].spare);
+	}
+	pthread_cond_destroy(&ex->idle);
+	pthread_cond_destroy(&ex->work);
+	pthread_mutex_destroy(&ex->plan_lock);
+	pthread_mutex_destroy(&ex->lock);
+	free(ex->threads);
+	free(ex);
+}
+
+/* ####################################################### */
+/* Plan cache */
+
+// Doubles of workspace a job needs with the plan: the products of the top
+// Strassen step with their workspaces when it is split into tasks
+static size_t job_workspace(const struct strassen_plan *plan) {
+	if (plan->nodes[0].step != STEP_STRASSEN) return plan->workspace_size;
+	const size_t q_size = (plan->m / 2) * (plan->k / 2);
+	const size_t all = STRASSEN_PRODUCTS *
+			   (q_size + strassen_product_workspace(plan, 0));
+	return all > plan->workspace_size ? all : plan->workspace_size;
+}
+
+// Slot of the shape, NULL if it is not cached. Called with plan_lock held.
+static struct plan_slot *find_slot(struct strassen_executor *ex,
+				   const size_t m, const size_t n,
+				   const size_t k) {
+	for (int i = 0; i < EXEC_PLAN_CACHE; i++) {
+		struct plan_slot *slot = &ex->plans[i];
+		if (slot->plan != NULL && slot->plan->m == m &&
+		    slot->plan->n == n && slot->plan->k == k)
+			return slot;
+	}
+	return NULL;
+}
+
+// Take the plan of the slot and its spare workspace. Called with plan_lock
+// held.
+static void lease_slot(struct strassen_executor *ex, struct plan_slot *slot,
+		       struct plan_lease *lease) {
+	slot->users++;
+	slot->last_use = ++ex->plan_clock;
+	lease->slot = slot;
+	lease->plan = slot->plan;
+	if (lease->workspace == NULL) {
+		lease->workspace = slot->spare;
+		slot->spare = NULL;
+	}
+}
+
+// Plan of the shape mxn * nxk with a workspace of `job_workspace` doubles.
+// Plans of recent shapes are reused, a new plan takes the least recently
+// used slot that no job runs with, or stays private if there is none.
+// Return: 0 on success, -1 if memory ran out.
+static int acquire_plan(struct strassen_executor *ex, const size_t m,
+			const size_t n, const size_t k,
+			struct plan_lease *lease) {
+	*lease = (struct plan_lease){NULL, NULL, NULL};
+	pthread_mutex_lock(&ex->plan_lock);
+	struct plan_slot *slot = find_slot(ex, m, n, k);
+	if (slot != NULL) lease_slot(ex, slot, lease);
+	pthread_mutex_unlock(&ex->plan_lock);
+	if (slot != NULL) {
+		if (lease->workspace == NULL)
+			lease->workspace =
+			    malloc(slot->workspace_size * sizeof(double));
+		return lease->workspace != NULL ? 0 : -1;
+	}
+
+	// Plan outside of the lock, other jobs keep using the cache
+	const struct strassen_plan_options options = {.external_workspace = 1};
+	struct strassen_plan *plan = strassen_plan(m, n, k, &options);
+	if (plan == NULL) return -1;
+	const size_t workspace_size = job_workspace(plan);
+	lease->workspace = malloc(workspace_size * sizeof(double));
+	if (lease->workspace == NULL) {
+		strassen_plan_destroy(plan);
+		return -1;
+	}
+
+	pthread_mutex_lock(&ex->plan_lock);
+	slot = find_slot(ex, m, n, k);	// planned meanwhile by another job
+	if (slot == NULL) {
+		for (int i = 0; i < EXEC_PLAN_CACHE; i++) {
+			struct plan_slot *e = &ex->plans[i];
+			if (e->users > 0) continue;
+			if (slot == NULL || e->plan == NULL ||
+			    (slot->plan != NULL &&
+			     e->last_use < slot->last_use))
+				slot = e;
+		}
+		if (slot != NULL) {
+			strassen_plan_destroy(slot->plan);
+			free(slot->spare);
+			*slot = (struct plan_slot){
+			    .plan = plan, .workspace_size = workspace_size};
+			plan = NULL;
+		}
+	}
+	if (slot != NULL) lease_slot(ex, slot, lease);
+	pthread_mutex_unlock(&ex->plan_lock);
+
+	if (slot == NULL)
+		lease->plan = plan;  // every slot is in use
+	else
+		strassen_plan_destroy(plan);  // NULL unless planned twice
+	return 0;
+}
+
+// Give the plan back, its workspace becomes the slot's spare if it has none
+static void release_plan(struct strassen_executor *ex,
+			 struct plan_lease *lease) {
+	struct plan_slot *slot = lease->slot;
+	if (slot == NULL) {
+		strassen_plan_destroy(lease->plan);
+		free(lease->workspace);
+		return;
+	}
+	pthread_mutex_lock(&ex->plan_lock);
+	slot->users--;
+	if (slot->spare == NULL) {
+		slot->spare = lease->workspace;
+		lease->workspace = NULL;
+	}
+	pthread_mutex_unlock(&ex->plan_lock);
+	free(lease->workspace);
+}
+
+/* ####################################################### */
+/* Futures */
+
+static struct strassen_future *create_future(strassen_callback callback,
+					     void *arg) {
+	struct strassen_future *future = calloc(1, sizeof(*future));
+	if (future == NULL) return NULL;
+	pthread_mutex_init(&future->lock, NULL);
+	pthread_cond_init(&future->cond, NULL);
+	future->refs = 2;
+	future->callback = callback;
+	future->arg = arg;
+	return future;
+}
+
+static void free_future(struct strassen_future *future) {
+	pthread_cond_destroy(&future->cond);
+	pthread_mutex_destroy(&future->lock);
+	free(future);
+}
+
+static void begin_job(struct strassen_executor *ex) {
+	pthread_mutex_lock(&ex->lock);
+	ex->pending_jobs++;
+	pthread_mutex_unlock(&ex->lock);
+}
+
+// Run the callback, wake up waiters and retire the job
+static void complete_job(struct strassen_executor *ex,
+			 struct strassen_future *future, const int status) {
+	if (future->callback != NULL)
+		future->callback(future, status, future->arg);
+
+	pthread_mutex_lock(&future->lock);
+	future->done = 1;
+	future->status = status;
+	pthread_cond_broadcast(&future->cond);
+	pthread_mutex_unlock(&future->lock);
+	strassen_future_release(future);
+
+	pthread_mutex_lock(&ex->lock);
+	if (--ex->pending_jobs == 0) pthread_cond_broadcast(&ex->idle);
+	pthread_mutex_unlock(&ex->lock);
+}
+
+int strassen_future_done(struct strassen_future *future) {
+	pthread_mutex_lock(&future->lock);
+	const int done = future->done;
+	pthread_mutex_unlock(&future->lock);
+	return done;
+}
+
+int strassen_future_wait(struct strassen_future *future) {
+	pthread_mutex_lock(&future->lock);
+	while (!future->done) pthread_cond_wait(&future->cond, &future->lock);
+	const int status = future->status;
+	pthread_mutex_unlock(&future->lock);
+	return status;
+}
+
+void strassen_future_release(struct strassen_future *future) {
+	pthread_mutex_lock(&future->lock);
+	const int refs = --future->refs;
+	pthread_mutex_unlock(&future->lock);
+	if (refs == 0) free_future(future);
+}
+
+/* ####################################################### */
+/* Multiplication */
+
+static void free_matmat_job(struct matmat_job *job) {
+	release_plan(job->executor, &job->lease);
+	free(job);
+}
+
+static void run_product(void *arg, const int p) {
+	struct matmat_job *job = arg;
+	const struct strassen_plan *plan = job->lease.plan;
+	strassen_execute_product(plan, 0, p, job->A, plan->n, job->B, plan->k,
+				 job->Q[p], job->ws[p]);
+
+	// The worker finishing the last product assembles the result
+	if (atomic_fetch_sub(&job->remaining, 1) == 1) {
+		const double *const *Q = (const double *const *)job->Q;
+		strassen_execute_assemble(plan, 0, Q, job->A, plan->n, job->B,
+					  plan->k, job->C, plan->k, 0);
+		job->done(job->done_arg, 0);
+		free_matmat_job(job);
+	}
+}
+
+static void run_matmat(void *arg, const int index) {
+	(void)index;
+	struct matmat_job *job = arg;
+	strassen_execute_ws(job->lease.plan, job->A, job->B, job->C,
+			    job->lease.workspace);
+	job->done(job->done_arg, 0);
+	free_matmat_job(job);
+}
+
+// Plan a multiplication and prepare its tasks, NULL if out of memory
+static struct matmat_job *create_matmat_job(
+    struct strassen_executor *executor, const double *A, const double *B,
+    double *C, const size_t m, const size_t n, const size_t k,
+    void (*done)(void *, const int), void *done_arg) {
+	struct matmat_job *job = calloc(1, sizeof(*job));
+	if (job == NULL) return NULL;
+	job->executor = executor;
+	if (acquire_plan(executor, m, n, k, &job->lease) != 0) {
+		free(job);
+		return NULL;
+	}
+	job->A = A;
+	job->B = B;
+	job->C = C;
+	job->done = done;
+	job->done_arg = done_arg;
+
+	const struct strassen_plan *plan = job->lease.plan;
+	if (plan->nodes[0].step != STEP_STRASSEN) {
+		job->num_tasks = 1;
+		job->tasks[0] = (struct exec_task){run_matmat, job, 0, NULL};
+		return job;
+	}
+
+	// The workspace holds every product with its own workspace
+	const size_t q_size = (m / 2) * (k / 2);
+	const size_t ws_size = strassen_product_workspace(plan, 0);
+	for (int p = 0; p < STRASSEN_PRODUCTS; p++) {
+		job->Q[p] = job->lease.workspace + p * (q_size + ws_size);
+		job->ws[p] = job->Q[p] + q_size;
+		job->tasks[p] = (struct exec_task){run_product, job, p, NULL};
+	}
+	job->num_tasks = STRASSEN_PRODUCTS;
+	atomic_init(&job->remaining, STRASSEN_PRODUCTS);
+
+	return job;
+}
+
+static void finish_matmat(void *arg, const int status) {
+	struct async_job *owner = arg;
+	complete_job(owner->executor, owner->future, status);
+	free(owner);
+}
+
+struct strassen_future *strassen_submit_matmat(
+    struct strassen_executor *executor, const double *const A,
+    const double *const B, double *C, const size_t m, const size_t n,
+    const size_t k, strassen_callback callback, void *arg) {
+	// A multiplication only uses the bookkeeping part of a job
+	struct async_job *owner = calloc(1, sizeof(*owner));
+	struct strassen_future *future = create_future(callback, arg);
+	struct matmat_job *job =
+	    create_matmat_job(executor, A, B, C, m, n, k, finish_matmat, owner);
+	if (owner == NULL || future == NULL || job == NULL) {
+		free(owner);
+		if (future != NULL) free_future(future);
+		if (job != NULL) free_matmat_job(job);
+		return NULL;
+	}
+	owner->executor = executor;
+	owner->future = future;
+
+	begin_job(executor);
+	push_tasks(executor, job->tasks, job->num_tasks, 0);
+	return future;
+}
+
+/* ####################################################### */
+/* Batches */
+
+// Products of a batch, split into at most one chunk per worker
+struct batch_job {
+	struct strassen_executor *executor;
+	struct strassen_future *future;
+	struct strassen_batch_item *items;
+	size_t count, chunk;  // items and items per task
+	atomic_int remaining;
+	atomic_int status;
+	struct exec_task tasks[];
+};
+
+static void run_batch_chunk(void *arg, const int index) {
+	struct batch_job *job = arg;
+	const size_t begin = (size_t)index * job->chunk;
+	const size_t end =
+	    begin + job->chunk < job->count ? begin + job->chunk : job->count;
+	for (size_t i = begin; i < end; i++) {
+		struct strassen_batch_item *item = &job->items[i];
+		struct plan_lease lease;
+		item->status = acquire_plan(job->executor, item->m, item->n,
+					    item->k, &lease);
+		if (item->status == 0) {
+			strassen_execute_ws(lease.plan, item->A, item->B,
+					    item->C, lease.workspace);
+			release_plan(job->executor, &lease);
+		} else {
+			atomic_store(&job->status, -1);
+		}
+	}
+
+	if (atomic_fetch_sub(&job->remaining, 1) == 1) {
+		complete_job(job->executor, job->future,
+			     atomic_load(&job->status));
+		free(job);
+	}
+}
+
+struct strassen_future *strassen_submit_batch(
+    struct strassen_executor *executor, struct strassen_batch_item *items,
+    const size_t count, strassen_callback callback, void *arg) {
+	if (count == 0) return NULL;
+	const size_t num_tasks =
+	    count < executor->num_threads ? count : executor->num_threads;
+	struct batch_job *job =
+	    malloc(sizeof(*job) + num_tasks * sizeof(struct exec_task));
+	struct strassen_future *future = create_future(callback, arg);
+	if (job == NULL || future == NULL) {
+		free(job);
+		if (future != NULL) free_future(future);
+		return NULL;
+	}
+	job->executor = executor;
+	job->future = future;
+	job->items = items;
+	job->count = count;
+	job->chunk = (count + num_tasks - 1) / num_tasks;
+	// Chunks of the rounded-up size can leave the last tasks empty
+	const int used = (int)((count + job->chunk - 1) / job->chunk);
+	atomic_init(&job->remaining, used);
+	atomic_init(&job->status, 0);
+	for (int t = 0; t < used; t++)
+		job->tasks[t] = (struct exec_task){run_batch_chunk, job, t,
+						   NULL};
+
+	begin_job(executor);
+	push_tasks(executor, job->tasks, used, 0);
+	return future;
+}
+
+/* ####################################################### */
+/* Inversion and solve */
+
+static void free_invert_job(struct invert_job *job) {
+	free(job->buffer);
+	free(job);
+}
+
+// Retire the inversion and pass its status on
+static void finish_invert_job(struct invert_job *job, const int status) {
+	void (*done)(void *, const int) = job->done;
+	void *done_arg = job->done_arg;
+	free_invert_job(job);
+	done(done_arg, status);
+}
+
+// Copy the block of A (size rows x cols, A has n columns) at `start` into a
+static void copy_block(double *a, const double *const A, const size_t start,
+		       const size_t rows, const size_t cols, const size_t n) {
+	for (size_t i = 0; i < rows; i++)
+		memcpy(&a[i * cols], &A[start + i * n], cols * sizeof(double));
+}
+
+static void next_stage(struct invert_job *job);
+
+static void product_done(void *arg, const int status) {
+	struct invert_job *job = arg;
+	if (status != 0) atomic_store(&job->status, -1);
+	if (atomic_fetch_sub(&job->remaining, 1) == 1) next_stage(job);
+}
+
+// Product of a stage, skipped if `skip` is set
+struct stage_product {
+	const double *A, *B;
+	double *C;
+	size_t m, n, k;
+	int skip;
+};
+
+// Run the products of a stage as multiplication jobs ahead of newly
+// submitted jobs, the last one to finish starts the next stage
+static void start_products(struct invert_job *job,
+			   const struct stage_product *products,
+			   const int count) {
+	struct matmat_job *matmat[2];
+	int started = 0;
+	for (int i = 0; i < count; i++) {
+		const struct stage_product *p = &products[i];
+		if (p->skip) continue;
+		matmat[started] =
+		    create_matmat_job(job->executor, p->A, p->B, p->C, p->m,
+				      p->n, p->k, product_done, job);
+		if (matmat[started] == NULL)
+			atomic_store(&job->status, -1);
+		else
+			started++;
+	}
+	if (started == 0) {
+		next_stage(job);
+		return;
+	}
+
+	// Count all products before any of them can finish
+	atomic_store(&job->remaining, started);
+	for (int i = 0; i < started; i++)
+		push_tasks(job->executor, matmat[i]->tasks,
+			   matmat[i]->num_tasks, 1);
+}
+
+// Schur complement task: t = Z^-1 with Z = d - ceb, computed in place of d
+static void run_invert_schur(void *arg, const int index) {
+	(void)index;
+	struct invert_job *job = arg;
+	const size_t n2 = job->n2;
+	darray_add_into(job->d, job->d, job->ceb, n2 * n2, -1.0);
+	if (strassen_invert(job->d, job->t, n2) != 0)
+		atomic_store(&job->status, -1);
+	next_stage(job);
+}
+
+// Write the blocks of the inverse: [e + ebtce, -ebt; -tce, t]
+static void assemble_inverse(const struct invert_job *job) {
+	const size_t n = job->n, n1 = job->n1, n2 = job->n2;
+	double *inverse_A = job->inverse_A;
+	for (size_t i = 0; i < n1; i++) {
+		for (size_t j = 0; j < n1; j++)
+			inverse_A[i * n + j] =
+			    job->e[i * n1 + j] + job->ebtce[i * n1 + j];
+		for (size_t j = 0; j < n2; j++)
+			inverse_A[i * n + n1 + j] = -job->ebt[i * n2 + j];
+	}
+	for (size_t i = 0; i < n2; i++) {
+		for (size_t j = 0; j < n1; j++)
+			inverse_A[(n1 + i) * n + j] = -job->tce[i * n1 + j];
+		for (size_t j = 0; j < n2; j++)
+			inverse_A[(n1 + i) * n + n1 + j] =
+			    job->t[i * n2 + j];
+	}
+}
+
+// Start the stage after the one that just finished
+static void next_stage(struct invert_job *job) {
+	if (atomic_load(&job->status) != 0) {
+		finish_invert_job(job, -1);
+		return;
+	}
+
+	const size_t n1 = job->n1, n2 = job->n2;
+	const int b_zero = job->b_zero, c_zero = job->c_zero;
+	switch (job->stage++) {
+		case 0: {
+			const struct stage_product products[] = {
+			    {job->c, job->e, job->ce, n2, n1, n1, c_zero},
+			    {job->e, job->b, job->eb, n1, n1, n2, b_zero}};
+			start_products(job, products, 2);
+			break;
+		}
+		case 1: {
+			const struct stage_product products[] = {
+			    {job->ce, job->b, job->ceb, n2, n1, n2,
+			     b_zero || c_zero}};
+			start_products(job, products, 1);
+			break;
+		}
+		case 2:
+			job->task = (struct exec_task){run_invert_schur, job,
+						       0, NULL};
+			push_tasks(job->executor, &job->task, 1, 1);
+			break;
+		case 3: {
+			const struct stage_product products[] = {
+			    {job->t, job->ce, job->tce, n2, n2, n1, c_zero},
+			    {job->eb, job->t, job->ebt, n1, n2, n2, b_zero}};
+			start_products(job, products, 2);
+			break;
+		}
+		case 4: {
+			const struct stage_product products[] = {
+			    {job->ebt, job->ce, job->ebtce, n1, n2, n1,
+			     b_zero || c_zero}};
+			start_products(job, products, 1);
+			break;
+		}
+		default:
+			assemble_inverse(job);
+			finish_invert_job(job, 0);
+			break;
+	}
+}
+
+// First stage task: copy the blocks of A and invert a. Sizes the fixed-size
+// kernels handle and the identity are inverted directly.
+static void run_invert_first(void *arg, const int index) {
+	(void)index;
+	struct invert_job *job = arg;
+	const size_t n = job->n, n1 = job->n1, n2 = job->n2;
+	if (n <= FIXED_KERNEL_MAX || block_is_identity(job->A, 0, n, n)) {
+		finish_invert_job(job,
+				  strassen_invert(job->A, job->inverse_A, n));
+		return;
+	}
+
+	copy_block(job->a, job->A, 0, n1, n1, n);
+	copy_block(job->b, job->A, n1, n1, n2, n);
+	copy_block(job->c, job->A, n1 * n, n2, n1, n);
+	copy_block(job->d, job->A, n1 * n + n1, n2, n2, n);
+	job->b_zero = block_is_zero(job->A, n1, n1, n2, n);
+	job->c_zero = block_is_zero(job->A, n1 * n, n2, n1, n);
+	if (strassen_invert(job->a, job->e, n1) != 0)
+		atomic_store(&job->status, -1);
+	next_stage(job);
+}
+
+// Prepare an inversion and its first task, NULL if out of memory
+static struct invert_job *create_invert_job(
+    struct strassen_executor *executor, const double *A, double *inverse_A,
+    const size_t n, void (*done)(void *, const int), void *done_arg) {
+	struct invert_job *job = calloc(1, sizeof(*job));
+	if (job == NULL) return NULL;
+	const size_t n1 = n / 2, n2 = n - n1;
+	if (n > FIXED_KERNEL_MAX) {
+		// Z = d - ceb overwrites d
+		job->buffer = calloc(3 * n1 * n1 + 6 * n1 * n2 + 3 * n2 * n2,
+				     sizeof(double));
+		if (job->buffer == NULL) {
+			free(job);
+			return NULL;
+		}
+	}
+	job->executor = executor;
+	job->A = A;
+	job->inverse_A = inverse_A;
+	job->n = n;
+	job->n1 = n1;
+	job->n2 = n2;
+	job->done = done;
+	job->done_arg = done_arg;
+	job->task = (struct exec_task){run_invert_first, job, 0, NULL};
+	atomic_init(&job->remaining, 0);
+	atomic_init(&job->status, 0);
+	if (job->buffer == NULL) return job;
+
+	double *next = job->buffer;
+	double **const blocks[] = {&job->a,   &job->e,	  &job->ebtce,
+				   &job->b,   &job->c,	  &job->ce,
+				   &job->eb,  &job->ebt,  &job->tce,
+				   &job->d,   &job->ceb,  &job->t};
+	const size_t sizes[] = {n1 * n1, n1 * n1, n1 * n1, n1 * n2,
+				n1 * n2, n1 * n2, n1 * n2, n1 * n2,
+				n1 * n2, n2 * n2, n2 * n2, n2 * n2};
+	for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+		*blocks[i] = next;
+		next += sizes[i];
+	}
+	return job;
+}
+
+static void finish_invert(void *arg, const int status) {
+	struct async_job *job = arg;
+	complete_job(job->executor, job->future, status);
+	free(job);
+}
+
+static void finish_solve(void *arg, const int status) {
+	struct async_job *job = arg;
+	free(job->inverse_A);
+	complete_job(job->executor, job->future, status);
+	free(job);
+}
+
+// Continuation of the inversion stage of a solve: X = A^-1 * B
+static void start_solve_matmat(void *arg, const int status) {
+	struct async_job *job = arg;
+	if (status != 0) {
+		finish_solve(job, status);
+		return;
+	}
+	struct matmat_job *matmat =
+	    create_matmat_job(job->executor, job->inverse_A, job->B, job->X,
+			      job->n, job->n, job->k, finish_solve, job);
+	if (matmat == NULL) {
+		finish_solve(job, -1);
+		return;
+	}
+
+	// Continue this job before starting newly submitted ones
+	push_tasks(job->executor, matmat->tasks, matmat->num_tasks, 1);
+}
+
+struct strassen_future *strassen_submit_invert(
+    struct strassen_executor *executor, const double *const A,
+    double *inverse_A, const size_t n, strassen_callback callback, void *arg) {
+	// An inversion only uses the bookkeeping part of a job
+	struct async_job *owner = calloc(1, sizeof(*owner));
+	struct strassen_future *future = create_future(callback, arg);
+	struct invert_job *job = create_invert_job(executor, A, inverse_A, n,
+						   finish_invert, owner);
+	if (owner == NULL || future == NULL || job == NULL) {
+		free(owner);
+		if (future != NULL) free_future(future);
+		if (job != NULL) free_invert_job(job);
+		return NULL;
+	}
+	owner->executor = executor;
+	owner->future = future;
+
+	begin_job(executor);
+	push_tasks(executor, &job->task, 1, 0);
+	return future;
+}
+
+struct strassen_future *strassen_submit_solve(
+    struct strassen_executor *executor, const double *const A,
+    const double *const B, double *X, const size_t n, const size_t k,
+    strassen_callback callback, void *arg) {
+	struct async_job *owner = calloc(1, sizeof(*owner));
+	struct strassen_future *future = create_future(callback, arg);
+	double *inverse_A = malloc(n * n * sizeof(double));
+	struct invert_job *job = create_invert_job(
+	    executor, A, inverse_A, n, start_solve_matmat, owner);
+	if (owner == NULL || future == NULL || inverse_A == NULL ||
+	    job == NULL) {
+		free(owner);
+		if (future != NULL) free_future(future);
+		free(inverse_A);
+		if (job != NULL) free_invert_job(job);
+		return NULL;
+	}
+	owner->executor = executor;
+	owner->future = future;
+	owner->B = B;
+	owner->inverse_A = inverse_A;
+	owner->X = X;
+	owner->n = n;
+	owner->k = k;
+
+	begin_job(executor);
+	push_tasks(executor, &job->task, 1, 0);
+	return future;
+}
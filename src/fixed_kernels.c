@@ -0,0 +1,133 @@
+/*
+ * DESC: Module for specialized kernels of fixed small sizes.
+ * AUTHORS: Thomas Gantz, Laura Paxton, Jan Marxen
+ */
+#include "../include/fixed_kernels.h"
+
+#include <math.h>
+
+/*
+ * C = A*B + beta*C for N x N blocks. The row accumulator has a constant size,
+ * so it lives in registers and every loop is unrolled.
+ */
+#define DEFINE_FIXED_MATMAT(N)                                                \
+	static void fixed_matmat_##N(                                         \
+	    const double *restrict A, const size_t lda,                       \
+	    const double *restrict B, const size_t ldb, double *restrict C,   \
+	    const size_t ldc, const int beta) {                               \
+		for (int i = 0; i < N; i++) {                                 \
+			double row[N];                                        \
+			for (int j = 0; j < N; j++)                           \
+				row[j] = beta ? C[i * ldc + j] : 0.0;         \
+			for (int l = 0; l < N; l++) {                         \
+				const double a = A[i * lda + l];              \
+				for (int j = 0; j < N; j++)                   \
+					row[j] += a * B[l * ldb + j];         \
+			}                                                     \
+			for (int j = 0; j < N; j++) C[i * ldc + j] = row[j];  \
+		}                                                             \
+	}
+
+/*
+ * X = A^-1 for N x N matrices by Gauss-Jordan elimination with partial
+ * pivoting on a copy held on the stack.
+ */
+#define DEFINE_FIXED_INVERT(N)                                                \
+	static void fixed_invert_##N(const double *restrict A,                \
+				     double *restrict X) {                    \
+		double a[N][N], x[N][N];                                      \
+		for (int i = 0; i < N; i++) {                                 \
+			for (int j = 0; j < N; j++) {                         \
+				a[i][j] = A[i * N + j];                       \
+				x[i][j] = i == j ? 1.0 : 0.0;                 \
+			}                                                     \
+		}                                                             \
+		for (int col = 0; col < N; col++) {                           \
+			int p = col;                                          \
+			for (int r = col + 1; r < N; r++)                     \
+				if (fabs(a[r][col]) > fabs(a[p][col])) p = r; \
+			if (p != col) {                                       \
+				for (int j = 0; j < N; j++) {                 \
+					double t = a[p][j];                   \
+					a[p][j] = a[col][j];                  \
+					a[col][j] = t;                        \
+					t = x[p][j];                          \
+					x[p][j] = x[col][j];                  \
+					x[col][j] = t;                        \
+				}                                             \
+			}                                                     \
+			const double inv_pivot = 1.0 / a[col][col];           \
+			for (int j = 0; j < N; j++) {                         \
+				a[col][j] *= inv_pivot;                       \
+				x[col][j] *= inv_pivot;                       \
+			}                                                     \
+			for (int r = 0; r < N; r++) {                         \
+				if (r == col) continue;                       \
+				const double f = a[r][col];                   \
+				for (int j = 0; j < N; j++) {                 \
+					a[r][j] -= f * a[col][j];             \
+					x[r][j] -= f * x[col][j];             \
+				}                                             \
+			}                                                     \
+		}                                                             \
+		for (int i = 0; i < N; i++)                                   \
+			for (int j = 0; j < N; j++) X[i * N + j] = x[i][j];   \
+	}
+
+DEFINE_FIXED_MATMAT(2)
+DEFINE_FIXED_MATMAT(4)
+DEFINE_FIXED_MATMAT(8)
+DEFINE_FIXED_MATMAT(16)
+
+DEFINE_FIXED_INVERT(4)
+DEFINE_FIXED_INVERT(8)
+DEFINE_FIXED_INVERT(16)
+
+int fixed_matmat(const size_t n, const double *const A, const size_t lda,
+		 const double *const B, const size_t ldb, double *C,
+		 const size_t ldc, const int beta) {
+	switch (n) {
+		case 2:
+			fixed_matmat_2(A, lda, B, ldb, C, ldc, beta);
+			return 1;
+		case 4:
+			fixed_matmat_4(A, lda, B, ldb, C, ldc, beta);
+			return 1;
+		case 8:
+			fixed_matmat_8(A, lda, B, ldb, C, ldc, beta);
+			return 1;
+		case 16:
+			fixed_matmat_16(A, lda, B, ldb, C, ldc, beta);
+			return 1;
+		default:
+			return 0;
+	}
+}
+
+int fixed_invert(const size_t n, const double *const A, double *inverse_A) {
+	switch (n) {
+		case 1:
+			inverse_A[0] = 1 / A[0];
+			return 1;
+		case 2: {
+			// Closed form with the adjugate
+			const double inv_det = 1 / (A[0] * A[3] - A[1] * A[2]);
+			inverse_A[0] = A[3] * inv_det;
+			inverse_A[1] = -A[1] * inv_det;
+			inverse_A[2] = -A[2] * inv_det;
+			inverse_A[3] = A[0] * inv_det;
+			return 1;
+		}
+		case 4:
+			fixed_invert_4(A, inverse_A);
+			return 1;
+		case 8:
+			fixed_invert_8(A, inverse_A);
+			return 1;
+		case 16:
+			fixed_invert_16(A, inverse_A);
+			return 1;
+		default:
+			return 0;
+	}
+}
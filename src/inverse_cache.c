@@ -0,0 +1,240 @@
+/*
+ * DESC: Module for an opt-in cache of matrix inverses.
+ * AUTHORS: Thomas Gantz, Laura Paxton, Jan Marxen
+ */
+#include "../include/inverse_cache.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/strassen_inv.h"
+#include "../include/strassen_plan.h"
+
+// The hash loop gets an AVX2 clone, selected at load time on capable CPUs
+#if defined(__GNUC__) && defined(__x86_64__)
+#define SIMD_CLONES __attribute__((target_clones("avx2", "default")))
+#else
+#define SIMD_CLONES
+#endif
+
+#define HASH_LANES 4
+
+// Constants of xxHash64
+#define PRIME1 0x9E3779B185EBCA87ULL
+#define PRIME2 0xC2B2AE3D27D4EB4FULL
+#define PRIME3 0x165667B19E3779F9ULL
+
+// Cached inverse, entries form a list from most to least recently used
+struct cache_entry {
+	struct matrix_fingerprint key;
+	size_t n;
+	double *inverse;
+	struct cache_entry *prev, *next;
+};
+
+struct inverse_cache {
+	pthread_mutex_t lock;
+	size_t budget;
+	struct cache_entry *head, *tail;
+	struct inverse_cache_stats stats;
+};
+
+static uint64_t rotl(const uint64_t x, const int r) {
+	return (x << r) | (x >> (64 - r));
+}
+
+static uint64_t mix(uint64_t h) {
+	h ^= h >> 33;
+	h *= PRIME2;
+	h ^= h >> 29;
+	h *= PRIME3;
+	h ^= h >> 32;
+	return h;
+}
+
+// Lane state after absorbing `count` groups of HASH_LANES doubles, read as
+// their bit patterns
+SIMD_CLONES static void hash_lanes(const double *restrict words,
+				   const size_t count,
+				   uint64_t *restrict lanes) {
+	uint64_t l0 = lanes[0], l1 = lanes[1], l2 = lanes[2], l3 = lanes[3];
+	for (size_t i = 0; i < count; i++) {
+		uint64_t w[HASH_LANES];
+		memcpy(w, words + i * HASH_LANES, sizeof(w));
+		l0 = rotl(l0 + w[0] * PRIME2, 31) * PRIME1;
+		l1 = rotl(l1 + w[1] * PRIME2, 31) * PRIME1;
+		l2 = rotl(l2 + w[2] * PRIME2, 31) * PRIME1;
+		l3 = rotl(l3 + w[3] * PRIME2, 31) * PRIME1;
+	}
+	lanes[0] = l0;
+	lanes[1] = l1;
+	lanes[2] = l2;
+	lanes[3] = l3;
+}
+
+struct matrix_fingerprint matrix_fingerprint(const double *const A,
+					     const size_t m, const size_t n) {
+	// Seeded with the shape, so equal data of another shape differs
+	uint64_t lanes[HASH_LANES] = {PRIME1 + PRIME2, PRIME2 ^ m,
+				      PRIME3 ^ n, (uint64_t)0 - PRIME1};
+	const size_t words = m * n, full = words / HASH_LANES;
+	hash_lanes(A, full, lanes);
+
+	// Remaining words, zero padded
+	double tail[HASH_LANES] = {0};
+	memcpy(tail, A + full * HASH_LANES,
+	       (words - full * HASH_LANES) * sizeof(double));
+	hash_lanes(tail, 1, lanes);
+
+	struct matrix_fingerprint f;
+	f.lo = mix(rotl(lanes[0], 1) + rotl(lanes[1], 7) +
+		   rotl(lanes[2], 12) + rotl(lanes[3], 18));
+	f.hi = mix(lanes[0] ^ rotl(lanes[1], 29) ^ rotl(lanes[2], 41) ^
+		   rotl(lanes[3], 53) ^ f.lo);
+	return f;
+}
+
+struct inverse_cache *inverse_cache_create(const size_t byte_budget) {
+	struct inverse_cache *cache = calloc(1, sizeof(struct inverse_cache));
+	if (cache == NULL) return NULL;
+	pthread_mutex_init(&cache->lock, NULL);
+	cache->budget = byte_budget;
+	return cache;
+}
+
+static void free_entry(struct cache_entry *entry) {
+	free(entry->inverse);
+	free(entry);
+}
+
+void inverse_cache_destroy(struct inverse_cache *cache) {
+	if (cache == NULL) return;
+	for (struct cache_entry *e = cache->head, *next; e != NULL; e = next) {
+		next = e->next;
+		free_entry(e);
+	}
+	pthread_mutex_destroy(&cache->lock);
+	free(cache);
+}
+
+static size_t entry_bytes(const size_t n) { return n * n * sizeof(double); }
+
+static void unlink_entry(struct inverse_cache *cache,
+			 struct cache_entry *entry) {
+	if (entry->prev != NULL)
+		entry->prev->next = entry->next;
+	else
+		cache->head = entry->next;
+	if (entry->next != NULL)
+		entry->next->prev = entry->prev;
+	else
+		cache->tail = entry->prev;
+}
+
+static void push_front(struct inverse_cache *cache,
+		       struct cache_entry *entry) {
+	entry->prev = NULL;
+	entry->next = cache->head;
+	if (cache->head != NULL) cache->head->prev = entry;
+	cache->head = entry;
+	if (cache->tail == NULL) cache->tail = entry;
+}
+
+// Copy the cached inverse of the matrix with fingerprint key into out and
+// mark it as most recently used. Called with the lock held.
+// Return: 1 on a hit, 0 on a miss.
+static int lookup(struct inverse_cache *cache,
+		  const struct matrix_fingerprint key, const size_t n,
+		  double *out) {
+	for (struct cache_entry *e = cache->head; e != NULL; e = e->next) {
+		if (e->n != n || e->key.lo != key.lo || e->key.hi != key.hi)
+			continue;
+		memcpy(out, e->inverse, entry_bytes(n));
+		unlink_entry(cache, e);
+		push_front(cache, e);
+		cache->stats.hits++;
+		return 1;
+	}
+	cache->stats.misses++;
+	return 0;
+}
+
+// Add a copy of inverse under key, evicting least recently used entries
+// until it fits. Called with the lock held.
+static void insert(struct inverse_cache *cache,
+		   const struct matrix_fingerprint key, const size_t n,
+		   const double *const inverse) {
+	const size_t bytes = entry_bytes(n);
+	if (bytes > cache->budget) return;
+	for (struct cache_entry *e = cache->head; e != NULL; e = e->next)
+		if (e->n == n && e->key.lo == key.lo && e->key.hi == key.hi)
+			return;	 // added by another thread meanwhile
+
+	struct cache_entry *entry = malloc(sizeof(struct cache_entry));
+	double *copy = malloc(bytes);
+	if (entry == NULL || copy == NULL) {
+		free(entry);
+		free(copy);
+		return;
+	}
+	while (cache->stats.bytes + bytes > cache->budget) {
+		struct cache_entry *victim = cache->tail;
+		unlink_entry(cache, victim);
+		cache->stats.bytes -= entry_bytes(victim->n);
+		cache->stats.entries--;
+		cache->stats.evictions++;
+		free_entry(victim);
+	}
+	memcpy(copy, inverse, bytes);
+	*entry = (struct cache_entry){.key = key, .n = n, .inverse = copy};
+	push_front(cache, entry);
+	cache->stats.bytes += bytes;
+	cache->stats.entries++;
+}
+
+// A singular input or a vanishing leading block leaves NaN or Inf entries
+static int all_finite(const double *const A, const size_t count) {
+	for (size_t i = 0; i < count; i++)
+		if (!isfinite(A[i])) return 0;
+	return 1;
+}
+
+int inverse_cache_invert(struct inverse_cache *cache, const double *const A,
+			 double *inverse_A, const size_t n) {
+	const struct matrix_fingerprint key = matrix_fingerprint(A, n, n);
+	pthread_mutex_lock(&cache->lock);
+	const int hit = lookup(cache, key, n, inverse_A);
+	pthread_mutex_unlock(&cache->lock);
+	if (hit) return 0;
+
+	// Invert outside of the lock, other threads can use the cache
+	if (strassen_invert(A, inverse_A, n) != 0) return -1;
+	if (!all_finite(inverse_A, n * n)) return -1;  // never cached
+	pthread_mutex_lock(&cache->lock);
+	insert(cache, key, n, inverse_A);
+	pthread_mutex_unlock(&cache->lock);
+	return 0;
+}
+
+int inverse_cache_solve(struct inverse_cache *cache, const double *const A,
+			const double *const B, double *X, const size_t n,
+			const size_t k) {
+	double *inverse_A = malloc(entry_bytes(n));
+	struct strassen_plan *plan = strassen_plan(n, n, k, NULL);
+	int status = inverse_A != NULL && plan != NULL ? 0 : -1;
+	if (status == 0)
+		status = inverse_cache_invert(cache, A, inverse_A, n);
+	if (status == 0) strassen_execute(plan, inverse_A, B, X);
+	free(inverse_A);
+	strassen_plan_destroy(plan);
+	return status;
+}
+
+struct inverse_cache_stats inverse_cache_stats(struct inverse_cache *cache) {
+	pthread_mutex_lock(&cache->lock);
+	const struct inverse_cache_stats stats = cache->stats;
+	pthread_mutex_unlock(&cache->lock);
+	return stats;
+}
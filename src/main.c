@@ -5,20 +5,64 @@
 
 #include <math.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
 #include "../include/IO.h"
+#include "../include/perf_counters.h"
+#include "../include/profile.h"
 #include "../include/test.h"
 
+// Append the counters of the test that just ran, if counters are enabled
+static void write_perf(FILE *file, const size_t i, const char *name,
+		       const double time, const double flops) {
+	if (file == NULL) return;
+	const struct perf_sample *s = perf_last();
+	const struct perf_metrics d = perf_derive(s, flops);
+	fprintf(file, "%zu %s %lf", i, name, time);
+	for (int c = 0; c < PERF_NUM_COUNTERS; c++)
+		fprintf(file, s->valid[c] ? " %llu" : " -1",
+			(unsigned long long)s->values[c]);
+	fprintf(file, " %lf %lf %lf %le %le %le %le\n", d.ipc, d.bytes,
+		d.flops_per_byte, d.l1d_misses_per_flop, d.llc_misses_per_flop,
+		d.dtlb_misses_per_flop, d.bandwidth);
+}
+
+// Columns of the *_perf.txt files
+static const char perf_header[] =
+    "# i name time cycles instructions l1d_misses llc_misses dtlb_misses "
+    "ipc bytes flops_per_byte l1d_per_flop llc_per_flop dtlb_per_flop "
+    "bandwidth\n";
+
 int main(int argc, char *argv[]) {
 	size_t N = 5;  // default max power dimension of matrix
-
-	// Check if an argument is provided for N
-	if (argc > 1) {
-		N = strtoul(argv[1], NULL, 10);
+	const char *trace_path = NULL;	// optional Chrome trace output
+	int perf = 0;			// collect hardware counters
+	uint64_t seed = time(NULL);	// seed of the test matrices
+
+	// Parse options and the optional positional argument N
+	for (int arg = 1; arg < argc; arg++) {
+		if (strncmp(argv[arg], "--trace=", 8) == 0) {
+			trace_path = argv[arg] + 8;
+			continue;
+		}
+		if (strcmp(argv[arg], "--perf") == 0) {
+			perf = 1;
+			continue;
+		}
+		if (strncmp(argv[arg], "--seed=", 7) == 0) {
+			seed = strtoull(argv[arg] + 7, NULL, 10);
+			continue;
+		}
+		if (strcmp(argv[arg], "--verify=freivalds") == 0) {
+			// Check results in O(n^2) instead of recomputing them
+			set_verify_mode(VERIFY_FREIVALDS);
+			continue;
+		}
+		N = strtoul(argv[arg], NULL, 10);
 		if (N == 0) {  // Handle invalid input
 			fprintf(stderr,
 				"Invalid input for N. Please provide a "
@@ -26,15 +70,37 @@ int main(int argc, char *argv[]) {
 			return EXIT_FAILURE;
 		}
 	}
+#ifndef STRASSEN_PROFILE
+	if (trace_path != NULL)
+		fprintf(stderr,
+			"--trace ignored, build with -DSTRASSEN_PROFILE=ON\n");
+#endif
 
 	double tolerance = 1e-3;  // Set test tolerance level
-	srand(time(
-	    NULL));  // Seed the random number generator with the current time
+	const uint64_t prime = 2147483647;  // Modulus of the exact tests
+	// Seed the random number generators, printed to repeat the run
+	srand(seed);
+	set_test_seed(seed);
+	printf("Seed: %llu (repeat with --seed=%llu)\n\n",
+	       (unsigned long long)seed, (unsigned long long)seed);
 
 	// Open files to save test results for plotting
 	FILE *file_matmat = fopen("matmat.txt", "w");
 	FILE *file_matinv = fopen("matinv.txt", "w");
 
+	// Counters of every test, one line per test, if requested
+	FILE *perf_matmat = NULL, *perf_matinv = NULL;
+	if (perf) {
+		if (perf_open() != 0)
+			fprintf(stderr,
+				"--perf: hardware counters unavailable, check "
+				"/proc/sys/kernel/perf_event_paranoid\n");
+		perf_matmat = fopen("matmat_perf.txt", "w");
+		perf_matinv = fopen("matinv_perf.txt", "w");
+		if (perf_matmat != NULL) fputs(perf_header, perf_matmat);
+		if (perf_matinv != NULL) fputs(perf_header, perf_matinv);
+	}
+
 	for (size_t i = 2; i <= N; i++) {
 		const size_t n =
 		    pow(2, i) - 1;  // Determine the size of test matrices (not
@@ -51,6 +117,7 @@ int main(int argc, char *argv[]) {
 		// Initialize data for matrix multiplication
 		const size_t m = n + 1;
 		const size_t k = n - 1;
+		const double flops_mul = 2.0 * m * n * k;  // classical count
 		double *A_mul = malloc(m * n * sizeof(double));
 		double *B_mul = malloc(n * k * sizeof(double));
 
@@ -64,6 +131,8 @@ int main(int argc, char *argv[]) {
 		// Perform naive matrix multiplication test
 		double naive_time =
 		    test_naive_matmat(&A_mul, &B_mul, m, n, k, tolerance);
+		write_perf(perf_matmat, i, "naive_matmat", naive_time,
+			   flops_mul);
 
 		// Flush cache to ensure fair timing
 		flush_cache();
@@ -71,15 +140,123 @@ int main(int argc, char *argv[]) {
 		// Perform Strassen matrix multiplication test
 		double strassen_time =
 		    test_strassen_matmat(&A_mul, &B_mul, m, n, k, tolerance);
+		write_perf(perf_matmat, i, "strassen_matmat", strassen_time,
+			   flops_mul);
+
+		// Flush cache to ensure fair timing
+		flush_cache();
+
+		// Perform the planned Strassen matrix multiplication test
+		double execute_time =
+		    test_strassen_execute(A_mul, B_mul, m, n, k, tolerance);
+		write_perf(perf_matmat, i, "strassen_execute", execute_time,
+			   flops_mul);
+
+		// Flush cache to ensure fair timing
+		flush_cache();
+
+		// Multiply one prepared left operand with several right ones
+		const size_t operands = 4;
+		double prepared_time = test_strassen_prepared(
+		    A_mul, m, n, k, operands, tolerance);
+		write_perf(perf_matmat, i, "strassen_execute_prepared",
+			   prepared_time, operands * flops_mul);
+
+		// Flush cache to ensure fair timing
+		flush_cache();
+
+		// Perform concurrent multiplications on the shared executor
+		const size_t jobs = 8;
+		double executor_time = test_executor_matmat(
+		    A_mul, B_mul, m, n, k, jobs, tolerance);
+		write_perf(perf_matmat, i, "executor", executor_time,
+			   jobs * flops_mul);
+
+		// Perform the multiplication with a relative error target
+		const double target = 1e-6;
+		double tol_time =
+		    test_strassen_matmat_tol(A_mul, B_mul, m, n, k, target);
+		write_perf(perf_matmat, i, "strassen_matmat_tol", tol_time,
+			   flops_mul);
+
+		flush_cache();
+
+		// Perform the symmetric product A*A^T, lower triangle only
+		double syrk_time = test_strassen_syrk(A_mul, m, n, tolerance);
+		write_perf(perf_matmat, i, "strassen_syrk", syrk_time,
+			   (double)m * m * n);
+
+		flush_cache();
+
+		// Perform concurrent reentrant multiplications on shared
+		// read-only operands
+		const size_t threads = 4;
+		double shared_time = test_strassen_matmat_r(
+		    A_mul, B_mul, m, n, k, threads, tolerance);
+		write_perf(perf_matmat, i, "strassen_matmat_r", shared_time,
+			   threads * flops_mul);
+
+		// Perform a chain product and a matrix power
+		double chain_time =
+		    test_strassen_chain(A_mul, B_mul, m, n, k, tolerance);
+		write_perf(perf_matmat, i, "strassen_chain", chain_time,
+			   flops_mul + 2.0 * m * k * n + 2.0 * m * n * m);
+		const unsigned long exponent = 10;
+		double power_time =
+		    test_strassen_power(A_mul, n, exponent, tolerance);
+		// Binary powering: one squaring per bit, one product per set
+		// bit after the first
+		const double products = floor(log2((double)exponent)) +
+					__builtin_popcountl(exponent) - 1;
+		write_perf(perf_matmat, i, "strassen_power", power_time,
+			   products * 2.0 * n * n * n);
+
+		// Perform the exact integer and modular multiplications
+		double i64_time = test_strassen_matmat_i64(m, n, k);
+		write_perf(perf_matmat, i, "strassen_matmat_i64", i64_time,
+			   flops_mul);
+		double mod_time = test_strassen_matmat_mod(m, n, k, prime);
+		write_perf(perf_matmat, i, "strassen_matmat_mod", mod_time,
+			   flops_mul);
+
+		// Complex product with three real products (3M method)
+		double zmatmat_time = test_strassen_zmatmat(m, n, k, tolerance);
+		write_perf(perf_matmat, i, "strassen_zmatmat", zmatmat_time,
+			   4.0 * flops_mul);
+
+		// Generate test data with the counter-based generator
+		double gen_time = test_gen_matrix(n);
+		write_perf(perf_matmat, i, "gen_matrix", gen_time, 0.0);
 
 		// Output the test results to console
 		printf("- naive_matmat :    %.5lf\n", naive_time);
 		printf("- strassen_matmat : %.5lf\n", strassen_time);
+		printf("- strassen_execute: %.5lf\n", execute_time);
+		printf("- strassen_execute_prepared (per B of %zu): %.5lf\n",
+		       operands, prepared_time);
+		printf("- executor (%zu jobs): %.5lf\n", jobs, executor_time);
+		printf("- strassen_matmat_tol (%.0e): %.5lf\n", target,
+		       tol_time);
+		printf("- strassen_syrk :   %.5lf\n", syrk_time);
+		printf("- strassen_matmat_r (%zu threads): %.5lf\n", threads,
+		       shared_time);
+		printf("- strassen_chain :  %.5lf\n", chain_time);
+		printf("- strassen_power (e = %lu): %.5lf\n", exponent,
+		       power_time);
+		printf("- strassen_matmat_i64 : %.5lf\n", i64_time);
+		printf("- strassen_matmat_mod : %.5lf\n", mod_time);
+		printf("- strassen_zmatmat (3M) : %.5lf\n", zmatmat_time);
+		printf("- gen_matrix (test data) : %.5lf\n", gen_time);
 		printf("\n");
 
 		// Write test results to the corresponding file
-		fprintf(file_matmat, "%zu %lf %lf\n", i, naive_time,
-			strassen_time);
+		fprintf(file_matmat,
+			"%zu %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf "
+			"%lf %lf\n",
+			i, naive_time, strassen_time, execute_time,
+			executor_time, chain_time, power_time, i64_time,
+			mod_time, shared_time, tol_time, syrk_time, gen_time,
+			zmatmat_time, prepared_time);
 
 		// Free allocated memory for matrix multiplication
 		free(A_mul);
@@ -90,17 +267,8 @@ int main(int argc, char *argv[]) {
 
 		// Initialize a random invertible matrix A
 		double *A = malloc(n * n * sizeof(double));
-		gen_rand_matrix(A, n, n);
-		int invertible = 0;
-		double *A_copy = malloc(n * n * sizeof(double));
-
-		// Ensure matrix A is invertible
-		while (!invertible) {
-			gen_rand_matrix(A, n, n);
-			memcpy(A_copy, A, n * n * sizeof(double));
-			invertible = is_invertible(A_copy, n);
-		}
-		free(A_copy);
+		gen_invertible_matrix(A, n);
+		const double flops_inv = 2.0 * n * n * n;  // classical count
 
 		// Flush cache to ensure fair timing
 		flush_cache();
@@ -108,6 +276,8 @@ int main(int argc, char *argv[]) {
 		// Perform Strassen inversion with naive matrix multiplication
 		double time_strassen_invert_naive_matmat =
 		    test_strassen_invert_naive_matmat(&A, n, tolerance);
+		write_perf(perf_matinv, i, "strassen_invert_naive_matmat",
+			   time_strassen_invert_naive_matmat, flops_inv);
 
 		flush_cache();
 
@@ -115,11 +285,97 @@ int main(int argc, char *argv[]) {
 		// multiplication
 		double time_strassen_invert_strassen_matmat =
 		    test_strassen_invert_strassen_matmat(&A, n, tolerance);
+		write_perf(perf_matinv, i, "strassen_invert_strassen_matmat",
+			   time_strassen_invert_strassen_matmat, flops_inv);
 
 		flush_cache();
 
 		// Perform LU-based inversion
 		double time_lu_invert = test_lu_invert(A, n, tolerance);
+		write_perf(perf_matinv, i, "lu_invert", time_lu_invert,
+			   flops_inv);
+
+		flush_cache();
+
+		// Invert with the determinant and condition number as
+		// by-products
+		double time_strassen_invert_info =
+		    test_strassen_invert_info(A, n, tolerance);
+		write_perf(perf_matinv, i, "strassen_invert_info",
+			   time_strassen_invert_info, flops_inv);
+
+		flush_cache();
+
+		// Perform Strassen inversion of a triangular matrix, whose
+		// zero blocks are skipped
+		double time_strassen_invert_triangular =
+		    test_strassen_invert_triangular(n, tolerance);
+		write_perf(perf_matinv, i, "strassen_invert_triangular",
+			   time_strassen_invert_triangular, flops_inv);
+
+		flush_cache();
+
+		// Perform the Cholesky based inversion of an SPD matrix
+		double time_strassen_invert_spd =
+		    test_strassen_invert_spd(n, tolerance);
+		write_perf(perf_matinv, i, "strassen_invert_spd",
+			   time_strassen_invert_spd, flops_inv);
+
+		flush_cache();
+
+		// Perform the exact inversion modulo a prime
+		double time_strassen_invert_mod =
+		    test_strassen_invert_mod(n, prime);
+		write_perf(perf_matinv, i, "strassen_invert_mod",
+			   time_strassen_invert_mod, flops_inv);
+
+		flush_cache();
+
+		// Update an inverse by a low-rank correction and by k new rows
+		// and columns
+		const size_t rank = n / 8 + 1;
+		double time_strassen_update_inverse =
+		    test_strassen_update_inverse(n, rank, tolerance);
+		write_perf(perf_matinv, i, "strassen_update_inverse",
+			   time_strassen_update_inverse, 6.0 * n * n * rank);
+		double time_strassen_border_inverse =
+		    test_strassen_border_inverse(n, rank, tolerance);
+		write_perf(perf_matinv, i, "strassen_border_inverse",
+			   time_strassen_border_inverse, 6.0 * n * n * rank);
+
+		flush_cache();
+
+		// Repeat an inversion through the inverse cache
+		double time_inverse_cache = test_inverse_cache(n, tolerance);
+		write_perf(perf_matinv, i, "inverse_cache", time_inverse_cache,
+			   0.0);
+
+		flush_cache();
+
+		// Invert a complex matrix with 3M products
+		double time_strassen_zinvert =
+		    test_strassen_zinvert(n, tolerance);
+		write_perf(perf_matinv, i, "strassen_zinvert",
+			   time_strassen_zinvert, 4.0 * flops_inv);
+
+		flush_cache();
+
+		// Invert within the smallest scratch memory possible
+		double time_strassen_budget =
+		    test_strassen_budget(n, tolerance);
+		write_perf(perf_matinv, i, "strassen_invert_budget",
+			   time_strassen_budget, flops_inv);
+
+		flush_cache();
+
+		// Solve A*X = B for n right-hand sides on the executor
+		double *B = malloc(n * n * sizeof(double));
+		gen_rand_matrix(B, n, n);
+		double time_executor_solve =
+		    test_executor_solve(A, B, n, n, tolerance);
+		write_perf(perf_matinv, i, "executor_solve",
+			   time_executor_solve, flops_inv + 2.0 * n * n * n);
+		free(B);
 
 		// Output results to console
 		printf("- strassen_invert_naive_matmat :    %.5lf\n",
@@ -128,12 +384,40 @@ int main(int argc, char *argv[]) {
 		       time_strassen_invert_strassen_matmat);
 		printf("- lu_invert :                       %.5lf\n",
 		       time_lu_invert);
+		printf("- executor_solve :                  %.5lf\n",
+		       time_executor_solve);
+		printf("- strassen_invert (triangular) :    %.5lf\n",
+		       time_strassen_invert_triangular);
+		printf("- strassen_invert_spd :             %.5lf\n",
+		       time_strassen_invert_spd);
+		printf("- strassen_invert_mod :             %.5lf\n",
+		       time_strassen_invert_mod);
+		printf("- strassen_update_inverse (k = %zu) : %.5lf\n", rank,
+		       time_strassen_update_inverse);
+		printf("- strassen_border_inverse (k = %zu) : %.5lf\n", rank,
+		       time_strassen_border_inverse);
+		printf("- inverse_cache (hit) :             %.5lf\n",
+		       time_inverse_cache);
+		printf("- strassen_invert_budget (min) :    %.5lf\n",
+		       time_strassen_budget);
+		printf("- strassen_invert_info (det) :      %.5lf\n",
+		       time_strassen_invert_info);
+		printf("- strassen_zinvert (complex) :      %.5lf\n",
+		       time_strassen_zinvert);
 		printf("\n");
 
 		// Write test results to file
-		fprintf(file_matinv, "%zu %lf %lf %lf\n", i, time_lu_invert,
-			time_strassen_invert_naive_matmat,
-			time_strassen_invert_strassen_matmat);
+		fprintf(file_matinv,
+			"%zu %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf "
+			"%lf\n",
+			i, time_lu_invert, time_strassen_invert_naive_matmat,
+			time_strassen_invert_strassen_matmat,
+			time_executor_solve, time_strassen_invert_triangular,
+			time_strassen_invert_spd, time_strassen_invert_mod,
+			time_strassen_update_inverse,
+			time_strassen_border_inverse, time_inverse_cache,
+			time_strassen_budget, time_strassen_invert_info,
+			time_strassen_zinvert);
 
 		free(A);
 	}
@@ -141,5 +425,16 @@ int main(int argc, char *argv[]) {
 	// Close the opened files
 	fclose(file_matinv);
 	fclose(file_matmat);
+	if (perf_matinv != NULL) fclose(perf_matinv);
+	if (perf_matmat != NULL) fclose(perf_matmat);
+	perf_close();
+
+#ifdef STRASSEN_PROFILE
+	// Report where time went inside the recursive routines
+	printf("### Profile per recursion level\n");
+	prof_print_summary(stdout);
+	if (trace_path != NULL && prof_export_chrome_trace(trace_path) != 0)
+		fprintf(stderr, "Could not write trace to %s\n", trace_path);
+#endif
 }
 
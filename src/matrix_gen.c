@@ -0,0 +1,232 @@
+/*
+ * DESC: Module for reproducible random test matrices.
+ * AUTHORS: Thomas Gantz, Laura Paxton, Jan Marxen
+ */
+#include "../include/matrix_gen.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// The generator loop gets an AVX2 clone, selected at load time on capable
+// CPUs
+#if defined(__GNUC__) && defined(__x86_64__)
+#define SIMD_CLONES __attribute__((target_clones("avx2", "default")))
+#else
+#define SIMD_CLONES
+#endif
+
+// Entries per thread below which starting a thread does not pay off
+#define GEN_PARALLEL_MIN (1 << 16)
+
+// Increment of SplitMix64
+#define GAMMA 0x9E3779B97F4A7C15ULL
+
+// Finalizer of SplitMix64, a bijection that mixes every input bit into
+// every output bit
+static inline uint64_t mix64(uint64_t z) {
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+// Key of the stream `seed`, so that neighbouring seeds give unrelated
+// streams
+static uint64_t stream_key(const uint64_t seed) { return mix64(seed ^ GAMMA); }
+
+// Entry i of the stream with `key` as 64 random bits
+static inline uint64_t bits(const uint64_t key, const uint64_t i) {
+	return mix64(key + (i + 1) * GAMMA);
+}
+
+// Entry i of the stream with `key`, uniform in [-1, 1)
+static inline double uniform(const uint64_t key, const uint64_t i) {
+	return (double)(bits(key, i) >> 11) * 0x1p-52 - 1.0;
+}
+
+SIMD_CLONES static void fill_bits(uint64_t *restrict A, const uint64_t key,
+				  const size_t begin, const size_t end) {
+	for (size_t i = begin; i < end; i++) A[i - begin] = bits(key, i);
+}
+
+SIMD_CLONES static void fill_uniform(double *restrict A, const uint64_t key,
+				     const size_t begin, const size_t end) {
+	for (size_t i = begin; i < end; i++) A[i - begin] = uniform(key, i);
+}
+
+// Fill rows [begin, end) of the output, `arg` holds the generator state
+typedef void (*gen_rows)(void *arg, const size_t begin, const size_t end);
+
+struct gen_job {
+	gen_rows rows;
+	void *arg;
+	size_t begin, end;
+	pthread_t id;
+	int started;
+};
+
+static void *run_job(void *arg) {
+	const struct gen_job *job = arg;
+	job->rows(job->arg, job->begin, job->end);
+	return NULL;
+}
+
+// Split `count` rows of `width` entries over the threads. Every entry is a
+// function of its position only, so the split does not change the output.
+static void parallel_rows(const gen_rows rows, void *arg, const size_t count,
+			  const size_t width, size_t threads) {
+	if (threads == 0) {
+		const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		threads = cpus > 0 ? (size_t)cpus : 1;
+	}
+	const size_t useful = count * width / GEN_PARALLEL_MIN;
+	if (threads > useful) threads = useful;
+	struct gen_job *jobs =
+	    threads > 1 ? calloc(threads, sizeof(struct gen_job)) : NULL;
+	if (jobs == NULL) {
+		rows(arg, 0, count);
+		return;
+	}
+
+	// Rows of a thread that cannot be started run on the calling thread
+	for (size_t t = 0; t < threads; t++) {
+		jobs[t] = (struct gen_job){.rows = rows,
+					   .arg = arg,
+					   .begin = count * t / threads,
+					   .end = count * (t + 1) / threads};
+		if (t == 0) continue;
+		jobs[t].started =
+		    pthread_create(&jobs[t].id, NULL, run_job, &jobs[t]) == 0;
+	}
+	for (size_t t = 0; t < threads; t++)
+		if (!jobs[t].started) run_job(&jobs[t]);
+	for (size_t t = 1; t < threads; t++)
+		if (jobs[t].started) pthread_join(jobs[t].id, NULL);
+	free(jobs);
+}
+
+struct uniform_state {
+	double *A;
+	uint64_t key;
+};
+
+static void uniform_rows(void *arg, const size_t begin, const size_t end) {
+	const struct uniform_state *s = arg;
+	fill_uniform(s->A + begin, s->key, begin, end);
+}
+
+void gen_uniform(double *A, const size_t count, const uint64_t seed,
+		 const size_t threads) {
+	struct uniform_state s = {A, stream_key(seed)};
+	parallel_rows(uniform_rows, &s, count, 1, threads);
+}
+
+struct bits_state {
+	uint64_t *A;
+	uint64_t key;
+};
+
+static void bits_rows(void *arg, const size_t begin, const size_t end) {
+	const struct bits_state *s = arg;
+	fill_bits(s->A + begin, s->key, begin, end);
+}
+
+void gen_bits(uint64_t *A, const size_t count, const uint64_t seed,
+	      const size_t threads) {
+	struct bits_state s = {A, stream_key(seed)};
+	parallel_rows(bits_rows, &s, count, 1, threads);
+}
+
+struct square_state {
+	double *A;
+	size_t n;
+	uint64_t key;
+};
+
+static void well_conditioned_rows(void *arg, const size_t begin,
+				  const size_t end) {
+	const struct square_state *s = arg;
+	const size_t n = s->n;
+	for (size_t i = begin; i < end; i++) {
+		fill_uniform(s->A + i * n, s->key, i * n, (i + 1) * n);
+		s->A[i * n + i] += (double)(n + 1);
+	}
+}
+
+void gen_well_conditioned(double *A, const size_t n, const uint64_t seed,
+			  const size_t threads) {
+	struct square_state s = {A, n, stream_key(seed)};
+	parallel_rows(well_conditioned_rows, &s, n, n, threads);
+}
+
+// Entry (i, j) for j < i is the one of (j, i), both are computed from the
+// upper triangle's position
+static void spd_rows(void *arg, const size_t begin, const size_t end) {
+	const struct square_state *s = arg;
+	const size_t n = s->n;
+	for (size_t i = begin; i < end; i++) {
+		double *row = s->A + i * n;
+		for (size_t j = 0; j < i; j++)
+			row[j] = uniform(s->key, j * n + i);
+		fill_uniform(row + i, s->key, i * n + i, (i + 1) * n);
+		row[i] = fabs(row[i]) + (double)n;
+	}
+}
+
+void gen_spd(double *A, const size_t n, const uint64_t seed,
+	     const size_t threads) {
+	struct square_state s = {A, n, stream_key(seed)};
+	parallel_rows(spd_rows, &s, n, n, threads);
+}
+
+// A = H1 * D * H2 with H = I - 2 v v^T / (v^T v), entry by entry as
+// A_ij = d_i (delta_ij - c2 v2_i v2_j) - c1 v1_i w_j, w = (D H2)^T v1
+struct conditioned_state {
+	double *A;
+	size_t n;
+	const double *d, *v1, *v2, *w;
+	double c1, c2;
+};
+
+static void conditioned_rows(void *arg, const size_t begin,
+			     const size_t end) {
+	const struct conditioned_state *s = arg;
+	const size_t n = s->n;
+	for (size_t i = begin; i < end; i++) {
+		double *row = s->A + i * n;
+		const double a = s->d[i] * s->c2 * s->v2[i];
+		const double b = s->c1 * s->v1[i];
+		for (size_t j = 0; j < n; j++)
+			row[j] = -a * s->v2[j] - b * s->w[j];
+		row[i] += s->d[i];
+	}
+}
+
+int gen_conditioned(double *A, const size_t n, const double cond,
+		    const uint64_t seed, const size_t threads) {
+	if (n == 0) return 0;
+	double *buf = malloc(4 * n * sizeof(double));
+	if (buf == NULL) return -1;
+	double *d = buf, *v1 = buf + n, *v2 = buf + 2 * n, *w = buf + 3 * n;
+
+	// Reflection vectors from the first 2n entries of the stream
+	const uint64_t key = stream_key(seed);
+	fill_uniform(v1, key, 0, n);
+	fill_uniform(v2, key, n, 2 * n);
+	double s1 = 0.0, s2 = 0.0, dv = 0.0;
+	for (size_t i = 0; i < n; i++) {
+		d[i] = n > 1 ? pow(cond, -(double)i / (double)(n - 1)) : 1.0;
+		s1 += v1[i] * v1[i];
+		s2 += v2[i] * v2[i];
+		dv += v1[i] * d[i] * v2[i];
+	}
+	const double c1 = s1 > 0.0 ? 2.0 / s1 : 0.0;
+	const double c2 = s2 > 0.0 ? 2.0 / s2 : 0.0;
+	for (size_t j = 0; j < n; j++) w[j] = v1[j] * d[j] - c2 * dv * v2[j];
+
+	struct conditioned_state s = {A, n, d, v1, v2, w, c1, c2};
+	parallel_rows(conditioned_rows, &s, n, n, threads);
+	free(buf);
+	return 0;
+}
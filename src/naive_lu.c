@@ -4,11 +4,14 @@
  */
 #include "naive_lu.h"
 
+#include <float.h>
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "../include/IO.h"
+#include "../include/block_utilities.h"
 
 // Initialize T with a copy of matrix A
 static void init_T(const double *A, double *T, const size_t n) {
@@ -37,12 +40,9 @@ void lu_decomposition(const double *const A, double *T, const size_t n) {
 	}
 }
 
-// Compute the inverse of matrix A using its LU decomposition
-void lu_invert(const double *const A, double *inverse_A, const size_t n) {
-	double *T = (double *)malloc(sizeof(double) * n *
-				     n);  // Allocate space for LU matrix
-	lu_decomposition(A, T, n);	  // Perform LU decomposition
-
+// Compute the inverse of a matrix from its LU decomposition T
+static void invert_from_lu(const double *const T, double *inverse_A,
+			   const size_t n) {
 	double *temp = (double *)malloc(
 	    sizeof(double) * n);  // Temporary storage for solving equations
 
@@ -78,7 +78,90 @@ void lu_invert(const double *const A, double *inverse_A, const size_t n) {
 		}
 	}
 
-	free(T);
 	free(temp);
 }
 
+// Compute the inverse of matrix A using its LU decomposition
+void lu_invert(const double *const A, double *inverse_A, const size_t n) {
+	double *T = (double *)malloc(sizeof(double) * n *
+				     n);  // Allocate space for LU matrix
+	lu_decomposition(A, T, n);	  // Perform LU decomposition
+	invert_from_lu(T, inverse_A, n);
+	free(T);
+}
+
+void lu_invert_info(const double *const A, double *inverse_A, const size_t n,
+		    struct inverse_info *info) {
+	double *T = (double *)malloc(sizeof(double) * n * n);
+	lu_decomposition(A, T, n);
+
+	// det(A) = det(U), the product of the pivots on the diagonal of T
+	*info = (struct inverse_info){.det_sign = 1, .log_abs_det = 0.0};
+	for (size_t i = 0; i < n; i++) {
+		const double pivot = T[i * n + i];
+		if (pivot == 0.0) {
+			info->det_sign = 0;
+			info->log_abs_det = -INFINITY;
+			break;
+		}
+		if (pivot < 0.0) info->det_sign = -info->det_sign;
+		info->log_abs_det += log(fabs(pivot));
+	}
+
+	invert_from_lu(T, inverse_A, n);
+	free(T);
+	info->cond1 = block_norm1(A, n, n) * block_norm1(inverse_A, n, n);
+}
+
+// Each step scales the pivot row and eliminates its column from every other
+// row, so the column is overwritten by that of the inverse as it goes and no
+// second matrix is needed
+int gauss_jordan_invert(double *S, const size_t k) {
+	size_t *perm = malloc(k * sizeof(size_t));
+	if (perm == NULL) return -1;
+	double norm = 0.0;
+	for (size_t i = 0; i < k * k; i++) norm = fmax(norm, fabs(S[i]));
+	const double tiny = DBL_EPSILON * (double)k * norm;
+
+	int status = 0;
+	for (size_t j = 0; j < k && status == 0; j++) {
+		size_t p = j;
+		for (size_t i = j + 1; i < k; i++)
+			if (fabs(S[i * k + j]) > fabs(S[p * k + j])) p = i;
+		perm[j] = p;
+		if (!(fabs(S[p * k + j]) > tiny)) {  // also catches NaN
+			status = -1;
+			break;
+		}
+		if (p != j)
+			for (size_t l = 0; l < k; l++) {
+				const double t = S[j * k + l];
+				S[j * k + l] = S[p * k + l];
+				S[p * k + l] = t;
+			}
+
+		// Eliminate column j, its entries become those of the inverse
+		const double pivot = 1.0 / S[j * k + j];
+		S[j * k + j] = 1.0;
+		for (size_t l = 0; l < k; l++) S[j * k + l] *= pivot;
+		for (size_t i = 0; i < k; i++) {
+			if (i == j) continue;
+			const double f = S[i * k + j];
+			S[i * k + j] = 0.0;
+			for (size_t l = 0; l < k; l++)
+				S[i * k + l] -= f * S[j * k + l];
+		}
+	}
+
+	// Row swaps of A are column swaps of A^-1, undone in reverse order
+	if (status == 0)
+		for (size_t j = k; j-- > 0;)
+			if (perm[j] != j)
+				for (size_t i = 0; i < k; i++) {
+					const double t = S[i * k + j];
+					S[i * k + j] = S[i * k + perm[j]];
+					S[i * k + perm[j]] = t;
+				}
+	free(perm);
+	return status;
+}
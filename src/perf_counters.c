@@ -0,0 +1,132 @@
+/*
+ * DESC: Module for hardware performance counters around benchmarked calls.
+ * AUTHORS: Thomas Gantz, Laura Paxton, Jan Marxen
+ */
+#include "../include/perf_counters.h"
+
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+
+static int fds[PERF_NUM_COUNTERS] = {-1, -1, -1, -1, -1};
+static uint64_t begin_values[PERF_NUM_COUNTERS];
+static double begin_time;
+static struct perf_sample last;
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + 1e-9 * (double)ts.tv_nsec;
+}
+
+#ifdef __linux__
+// Cache event config: cache | operation << 8 | result << 16
+#define CACHE_EVENT(cache, op, result)                       \
+	((cache) | (PERF_COUNT_HW_CACHE_OP_##op << 8) |      \
+	 (PERF_COUNT_HW_CACHE_RESULT_##result << 16))
+
+static const struct {
+	uint32_t type;
+	uint64_t config;
+} events[PERF_NUM_COUNTERS] = {
+    [PERF_CYCLES] = {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    [PERF_INSTRUCTIONS] = {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    [PERF_L1D_MISSES] = {PERF_TYPE_HW_CACHE,
+			 CACHE_EVENT(PERF_COUNT_HW_CACHE_L1D, READ, MISS)},
+    [PERF_LLC_MISSES] = {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    [PERF_DTLB_MISSES] = {PERF_TYPE_HW_CACHE,
+			  CACHE_EVENT(PERF_COUNT_HW_CACHE_DTLB, READ, MISS)},
+};
+
+static int open_counter(const enum perf_counter counter) {
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = events[counter].type;
+	attr.config = events[counter].config;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	// Count threads created later, e.g. executor workers
+	attr.inherit = 1;
+	attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+			   PERF_FORMAT_TOTAL_TIME_RUNNING;
+	return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+#endif
+
+// Counter value, scaled up if the kernel multiplexed it
+static int read_counter(const int fd, uint64_t *value) {
+	uint64_t buf[3];  // value, time enabled, time running
+	if (read(fd, buf, sizeof(buf)) != (ssize_t)sizeof(buf)) return -1;
+	if (buf[2] != 0 && buf[2] < buf[1])
+		buf[0] = (uint64_t)((double)buf[0] * buf[1] / buf[2]);
+	*value = buf[0];
+	return 0;
+}
+
+int perf_open(void) {
+#ifdef __linux__
+	for (int c = 0; c < PERF_NUM_COUNTERS; c++)
+		if (fds[c] < 0) fds[c] = open_counter(c);
+#endif
+	return fds[PERF_CYCLES] >= 0 ? 0 : -1;
+}
+
+void perf_close(void) {
+	for (int c = 0; c < PERF_NUM_COUNTERS; c++) {
+		if (fds[c] >= 0) close(fds[c]);
+		fds[c] = -1;
+	}
+}
+
+void perf_begin(void) {
+	for (int c = 0; c < PERF_NUM_COUNTERS; c++)
+		if (fds[c] < 0 || read_counter(fds[c], &begin_values[c]) != 0)
+			begin_values[c] = 0;
+	begin_time = now();
+}
+
+void perf_end(void) {
+	last.seconds = now() - begin_time;
+	for (int c = 0; c < PERF_NUM_COUNTERS; c++) {
+		uint64_t value = 0;
+		last.valid[c] = fds[c] >= 0 &&
+				read_counter(fds[c], &value) == 0 &&
+				value >= begin_values[c];
+		last.values[c] = last.valid[c] ? value - begin_values[c] : 0;
+	}
+}
+
+const struct perf_sample *perf_last(void) { return &last; }
+
+// a / b if both are valid and b is positive, -1 otherwise
+static double ratio(const double a, const int valid_a, const double b,
+		    const int valid_b) {
+	return valid_a && valid_b && b > 0 ? a / b : -1.0;
+}
+
+struct perf_metrics perf_derive(const struct perf_sample *sample,
+				const double flops) {
+	const uint64_t *v = sample->values;
+	const int *ok = sample->valid;
+	struct perf_metrics m;
+	m.ipc = ratio(v[PERF_INSTRUCTIONS], ok[PERF_INSTRUCTIONS],
+		      v[PERF_CYCLES], ok[PERF_CYCLES]);
+	m.bytes = ok[PERF_LLC_MISSES]
+		      ? (double)v[PERF_LLC_MISSES] * PERF_LINE_BYTES
+		      : -1.0;
+	m.bandwidth = ratio(m.bytes, m.bytes >= 0, sample->seconds, 1);
+	m.flops_per_byte = ratio(flops, 1, m.bytes, m.bytes >= 0);
+	m.l1d_misses_per_flop =
+	    ratio(v[PERF_L1D_MISSES], ok[PERF_L1D_MISSES], flops, 1);
+	m.llc_misses_per_flop =
+	    ratio(v[PERF_LLC_MISSES], ok[PERF_LLC_MISSES], flops, 1);
+	m.dtlb_misses_per_flop =
+	    ratio(v[PERF_DTLB_MISSES], ok[PERF_DTLB_MISSES], flops, 1);
+	return m;
+}
@@ -0,0 +1,213 @@
+/*
+ * DESC: Module for per-recursion-level instrumentation.
+ * AUTHORS: Thomas Gantz, Laura Paxton, Jan Marxen
+ */
+#include "../include/profile.h"
+
+#ifdef STRASSEN_PROFILE
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Maximal number of trace events kept, later events are only counted
+#define PROF_MAX_EVENTS (1 << 20)
+
+static const char *const phase_names[PROF_NUM_PHASES] = {
+    "call", "copy", "add", "leaf", "alloc"};
+
+struct prof_event {
+	const char *name;
+	uint64_t start;
+	uint64_t end;
+	size_t m, n, k;	 // dimensions of a call, bytes of a phase in m
+	int level;
+	int tid;
+	int is_call;
+};
+
+// Accumulated statistics per level and phase
+static atomic_uint_fast64_t stat_ns[PROF_MAX_LEVELS][PROF_NUM_PHASES];
+static atomic_uint_fast64_t stat_calls[PROF_MAX_LEVELS][PROF_NUM_PHASES];
+static atomic_uint_fast64_t stat_bytes[PROF_MAX_LEVELS][PROF_NUM_PHASES];
+
+// Trace buffer, allocated on first use
+static struct prof_event *events = NULL;
+static atomic_size_t num_events = 0;
+static atomic_int num_threads = 0;
+static atomic_uint_fast64_t time_origin = 0;
+
+// Recursion level and trace id of the calling thread
+static _Thread_local int depth = 0;
+static _Thread_local int tid = -1;
+
+static struct prof_event *new_event(void) {
+	// Another thread may be installing the buffer, so it is only read
+	// with atomic loads
+	struct prof_event *buf = __atomic_load_n(&events, __ATOMIC_ACQUIRE);
+	if (buf == NULL) {
+		// Benign race: the loser of the exchange frees its buffer and
+		// takes the winner's
+		struct prof_event *expected = NULL;
+		buf = malloc(PROF_MAX_EVENTS * sizeof(struct prof_event));
+		if (!__atomic_compare_exchange_n(&events, &expected, buf, 0,
+						 __ATOMIC_ACQ_REL,
+						 __ATOMIC_ACQUIRE)) {
+			free(buf);
+			buf = expected;
+		}
+	}
+	if (tid < 0) tid = atomic_fetch_add(&num_threads, 1);
+
+	size_t idx = atomic_fetch_add(&num_events, 1);
+	if (buf == NULL || idx >= PROF_MAX_EVENTS) return NULL;
+	return &buf[idx];
+}
+
+// The first event of any kind and on any thread sets the trace origin
+static void set_origin(const uint64_t start) {
+	uint_fast64_t expected = 0;
+	atomic_compare_exchange_strong(&time_origin, &expected, start);
+}
+
+static int clamp_level(int level) {
+	if (level < 0) return 0;
+	return level < PROF_MAX_LEVELS ? level : PROF_MAX_LEVELS - 1;
+}
+
+uint64_t prof_now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+void prof_record(const enum prof_phase phase, const uint64_t start,
+		 const size_t bytes) {
+	const uint64_t end = prof_now();
+	// Phases belong to the call they are executed in
+	const int level = clamp_level(depth - 1);
+
+	atomic_fetch_add(&stat_ns[level][phase], end - start);
+	atomic_fetch_add(&stat_calls[level][phase], 1);
+	atomic_fetch_add(&stat_bytes[level][phase], bytes);
+	set_origin(start);
+
+	struct prof_event *e = new_event();
+	if (e == NULL) return;
+	*e = (struct prof_event){.name = phase_names[phase],
+				 .start = start,
+				 .end = end,
+				 .m = bytes,
+				 .level = level,
+				 .tid = tid,
+				 .is_call = 0};
+}
+
+uint64_t prof_enter(void) {
+	const uint64_t start = prof_now();
+	set_origin(start);
+	depth++;
+	return start;
+}
+
+void prof_leave(const char *name, const uint64_t start, const size_t m,
+		const size_t n, const size_t k) {
+	const uint64_t end = prof_now();
+	depth--;
+	const int level = clamp_level(depth);
+
+	atomic_fetch_add(&stat_ns[level][PROF_CALL], end - start);
+	atomic_fetch_add(&stat_calls[level][PROF_CALL], 1);
+
+	struct prof_event *e = new_event();
+	if (e == NULL) return;
+	*e = (struct prof_event){.name = name,
+				 .start = start,
+				 .end = end,
+				 .m = m,
+				 .n = n,
+				 .k = k,
+				 .level = level,
+				 .tid = tid,
+				 .is_call = 1};
+}
+
+void prof_reset(void) {
+	for (int l = 0; l < PROF_MAX_LEVELS; l++) {
+		for (int p = 0; p < PROF_NUM_PHASES; p++) {
+			atomic_store(&stat_ns[l][p], 0);
+			atomic_store(&stat_calls[l][p], 0);
+			atomic_store(&stat_bytes[l][p], 0);
+		}
+	}
+	atomic_store(&num_events, 0);
+	atomic_store(&time_origin, 0);
+}
+
+void prof_print_summary(FILE *out) {
+	fprintf(out, "# %-5s %-6s %12s %10s %12s %10s\n", "level", "phase",
+		"time [ms]", "calls", "bytes [MB]", "GB/s");
+	for (int l = 0; l < PROF_MAX_LEVELS; l++) {
+		for (int p = 0; p < PROF_NUM_PHASES; p++) {
+			const uint64_t calls = atomic_load(&stat_calls[l][p]);
+			if (calls == 0) continue;
+			const double ns = (double)atomic_load(&stat_ns[l][p]);
+			const double bytes =
+			    (double)atomic_load(&stat_bytes[l][p]);
+			fprintf(out, "  %-5d %-6s %12.3f %10llu %12.2f ", l,
+				phase_names[p], ns * 1e-6,
+				(unsigned long long)calls, bytes * 1e-6);
+			// Bandwidth is meaningless for the inclusive call time
+			if (p != PROF_CALL && ns > 0)
+				fprintf(out, "%10.2f\n", bytes / ns);
+			else
+				fprintf(out, "%10s\n", "-");
+		}
+	}
+
+	const size_t recorded = atomic_load(&num_events);
+	if (recorded > PROF_MAX_EVENTS)
+		fprintf(out, "# trace truncated: %zu of %zu events kept\n",
+			(size_t)PROF_MAX_EVENTS, recorded);
+}
+
+int prof_export_chrome_trace(const char *path) {
+	FILE *file = fopen(path, "w");
+	if (file == NULL) return -1;
+
+	const struct prof_event *buf =
+	    __atomic_load_n(&events, __ATOMIC_ACQUIRE);
+	size_t count = buf != NULL ? atomic_load(&num_events) : 0;
+	if (count > PROF_MAX_EVENTS) count = PROF_MAX_EVENTS;
+
+	// Timestamps in the trace format are microseconds. Events that started
+	// before another thread set the origin get small negative ones.
+	const uint64_t origin = atomic_load(&time_origin);
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	for (size_t i = 0; i < count; i++) {
+		const struct prof_event *e = &buf[i];
+		const double ts = (double)(int64_t)(e->start - origin) * 1e-3;
+		const double dur = (double)(e->end - e->start) * 1e-3;
+		fprintf(file,
+			"{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\","
+			"\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,",
+			e->name, e->is_call ? "call" : "phase", e->tid, ts,
+			dur);
+		if (e->is_call)
+			fprintf(file,
+				"\"args\":{\"level\":%d,\"m\":%zu,\"n\":%zu,"
+				"\"k\":%zu}}",
+				e->level, e->m, e->n, e->k);
+		else
+			fprintf(file, "\"args\":{\"level\":%d,\"bytes\":%zu}}",
+				e->level, e->m);
+		fprintf(file, "%s\n", i + 1 < count ? "," : "");
+	}
+	fprintf(file, "]}\n");
+
+	fclose(file);
+	return 0;
+}
+
+#endif	// STRASSEN_PROFILE
@@ -0,0 +1,195 @@
+/*
+ * DESC: Module for matrix chain products and matrix powers.
+ * AUTHORS: Thomas Gantz, Laura Paxton, Jan Marxen
+ */
+#include "../include/strassen_chain.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/strassen_matmat.h"
+#include "../include/strassen_plan.h"
+
+// Chain being computed, plans[i * count + j] is the product of subchain i..j
+struct chain {
+	const double *const *mats;
+	const size_t *dims;
+	size_t count;
+	size_t *split;
+	struct strassen_plan **plans;
+	double *workspace;
+};
+
+double strassen_chain_order(const size_t *const dims, const size_t count,
+			    size_t *split) {
+	if (count < 2) return 0.0;
+
+	// cost[i * count + j]: cheapest cost of subchain i..j
+	double *cost = calloc(count * count, sizeof(double));
+	if (cost == NULL) return -1.0;
+
+	for (size_t len = 2; len <= count; len++) {
+		for (size_t i = 0; i + len <= count; i++) {
+			const size_t j = i + len - 1;
+			double best = -1.0;
+			size_t best_s = i;
+			for (size_t s = i; s < j; s++) {
+				const double c =
+				    cost[i * count + s] +
+				    cost[(s + 1) * count + j] +
+				    strassen_matmat_cost(dims[i], dims[s + 1],
+							 dims[j + 1],
+							 STRASSEN_LEAF_SIZE);
+				if (best < 0 || c < best) {
+					best = c;
+					best_s = s;
+				}
+			}
+			cost[i * count + j] = best;
+			if (split != NULL) split[i * count + j] = best_s;
+		}
+	}
+
+	const double total = cost[count - 1];
+	free(cost);
+	return total;
+}
+
+// Plan every product of subchain i..j and track the largest workspace
+static int plan_chain(struct chain *c, const size_t i, const size_t j,
+		      size_t *workspace) {
+	if (i == j) return 0;
+	const size_t s = c->split[i * c->count + j];
+	if (plan_chain(c, i, s, workspace) != 0 ||
+	    plan_chain(c, s + 1, j, workspace) != 0)
+		return -1;
+
+	const struct strassen_plan_options options = {.external_workspace = 1};
+	struct strassen_plan *plan = strassen_plan(
+	    c->dims[i], c->dims[s + 1], c->dims[j + 1], &options);
+	if (plan == NULL) return -1;
+	c->plans[i * c->count + j] = plan;
+	if (plan->workspace_size > *workspace)
+		*workspace = plan->workspace_size;
+	return 0;
+}
+
+// out = M_i * ... * M_j for i < j, intermediates live until consumed
+static int run_chain(struct chain *c, const size_t i, const size_t j,
+		     double *out) {
+	const size_t s = c->split[i * c->count + j];
+	const size_t *dims = c->dims;
+	const double *left = c->mats[i], *right = c->mats[j];
+	double *left_buffer = NULL, *right_buffer = NULL;
+	int status = 0;
+
+	if (s > i) {
+		left_buffer = malloc(dims[i] * dims[s + 1] * sizeof(double));
+		status = left_buffer ? run_chain(c, i, s, left_buffer) : -1;
+		left = left_buffer;
+	}
+	if (status == 0 && s + 1 < j) {
+		right_buffer =
+		    malloc(dims[s + 1] * dims[j + 1] * sizeof(double));
+		status =
+		    right_buffer ? run_chain(c, s + 1, j, right_buffer) : -1;
+		right = right_buffer;
+	}
+	if (status == 0)
+		strassen_execute_ws(c->plans[i * c->count + j], left, right,
+				    out, c->workspace);
+
+	free(left_buffer);
+	free(right_buffer);
+	return status;
+}
+
+int strassen_chain(const double *const *mats, const size_t *const dims,
+		   const size_t count, double *result) {
+	if (count == 0) return -1;
+	if (count == 1) {
+		memcpy(result, mats[0], dims[0] * dims[1] * sizeof(double));
+		return 0;
+	}
+
+	struct chain c = {.mats = mats, .dims = dims, .count = count};
+	c.split = malloc(count * count * sizeof(size_t));
+	c.plans = calloc(count * count, sizeof(struct strassen_plan *));
+	int status = c.split && c.plans ? 0 : -1;
+
+	size_t workspace = 0;
+	if (status == 0) {
+		if (strassen_chain_order(dims, count, c.split) < 0)
+			status = -1;
+		else
+			status = plan_chain(&c, 0, count - 1, &workspace);
+	}
+	if (status == 0) {
+		// One workspace for every product of the chain
+		c.workspace = malloc((workspace ? workspace : 1) *
+				     sizeof(double));
+		status = c.workspace ? run_chain(&c, 0, count - 1, result) : -1;
+	}
+
+	if (c.plans != NULL)
+		for (size_t i = 0; i < count * count; i++)
+			strassen_plan_destroy(c.plans[i]);
+	free(c.plans);
+	free(c.split);
+	free(c.workspace);
+	return status;
+}
+
+int strassen_power(const double *const A, double *result, const size_t n,
+		   unsigned long e) {
+	if (e == 0) {
+		for (size_t i = 0; i < n * n; i++) result[i] = 0.0;
+		for (size_t i = 0; i < n; i++) result[i * n + i] = 1.0;
+		return 0;
+	}
+
+	// Every product is n x n x n, so one plan and workspace serve all
+	const struct strassen_plan_options options = {.external_workspace = 1};
+	struct strassen_plan *plan = strassen_plan(n, n, n, &options);
+	double *workspace = NULL, *base = NULL, *temp = NULL;
+	int status = -1;
+	if (plan != NULL) {
+		const size_t size = plan->workspace_size;
+		workspace = malloc((size ? size : 1) * sizeof(double));
+		base = malloc(n * n * sizeof(double));
+		temp = malloc(n * n * sizeof(double));
+		status = workspace && base && temp ? 0 : -1;
+	}
+
+	if (status == 0) {
+		// base runs through A^(2^i), result collects the set bits of e
+		memcpy(base, A, n * n * sizeof(double));
+		int first = 1;
+		for (;;) {
+			if (e & 1) {
+				if (first) {
+					memcpy(result, base,
+					       n * n * sizeof(double));
+					first = 0;
+				} else {
+					strassen_execute_ws(plan, result, base,
+							    temp, workspace);
+					memcpy(result, temp,
+					       n * n * sizeof(double));
+				}
+			}
+			e >>= 1;
+			if (e == 0) break;
+			strassen_execute_ws(plan, base, base, temp, workspace);
+			double *swap = base;
+			base = temp;
+			temp = swap;
+		}
+	}
+
+	strassen_plan_destroy(plan);
+	free(workspace);
+	free(base);
+	free(temp);
+	return status;
+}
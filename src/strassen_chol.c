@@ -0,0 +1,377 @@
+/*
+ * DESC: Module for recursive Cholesky factorization and inversion of symmetric
+ * positive definite matrices and for symmetric products.
+ * AUTHORS: Thomas Gantz, Laura Paxton, Jan Marxen
+ */
+#include "../include/strassen_chol.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "../include/block_utilities.h"
+#include "../include/profile.h"
+#include "../include/strassen_matmat.h"
+
+static double *alloc_block(const size_t size) {
+	PROF_BEGIN(t_alloc);
+	double *block = (double *)malloc(size * sizeof(double));
+	PROF_END(t_alloc, PROF_ALLOC, size * sizeof(double));
+	return block;
+}
+
+// T = A^T for A (size rows x cols)
+static void transpose(const double *const A, double *T, const size_t rows,
+		      const size_t cols) {
+	PROF_BEGIN(t_copy);
+	for (size_t i = 0; i < rows; i++)
+		for (size_t j = 0; j < cols; j++)
+			T[j * rows + i] = A[i * cols + j];
+	PROF_END(t_copy, PROF_COPY, 2 * rows * cols * sizeof(double));
+}
+
+// Copy the lower triangle of A (size nxn) to the upper one
+static void mirror_lower(double *A, const size_t n) {
+	for (size_t i = 0; i < n; i++)
+		for (size_t j = 0; j < i; j++) A[j * n + i] = A[i * n + j];
+}
+
+// Lower triangle of C = X*Y^T (X, Y size nxk, C row stride ldc) for products
+// known to be symmetric. The diagonal blocks recurse, the off-diagonal block
+// is a full product.
+// Return: 0 on success, -1 if memory ran out.
+static int syrk_lower(const double *const X, const double *const Y,
+		      double *C, const size_t ldc, const size_t n,
+		      const size_t k) {
+	if (n <= SPD_LEAF_SIZE) {
+		PROF_BEGIN(t_leaf);
+		for (size_t i = 0; i < n; i++) {
+			for (size_t j = 0; j <= i; j++) {
+				double sum = 0.0;
+				for (size_t l = 0; l < k; l++)
+					sum += X[i * k + l] * Y[j * k + l];
+				C[i * ldc + j] = sum;
+			}
+		}
+		PROF_END(t_leaf, PROF_LEAF,
+			 (2 * n * k + n * n / 2) * sizeof(double));
+		return 0;
+	}
+
+	const size_t n1 = n / 2, n2 = n - n1;
+	if (syrk_lower(X, Y, C, ldc, n1, k) != 0 ||
+	    syrk_lower(X + n1 * k, Y + n1 * k, C + n1 * ldc + n1, ldc, n2,
+		       k) != 0)
+		return -1;
+
+	// C21 = X2 * Y1^T
+	double *Y1T = alloc_block(k * n1);
+	double *C21 = alloc_block(n2 * n1);
+	int status = -1;
+	if (Y1T != NULL && C21 != NULL) {
+		transpose(Y, Y1T, n1, k);
+		status = strassen_matmat_r(X + n1 * k, Y1T, C21, n2, k, n1);
+	}
+	if (status == 0) set_sub_block(C, C21, n1 * ldc, n2, n1, ldc);
+	free(Y1T);
+	free(C21);
+	return status;
+}
+
+int strassen_syrk(const double *const A, double *C, const size_t n,
+		  const size_t k, const enum strassen_syrk_op op) {
+	PROF_ENTER(t_call);
+	int status = -1;
+	if (op == SYRK_A_AT) {
+		status = syrk_lower(A, A, C, n, n, k);
+	} else {
+		// A^T*A = (A^T)*(A^T)^T, one transpose of A up front
+		double *AT = alloc_block(n * k);
+		if (AT != NULL) {
+			transpose(A, AT, k, n);
+			status = syrk_lower(AT, AT, C, n, n, k);
+		}
+		free(AT);
+	}
+	PROF_LEAVE(t_call, "strassen_syrk", n, k, n);
+	return status;
+}
+
+// Unblocked Cholesky of the lower triangle of A (size nxn)
+static int leaf_cholesky(const double *const A, double *L, const size_t n) {
+	for (size_t j = 0; j < n; j++) {
+		double diag = A[j * n + j];
+		for (size_t l = 0; l < j; l++)
+			diag -= L[j * n + l] * L[j * n + l];
+		if (!(diag > 0.0)) return -1;  // also catches NaN
+		const double ljj = sqrt(diag);
+		L[j * n + j] = ljj;
+		for (size_t i = j + 1; i < n; i++) {
+			double sum = A[i * n + j];
+			for (size_t l = 0; l < j; l++)
+				sum -= L[i * n + l] * L[j * n + l];
+			L[i * n + j] = sum / ljj;
+		}
+		for (size_t i = 0; i < j; i++) L[i * n + j] = 0.0;
+	}
+	return 0;
+}
+
+// W = L^-1 for lower triangular L (size nxn) by forward substitution
+static void leaf_tri_inverse(const double *const L, double *W,
+			     const size_t n) {
+	for (size_t j = 0; j < n; j++) {
+		for (size_t i = 0; i < j; i++) W[i * n + j] = 0.0;
+		W[j * n + j] = 1.0 / L[j * n + j];
+		for (size_t i = j + 1; i < n; i++) {
+			double sum = 0.0;
+			for (size_t l = j; l < i; l++)
+				sum += L[i * n + l] * W[l * n + j];
+			W[i * n + j] = -sum / L[i * n + i];
+		}
+	}
+}
+
+// W = L^-1 for lower triangular L: W21 = -W22 * L21 * W11
+// Return: 0 on success, -1 if memory ran out.
+static int tri_inverse(const double *const L, double *W, const size_t n) {
+	if (n <= SPD_LEAF_SIZE) {
+		PROF_BEGIN(t_leaf);
+		leaf_tri_inverse(L, W, n);
+		PROF_END(t_leaf, PROF_LEAF, 2 * n * n * sizeof(double));
+		return 0;
+	}
+
+	const size_t n1 = n / 2, n2 = n - n1;
+	double *L11 = create_sub_block(L, 0, n1, n1, n);
+	double *L21 = create_sub_block(L, n1 * n, n2, n1, n);
+	double *L22 = create_sub_block(L, n1 * n + n1, n2, n2, n);
+	double *W11 = alloc_block(n1 * n1);
+	double *W22 = alloc_block(n2 * n2);
+	double *temp = alloc_block(n2 * n1);
+	double *W21 = alloc_block(n2 * n1);
+	int status = -1;
+	if (L11 != NULL && L21 != NULL && L22 != NULL && W11 != NULL &&
+	    W22 != NULL && temp != NULL && W21 != NULL)
+		status = tri_inverse(L11, W11, n1);
+	if (status == 0) status = tri_inverse(L22, W22, n2);
+	if (status == 0)
+		status = strassen_matmat_r(L21, W11, temp, n2, n1, n1);
+	if (status == 0)
+		status = strassen_matmat_r(W22, temp, W21, n2, n2, n1);
+
+	if (status == 0) {
+		for (size_t i = 0; i < n2 * n1; i++) W21[i] = -W21[i];
+		for (size_t i = 0; i < n1; i++)
+			for (size_t j = n1; j < n; j++) W[i * n + j] = 0.0;
+		set_sub_block(W, W11, 0, n1, n1, n);
+		set_sub_block(W, W21, n1 * n, n2, n1, n);
+		set_sub_block(W, W22, n1 * n + n1, n2, n2, n);
+	}
+
+	free(L11);
+	free(L21);
+	free(L22);
+	free(W11);
+	free(W22);
+	free(W21);
+	free(temp);
+	return status;
+}
+
+// Lower triangle of S (size nxn) minus that of P
+static void sub_lower(double *S, const double *const P, const size_t n) {
+	PROF_BEGIN(t_add);
+	for (size_t i = 0; i < n; i++)
+		for (size_t j = 0; j <= i; j++) S[i * n + j] -= P[i * n + j];
+	PROF_END(t_add, PROF_ADD, 3 * n * n / 2 * sizeof(double));
+}
+
+int strassen_cholesky(const double *const A, double *L, const size_t n) {
+	PROF_ENTER(t_call);
+
+	if (n <= SPD_LEAF_SIZE) {
+		PROF_BEGIN(t_leaf);
+		const int status = leaf_cholesky(A, L, n);
+		PROF_END(t_leaf, PROF_LEAF, 2 * n * n * sizeof(double));
+		PROF_LEAVE(t_call, "strassen_cholesky", n, n, n);
+		return status;
+	}
+
+	// [L11 0; L21 L22] with L11 = chol(A11), L21 = A21 * L11^-T and
+	// L22 = chol(A22 - L21 * L21^T)
+	const size_t n1 = n / 2, n2 = n - n1;
+	double *A11 = create_sub_block(A, 0, n1, n1, n);
+	double *L11 = alloc_block(n1 * n1);
+	int status = -1;
+	if (A11 != NULL && L11 != NULL)
+		status = strassen_cholesky(A11, L11, n1);
+	free(A11);
+
+	double *L21 = NULL, *L22 = NULL;
+	if (status == 0) {
+		double *W11 = alloc_block(n1 * n1);
+		double *W11T = alloc_block(n1 * n1);
+		double *A21 = create_sub_block(A, n1 * n, n2, n1, n);
+		L21 = alloc_block(n2 * n1);
+		status = -1;
+		if (W11 != NULL && W11T != NULL && A21 != NULL && L21 != NULL)
+			status = tri_inverse(L11, W11, n1);
+		if (status == 0) {
+			transpose(W11, W11T, n1, n1);
+			status = strassen_matmat_r(A21, W11T, L21, n2, n1,
+						   n1);
+		}
+		free(W11);
+		free(A21);
+		free(W11T);
+	}
+
+	if (status == 0) {
+		// Schur complement, lower triangle only
+		double *S = create_sub_block(A, n1 * n + n1, n2, n2, n);
+		double *P = alloc_block(n2 * n2);
+		L22 = alloc_block(n2 * n2);
+		status = -1;
+		if (S != NULL && P != NULL && L22 != NULL)
+			status = strassen_syrk(L21, P, n2, n1, SYRK_A_AT);
+		if (status == 0) {
+			sub_lower(S, P, n2);
+			status = strassen_cholesky(S, L22, n2);
+		}
+		free(P);
+		free(S);
+	}
+
+	if (status == 0) {
+		for (size_t i = 0; i < n1; i++)
+			for (size_t j = n1; j < n; j++) L[i * n + j] = 0.0;
+		set_sub_block(L, L11, 0, n1, n1, n);
+		set_sub_block(L, L21, n1 * n, n2, n1, n);
+		set_sub_block(L, L22, n1 * n + n1, n2, n2, n);
+	}
+	free(L11);
+	free(L21);
+	free(L22);
+
+	PROF_LEAVE(t_call, "strassen_cholesky", n, n, n);
+	return status;
+}
+
+// X = L^-T * L^-1 = W^T * W (lower triangle) with W = L^-1 for the leaf
+// Cholesky factor L of A (size nxn)
+static int leaf_spd_inverse(const double *const A, double *X,
+			    const size_t n) {
+	double *L = alloc_block(n * n);
+	double *W = alloc_block(n * n);
+	int status = -1;
+	if (L != NULL && W != NULL) status = leaf_cholesky(A, L, n);
+	if (status == 0) {
+		leaf_tri_inverse(L, W, n);
+		for (size_t i = 0; i < n; i++) {
+			for (size_t j = 0; j <= i; j++) {
+				double sum = 0.0;
+				for (size_t l = i; l < n; l++)
+					sum += W[l * n + i] * W[l * n + j];
+				X[i * n + j] = sum;
+			}
+		}
+	}
+	free(L);
+	free(W);
+	return status;
+}
+
+// Lower triangle of X = A^-1 for SPD A, only the lower triangle of A is read
+static int spd_inverse(const double *const A, double *X, const size_t n) {
+	PROF_ENTER(t_call);
+
+	if (n <= SPD_LEAF_SIZE) {
+		PROF_BEGIN(t_leaf);
+		const int status = leaf_spd_inverse(A, X, n);
+		PROF_END(t_leaf, PROF_LEAF, 3 * n * n * sizeof(double));
+		PROF_LEAVE(t_call, "strassen_invert_spd", n, n, n);
+		return status;
+	}
+
+	// With E = A11^-1, F = A21 * E and T = (A22 - F * A21^T)^-1:
+	// X11 = E + F^T * T * F, X21 = -T * F, X22 = T
+	const size_t n1 = n / 2, n2 = n - n1;
+	double *A11 = create_sub_block(A, 0, n1, n1, n);
+	double *E = alloc_block(n1 * n1);
+	int status = -1;
+	if (A11 != NULL && E != NULL) status = spd_inverse(A11, E, n1);
+	free(A11);
+
+	double *F = NULL, *T = NULL;
+	if (status == 0) {
+		mirror_lower(E, n1);
+		double *A21 = create_sub_block(A, n1 * n, n2, n1, n);
+		double *S = create_sub_block(A, n1 * n + n1, n2, n2, n);
+		double *P = alloc_block(n2 * n2);
+		F = alloc_block(n2 * n1);
+		T = alloc_block(n2 * n2);
+		status = -1;
+		if (A21 != NULL && S != NULL && P != NULL && F != NULL &&
+		    T != NULL)
+			status = strassen_matmat_r(A21, E, F, n2, n1, n1);
+
+		// Schur complement, lower triangle only
+		if (status == 0) status = syrk_lower(F, A21, P, n2, n2, n1);
+		if (status == 0) {
+			sub_lower(S, P, n2);
+			status = spd_inverse(S, T, n2);
+		}
+		free(P);
+		free(A21);
+		free(S);
+	}
+
+	if (status == 0) {
+		mirror_lower(T, n2);
+		double *X21 = alloc_block(n2 * n1);
+		double *FT = alloc_block(n1 * n2);
+		double *X21T = alloc_block(n1 * n2);
+		double *P = alloc_block(n1 * n1);
+		status = -1;
+		if (X21 != NULL && FT != NULL && X21T != NULL && P != NULL)
+			status = strassen_matmat_r(T, F, X21, n2, n2, n1);
+
+		// X11 = E - F^T * X21, symmetric
+		if (status == 0) {
+			for (size_t i = 0; i < n2 * n1; i++)
+				X21[i] = -X21[i];
+			transpose(F, FT, n2, n1);
+			transpose(X21, X21T, n2, n1);
+			status = syrk_lower(FT, X21T, P, n1, n1, n2);
+		}
+		if (status == 0) {
+			for (size_t i = 0; i < n1; i++)
+				for (size_t j = 0; j <= i; j++)
+					X[i * n + j] =
+					    E[i * n1 + j] - P[i * n1 + j];
+			set_sub_block(X, X21, n1 * n, n2, n1, n);
+			for (size_t i = 0; i < n2; i++)
+				for (size_t j = 0; j <= i; j++)
+					X[(n1 + i) * n + n1 + j] =
+					    T[i * n2 + j];
+		}
+
+		free(X21);
+		free(FT);
+		free(X21T);
+		free(P);
+	}
+	free(E);
+	free(F);
+	free(T);
+
+	PROF_LEAVE(t_call, "strassen_invert_spd", n, n, n);
+	return status;
+}
+
+int strassen_invert_spd(const double *const A, double *inverse_A,
+			const size_t n) {
+	const int status = spd_inverse(A, inverse_A, n);
+	if (status == 0) mirror_lower(inverse_A, n);
+	return status;
+}
@@ -0,0 +1,249 @@
+/*
+ * DESC: Load generator for the matrix service.
+ * AUTHORS: Thomas Gantz, Laura Paxton, Jan Marxen
+ *
+ * Usage: ./strassen_client [--socket=<path>] [--op=matmat|invert|solve]
+ *                          [--size=<n>] [--requests=<count>]
+ *                          [--inflight=<count>] [--seed=<S>]
+ *
+ * The operands are placed once in a shared memory segment that is attached
+ * to the server. Requests are then pipelined with up to `inflight` of them
+ * outstanding, each with its own output matrix in the segment. The client
+ * reports its own latency percentiles and throughput, checks one row of the
+ * last result and prints the statistics of the server. The operands come
+ * from the seeded test matrix generator, so a run can be repeated with
+ * the printed seed.
+ */
+#define _GNU_SOURCE  // memfd_create
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../include/matrix_gen.h"
+#include "../include/service.h"
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + 1e-9 * (double)ts.tv_nsec;
+}
+
+static int compare_double(const void *a, const void *b) {
+	const double x = *(const double *)a, y = *(const double *)b;
+	return (x > y) - (x < y);
+}
+
+static int connect_to(const char *path) {
+	struct sockaddr_un addr = {.sun_family = AF_UNIX};
+	if (strlen(path) >= sizeof(addr.sun_path)) return -1;
+	strcpy(addr.sun_path, path);
+	const int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+	if (fd < 0) return -1;
+	if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+// Send a request, with the descriptor fd attached if fd >= 0
+static int send_request(const int sock, const struct service_request *req,
+			const int fd) {
+	union {
+		char buf[CMSG_SPACE(sizeof(int))];
+		struct cmsghdr align;
+	} control;
+	struct iovec iov = {.iov_base = (void *)req, .iov_len = sizeof(*req)};
+	struct msghdr msg = {.msg_iov = &iov, .msg_iovlen = 1};
+	if (fd >= 0) {
+		msg.msg_control = control.buf;
+		msg.msg_controllen = sizeof(control.buf);
+		struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_RIGHTS;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+		memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+	}
+	return sendmsg(sock, &msg, MSG_NOSIGNAL) == (ssize_t)sizeof(*req) ? 0
+									  : -1;
+}
+
+static int recv_response(const int sock, struct service_response *resp) {
+	return recv(sock, resp, sizeof(*resp), 0) == (ssize_t)sizeof(*resp)
+		   ? 0
+		   : -1;
+}
+
+// Largest deviation of row r of the result from its expected value
+static double check_row(const enum service_op op, const double *A,
+			const double *B, const double *C, const size_t n,
+			const size_t r) {
+	double err = 0.0;
+	for (size_t j = 0; j < n; j++) {
+		double sum = 0.0, expected;
+		if (op == SERVICE_MATMAT) {
+			// (A*B)[r][j]
+			for (size_t l = 0; l < n; l++)
+				sum += A[r * n + l] * B[l * n + j];
+			expected = C[r * n + j];
+		} else {
+			// (A*C)[r][j] against I or B
+			for (size_t l = 0; l < n; l++)
+				sum += A[r * n + l] * C[l * n + j];
+			expected =
+			    op == SERVICE_INVERT ? (r == j) : B[r * n + j];
+		}
+		err = fmax(err, fabs(sum - expected));
+	}
+	return err;
+}
+
+int main(int argc, char *argv[]) {
+	const char *path = SERVICE_SOCKET_PATH;
+	enum service_op op = SERVICE_MATMAT;
+	size_t n = 64, requests = 1000, inflight = 8;
+	uint64_t seed = time(NULL);
+	for (int arg = 1; arg < argc; arg++) {
+		const char *a = argv[arg];
+		if (strncmp(a, "--socket=", 9) == 0) {
+			path = a + 9;
+		} else if (strcmp(a, "--op=matmat") == 0) {
+			op = SERVICE_MATMAT;
+		} else if (strcmp(a, "--op=invert") == 0) {
+			op = SERVICE_INVERT;
+		} else if (strcmp(a, "--op=solve") == 0) {
+			op = SERVICE_SOLVE;
+		} else if (strncmp(a, "--size=", 7) == 0) {
+			n = strtoul(a + 7, NULL, 10);
+		} else if (strncmp(a, "--requests=", 11) == 0) {
+			requests = strtoul(a + 11, NULL, 10);
+		} else if (strncmp(a, "--inflight=", 11) == 0) {
+			inflight = strtoul(a + 11, NULL, 10);
+		} else if (strncmp(a, "--seed=", 7) == 0) {
+			seed = strtoull(a + 7, NULL, 10);
+		} else {
+			fprintf(stderr,
+				"Usage: %s [--socket=<path>] "
+				"[--op=matmat|invert|solve] [--size=<n>] "
+				"[--requests=<count>] [--inflight=<count>] "
+				"[--seed=<S>]\n",
+				argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (n == 0 || requests == 0 || inflight == 0) {
+		fprintf(stderr, "Size, requests and inflight must be > 0.\n");
+		return EXIT_FAILURE;
+	}
+	if (inflight > requests) inflight = requests;
+
+	const int sock = connect_to(path);
+	if (sock < 0) {
+		fprintf(stderr, "Could not connect to %s\n", path);
+		return EXIT_FAILURE;
+	}
+
+	// Segment layout: A, B, then one output per outstanding request
+	const size_t matrix = n * n * sizeof(double);
+	const size_t size = (2 + inflight) * matrix;
+	const int shm = memfd_create("strassen_client", MFD_CLOEXEC);
+	char *base = MAP_FAILED;
+	if (shm >= 0 && ftruncate(shm, size) == 0)
+		base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, shm,
+			    0);
+	if (base == MAP_FAILED) {
+		fprintf(stderr, "Could not create the shared segment\n");
+		return EXIT_FAILURE;
+	}
+	double *A = (double *)base, *B = (double *)(base + matrix);
+	// Diagonal dominance keeps A well conditioned for invert and solve
+	gen_well_conditioned(A, n, seed, 0);
+	gen_uniform(B, n * n, seed + 1, 0);
+	printf("# client: seed %llu\n", (unsigned long long)seed);
+
+	struct service_request req = {.op = SERVICE_ATTACH, .m = size};
+	struct service_response resp;
+	if (send_request(sock, &req, shm) != 0 ||
+	    recv_response(sock, &resp) != 0 || resp.status != 0) {
+		fprintf(stderr, "Could not attach the shared segment\n");
+		return EXIT_FAILURE;
+	}
+	close(shm);
+
+	double *latency = malloc(requests * sizeof(double));
+	double *sent = malloc(inflight * sizeof(double));
+	// Responses can arrive out of order, free slots are kept on a stack
+	size_t *free_slots = malloc(inflight * sizeof(size_t));
+	for (size_t i = 0; i < inflight; i++) free_slots[i] = inflight - 1 - i;
+	size_t num_free = inflight;
+	size_t issued = 0, completed = 0, failed = 0, last_slot = 0;
+	req = (struct service_request){
+	    .op = op, .m = n, .n = n, .k = n, .a = 0, .b = matrix};
+
+	const double start = now();
+	while (completed < requests) {
+		// Keep every slot busy while requests remain
+		while (issued < requests && num_free > 0) {
+			const size_t slot = free_slots[--num_free];
+			req.id = (uint32_t)slot;
+			req.c = (2 + slot) * matrix;
+			sent[slot] = now();
+			if (send_request(sock, &req, -1) != 0) {
+				fprintf(stderr, "Lost the connection\n");
+				return EXIT_FAILURE;
+			}
+			issued++;
+		}
+		if (recv_response(sock, &resp) != 0) {
+			fprintf(stderr, "Lost the connection\n");
+			return EXIT_FAILURE;
+		}
+		if (resp.id >= inflight) {
+			fprintf(stderr, "Unexpected response\n");
+			return EXIT_FAILURE;
+		}
+		latency[completed++] = now() - sent[resp.id];
+		failed += resp.status != 0;
+		last_slot = resp.id;
+		free_slots[num_free++] = resp.id;
+	}
+	const double elapsed = now() - start;
+
+	qsort(latency, requests, sizeof(double), compare_double);
+	const char *names[] = {"attach", "matmat", "invert", "solve"};
+	printf("# client: %zu %s requests of size %zu, %zu in flight\n",
+	       requests, names[op], n, inflight);
+	printf("# client: p50: %.3f ms, p99: %.3f ms, "
+	       "throughput: %.1f req/s, failed: %zu\n",
+	       latency[(requests - 1) / 2] * 1e3,
+	       latency[(requests - 1) * 99 / 100] * 1e3,
+	       (double)requests / elapsed, failed);
+
+	const double *C = (double *)(base + (2 + last_slot) * matrix);
+	const double err = fmax(check_row(op, A, B, C, n, 0),
+				check_row(op, A, B, C, n, n - 1));
+	printf("# client: max error of checked rows: %.3e\n", err);
+
+	req = (struct service_request){.op = SERVICE_STATS};
+	if (send_request(sock, &req, -1) == 0 &&
+	    recv_response(sock, &resp) == 0)
+		printf("# server: requests: %llu, p50: %.3f ms, "
+		       "p99: %.3f ms, throughput: %.1f req/s\n",
+		       (unsigned long long)resp.count, resp.p50 * 1e3,
+		       resp.p99 * 1e3, resp.throughput);
+
+	free(latency);
+	free(sent);
+	free(free_slots);
+	munmap(base, size);
+	close(sock);
+	return failed == 0 && err < 1e-6 * n ? EXIT_SUCCESS : EXIT_FAILURE;
+}
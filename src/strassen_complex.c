@@ -0,0 +1,197 @@
+/*
+ * DESC: Module for complex matrix multiplication and inversion.
+ * AUTHORS: Thomas Gantz, Laura Paxton, Jan Marxen
+ */
+#include "../include/strassen_complex.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/block_utilities.h"
+#include "../include/fixed_kernels.h"
+#include "../include/naive_lu.h"
+#include "../include/strassen_plan.h"
+
+// Blocks up to this size are inverted by Gauss-Jordan elimination
+#define ZLEAF_SIZE FIXED_KERNEL_MAX
+
+// Complex block in split format
+struct zblock {
+	double *re, *im;
+};
+
+static struct zblock zblock_alloc(const size_t size) {
+	const size_t count = size > 0 ? size : 1;
+	return (struct zblock){calloc(count, sizeof(double)),
+			       calloc(count, sizeof(double))};
+}
+
+// Copy of the block (size rows x cols) of A at start, A has ld columns
+static struct zblock zblock_take(const double *const Ar,
+				 const double *const Ai, const size_t start,
+				 const size_t rows, const size_t cols,
+				 const size_t ld) {
+	return (struct zblock){create_sub_block(Ar, start, rows, cols, ld),
+			       create_sub_block(Ai, start, rows, cols, ld)};
+}
+
+static int zblock_ok(const struct zblock z) {
+	return z.re != NULL && z.im != NULL;
+}
+
+static void zblock_free(struct zblock z) {
+	free(z.re);
+	free(z.im);
+}
+
+int strassen_zmatmat(const double *const Ar, const double *const Ai,
+		     const double *const Br, const double *const Bi,
+		     double *Cr, double *Ci, const size_t m, const size_t n,
+		     const size_t k) {
+	if (m == 0 || k == 0) return 0;
+	if (n == 0) {  // empty sum
+		memset(Cr, 0, m * k * sizeof(double));
+		memset(Ci, 0, m * k * sizeof(double));
+		return 0;
+	}
+
+	// One plan for the three real products
+	struct strassen_plan *plan = strassen_plan(m, n, k, NULL);
+	double *SA = malloc(m * n * sizeof(double));  // Ar + Ai
+	double *SB = malloc(n * k * sizeof(double));  // Br + Bi
+	double *T = malloc(m * k * sizeof(double));   // SA * SB
+	const int status = plan && SA && SB && T ? 0 : -1;
+
+	if (status == 0) {
+		strassen_execute(plan, Ar, Br, Cr);  // Ar*Br
+		strassen_execute(plan, Ai, Bi, Ci);  // Ai*Bi
+		for (size_t i = 0; i < m * n; i++) SA[i] = Ar[i] + Ai[i];
+		for (size_t i = 0; i < n * k; i++) SB[i] = Br[i] + Bi[i];
+		strassen_execute(plan, SA, SB, T);
+		for (size_t i = 0; i < m * k; i++) {
+			const double rr = Cr[i], ii = Ci[i];
+			Cr[i] = rr - ii;
+			Ci[i] = T[i] - rr - ii;
+		}
+	}
+
+	strassen_plan_destroy(plan);
+	free(SA);
+	free(SB);
+	free(T);
+	return status;
+}
+
+static int zmul(const struct zblock A, const struct zblock B, struct zblock C,
+		const size_t m, const size_t n, const size_t k) {
+	return strassen_zmatmat(A.re, A.im, B.re, B.im, C.re, C.im, m, n, k);
+}
+
+// Invert A (size nxn, at most ZLEAF_SIZE) through its real form
+// [Ar -Ai; Ai Ar], whose inverse is [Xr -Xi; Xi Xr], -1 if a pivot vanishes
+static int zinvert_leaf(const double *const Ar, const double *const Ai,
+			double *Xr, double *Xi, const size_t n) {
+	const size_t ld = 2 * n;
+	double S[4 * ZLEAF_SIZE * ZLEAF_SIZE];
+	for (size_t i = 0; i < n; i++)
+		for (size_t j = 0; j < n; j++) {
+			S[i * ld + j] = Ar[i * n + j];
+			S[i * ld + n + j] = -Ai[i * n + j];
+			S[(n + i) * ld + j] = Ai[i * n + j];
+			S[(n + i) * ld + n + j] = Ar[i * n + j];
+		}
+	if (gauss_jordan_invert(S, ld) != 0) return -1;
+
+	for (size_t i = 0; i < n; i++)
+		for (size_t j = 0; j < n; j++) {
+			Xr[i * n + j] = S[i * ld + j];
+			Xi[i * n + j] = S[(n + i) * ld + j];
+		}
+	return 0;
+}
+
+// Recursive block inversion as in strassen_invert, with complex blocks
+// a (size n1xn1), b (size n1xn2), c (size n2xn1) and d (size n2xn2)
+static int zinvert_blocks(const double *const Ar, const double *const Ai,
+			  double *Xr, double *Xi, const size_t n) {
+	if (n <= ZLEAF_SIZE) return zinvert_leaf(Ar, Ai, Xr, Xi, n);
+
+	const size_t n1 = n / 2, n2 = n - n1;
+	struct zblock a = zblock_take(Ar, Ai, 0, n1, n1, n);
+	struct zblock b = zblock_take(Ar, Ai, n1, n1, n2, n);
+	struct zblock c = zblock_take(Ar, Ai, n1 * n, n2, n1, n);
+	struct zblock d = zblock_take(Ar, Ai, n1 * n + n1, n2, n2, n);
+	struct zblock e = zblock_alloc(n1 * n1);      // a^-1
+	struct zblock ce = zblock_alloc(n2 * n1);     // c*e
+	struct zblock Z = zblock_alloc(n2 * n2);      // d - c*e*b
+	struct zblock t = zblock_alloc(n2 * n2);      // Z^-1
+	struct zblock eb = zblock_alloc(n1 * n2);     // e*b
+	struct zblock ebt = zblock_alloc(n1 * n2);    // e*b*t
+	struct zblock tce = zblock_alloc(n2 * n1);    // t*c*e
+	struct zblock ebtce = zblock_alloc(n1 * n1);  // e*b*t*c*e
+	int status = zblock_ok(a) && zblock_ok(b) && zblock_ok(c) &&
+			     zblock_ok(d) && zblock_ok(e) && zblock_ok(ce) &&
+			     zblock_ok(Z) && zblock_ok(t) && zblock_ok(eb) &&
+			     zblock_ok(ebt) && zblock_ok(tce) &&
+			     zblock_ok(ebtce)
+			 ? 0
+			 : -1;
+
+	if (status == 0) status = zinvert_blocks(a.re, a.im, e.re, e.im, n1);
+	if (status == 0) status = zmul(c, e, ce, n2, n1, n1);
+	if (status == 0) status = zmul(ce, b, Z, n2, n1, n2);
+	if (status == 0) {
+		for (size_t i = 0; i < n2 * n2; i++) {
+			Z.re[i] = d.re[i] - Z.re[i];
+			Z.im[i] = d.im[i] - Z.im[i];
+		}
+		status = zinvert_blocks(Z.re, Z.im, t.re, t.im, n2);
+	}
+	if (status == 0) status = zmul(e, b, eb, n1, n1, n2);
+	if (status == 0) status = zmul(eb, t, ebt, n1, n2, n2);
+	if (status == 0) status = zmul(t, ce, tce, n2, n2, n1);
+	if (status == 0) status = zmul(ebt, ce, ebtce, n1, n2, n1);
+
+	// Assemble the inverse from blocks
+	if (status == 0) {
+		for (size_t i = 0; i < n1; i++) {
+			for (size_t j = 0; j < n1; j++) {
+				const size_t l = i * n1 + j;
+				Xr[i * n + j] = e.re[l] + ebtce.re[l];
+				Xi[i * n + j] = e.im[l] + ebtce.im[l];
+			}
+			for (size_t j = 0; j < n2; j++) {
+				Xr[i * n + n1 + j] = -ebt.re[i * n2 + j];
+				Xi[i * n + n1 + j] = -ebt.im[i * n2 + j];
+			}
+		}
+		for (size_t i = 0; i < n2; i++) {
+			double *xr = Xr + (n1 + i) * n, *xi = Xi + (n1 + i) * n;
+			for (size_t j = 0; j < n1; j++) {
+				xr[j] = -tce.re[i * n1 + j];
+				xi[j] = -tce.im[i * n1 + j];
+			}
+			memcpy(xr + n1, t.re + i * n2, n2 * sizeof(double));
+			memcpy(xi + n1, t.im + i * n2, n2 * sizeof(double));
+		}
+	}
+
+	zblock_free(a);
+	zblock_free(b);
+	zblock_free(c);
+	zblock_free(d);
+	zblock_free(e);
+	zblock_free(ce);
+	zblock_free(Z);
+	zblock_free(t);
+	zblock_free(eb);
+	zblock_free(ebt);
+	zblock_free(tce);
+	zblock_free(ebtce);
+	return status;
+}
+
+int strassen_zinvert(const double *const Ar, const double *const Ai,
+		     double *Xr, double *Xi, const size_t n) {
+	return zinvert_blocks(Ar, Ai, Xr, Xi, n);
+}
@@ -0,0 +1,357 @@
+/*
+ * DESC: Module for exact integer and modular Strassen arithmetic.
+ * AUTHORS: Thomas Gantz, Laura Paxton, Jan Marxen
+ */
+#include "../include/strassen_exact.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Leaf kernels get an AVX2 clone, selected at load time on capable CPUs
+#if defined(__GNUC__) && defined(__x86_64__)
+#define SIMD_CLONES __attribute__((target_clones("avx2", "default")))
+#else
+#define SIMD_CLONES
+#endif
+
+// Entries are integers modulo p, p == 0 stands for wrapping modulo 2^64
+struct ring {
+	uint64_t p;
+	// Products of reduced entries that fit on top of a reduced value
+	size_t batch;
+};
+
+// One of the seven products, quadrants are numbered 11, 12, 21, 22 -> 0..3
+struct exact_product {
+	int a1, a2, sa;	 // left operand A[a1] + sa * A[a2] (a2 < 0: A[a1])
+	int b1, b2, sb;	 // right operand B[b1] + sb * B[b2]
+	int c[4];	 // sign with which the product enters each C quadrant
+};
+
+static const struct exact_product products[7] = {
+    {0, 3, 1, 0, 3, 1, {1, 0, 0, 1}},	  // (A11 + A22)(B11 + B22)
+    {2, 3, 1, 0, -1, 0, {0, 0, 1, -1}},	  // (A21 + A22) B11
+    {0, -1, 0, 1, 3, -1, {0, 1, 0, 1}},	  // A11 (B12 - B22)
+    {3, -1, 0, 2, 0, -1, {1, 0, 1, 0}},	  // A22 (B21 - B11)
+    {0, 1, 1, 3, -1, 0, {-1, 1, 0, 0}},	  // (A11 + A12) B22
+    {2, 0, -1, 0, 1, 1, {0, 0, 0, 1}},	  // (A21 - A11)(B11 + B12)
+    {1, 3, -1, 2, 3, 1, {1, 0, 0, 0}},	  // (A12 - A22)(B21 + B22)
+};
+
+static int ring_init(struct ring *r, const uint64_t p) {
+	if (p < 2 || p > EXACT_MOD_MAX) return -1;
+	const uint64_t max = (p - 1) * (p - 1);
+	r->p = p;
+	r->batch = max == 0 ? SIZE_MAX : (size_t)((UINT64_MAX - (p - 1)) / max);
+	return 0;
+}
+
+// C (+)= A*B modulo 2^64
+SIMD_CLONES static void leaf_wrap(const uint64_t *restrict A, const size_t lda,
+				  const uint64_t *restrict B, const size_t ldb,
+				  uint64_t *restrict C, const size_t ldc,
+				  const size_t m, const size_t n,
+				  const size_t k, const int acc) {
+	for (size_t i = 0; i < m; i++) {
+		uint64_t *c = &C[i * ldc];
+		if (!acc) memset(c, 0, k * sizeof(uint64_t));
+		for (size_t l = 0; l < n; l++) {
+			const uint64_t a = A[i * lda + l];
+			const uint64_t *b = &B[l * ldb];
+			for (size_t j = 0; j < k; j++) c[j] += a * b[j];
+		}
+	}
+}
+
+// C (+)= A*B modulo p, reduced once per batch of products
+SIMD_CLONES static void leaf_mod(const uint64_t *restrict A, const size_t lda,
+				 const uint64_t *restrict B, const size_t ldb,
+				 uint64_t *restrict C, const size_t ldc,
+				 const size_t m, const size_t n, const size_t k,
+				 const int acc, const uint64_t p,
+				 const size_t batch) {
+	for (size_t i = 0; i < m; i++) {
+		uint64_t *c = &C[i * ldc];
+		if (!acc) memset(c, 0, k * sizeof(uint64_t));
+		for (size_t l0 = 0; l0 < n; l0 += batch) {
+			const size_t l1 = n - l0 <= batch ? n : l0 + batch;
+			for (size_t l = l0; l < l1; l++) {
+				// Entries fit 32 bits, a widening multiply
+				const uint32_t a = (uint32_t)A[i * lda + l];
+				const uint64_t *b = &B[l * ldb];
+				for (size_t j = 0; j < k; j++)
+					c[j] += (uint64_t)a * (uint32_t)b[j];
+			}
+			for (size_t j = 0; j < k; j++) c[j] %= p;
+			if (l1 == n) break;
+		}
+	}
+}
+
+static void leaf(const struct ring *r, const uint64_t *A, const size_t lda,
+		 const uint64_t *B, const size_t ldb, uint64_t *C,
+		 const size_t ldc, const size_t m, const size_t n,
+		 const size_t k, const int acc) {
+	if (r->p == 0)
+		leaf_wrap(A, lda, B, ldb, C, ldc, m, n, k, acc);
+	else
+		leaf_mod(A, lda, B, ldb, C, ldc, m, n, k, acc, r->p, r->batch);
+}
+
+// T = X + sign * Y for strided blocks, T may alias X or Y
+static void block_add(const struct ring *r, const uint64_t *X,
+		      const size_t ldx, const uint64_t *Y, const size_t ldy,
+		      const int sign, uint64_t *T, const size_t ldt,
+		      const size_t rows, const size_t cols) {
+	const uint64_t p = r->p;
+	for (size_t i = 0; i < rows; i++) {
+		const uint64_t *x = &X[i * ldx], *y = &Y[i * ldy];
+		uint64_t *t = &T[i * ldt];
+		if (p == 0) {
+			if (sign > 0)
+				for (size_t j = 0; j < cols; j++)
+					t[j] = x[j] + y[j];
+			else
+				for (size_t j = 0; j < cols; j++)
+					t[j] = x[j] - y[j];
+		} else {
+			// Both sums are below 2p, one subtraction reduces them
+			for (size_t j = 0; j < cols; j++) {
+				const uint64_t s =
+				    sign > 0 ? x[j] + y[j] : x[j] + (p - y[j]);
+				t[j] = s >= p ? s - p : s;
+			}
+		}
+	}
+}
+
+// T = sign * X for strided blocks
+static void block_set(const struct ring *r, const uint64_t *X,
+		      const size_t ldx, const int sign, uint64_t *T,
+		      const size_t ldt, const size_t rows, const size_t cols) {
+	for (size_t i = 0; i < rows; i++) {
+		const uint64_t *x = &X[i * ldx];
+		uint64_t *t = &T[i * ldt];
+		if (sign > 0)
+			memcpy(t, x, cols * sizeof(uint64_t));
+		else if (r->p == 0)
+			for (size_t j = 0; j < cols; j++) t[j] = -x[j];
+		else
+			for (size_t j = 0; j < cols; j++)
+				t[j] = x[j] ? r->p - x[j] : 0;
+	}
+}
+
+// C = A*B for strided views, A size mxn, B size nxk
+static int exact_matmat(const struct ring *r, const uint64_t *A,
+			const size_t lda, const uint64_t *B, const size_t ldb,
+			uint64_t *C, const size_t ldc, const size_t m,
+			const size_t n, const size_t k) {
+	if (m < EXACT_LEAF_SIZE || n < EXACT_LEAF_SIZE ||
+	    k < EXACT_LEAF_SIZE) {
+		leaf(r, A, lda, B, ldb, C, ldc, m, n, k, 0);
+		return 0;
+	}
+
+	// Strassen step on the even part, odd edges are peeled below
+	const size_t mh = m / 2, nh = n / 2, kh = k / 2;
+	uint64_t *TA = malloc((mh * nh + nh * kh + mh * kh) * sizeof(uint64_t));
+	if (TA == NULL) return -1;
+	uint64_t *TB = TA + mh * nh, *Q = TB + nh * kh;
+
+	const uint64_t *Aq[4] = {A, A + nh, A + mh * lda, A + mh * lda + nh};
+	const uint64_t *Bq[4] = {B, B + kh, B + nh * ldb, B + nh * ldb + kh};
+	uint64_t *Cq[4] = {C, C + kh, C + mh * ldc, C + mh * ldc + kh};
+	int written[4] = {0, 0, 0, 0};
+	int status = 0;
+
+	for (int idx = 0; idx < 7 && status == 0; idx++) {
+		const struct exact_product *pr = &products[idx];
+		const uint64_t *a = Aq[pr->a1], *b = Bq[pr->b1];
+		size_t la = lda, lb = ldb;
+		if (pr->a2 >= 0) {
+			block_add(r, Aq[pr->a1], lda, Aq[pr->a2], lda, pr->sa,
+				  TA, nh, mh, nh);
+			a = TA;
+			la = nh;
+		}
+		if (pr->b2 >= 0) {
+			block_add(r, Bq[pr->b1], ldb, Bq[pr->b2], ldb, pr->sb,
+				  TB, kh, nh, kh);
+			b = TB;
+			lb = kh;
+		}
+		status = exact_matmat(r, a, la, b, lb, Q, kh, mh, nh, kh);
+		for (int q = 0; q < 4 && status == 0; q++) {
+			if (pr->c[q] == 0) continue;
+			if (written[q])
+				block_add(r, Cq[q], ldc, Q, kh, pr->c[q], Cq[q],
+					  ldc, mh, kh);
+			else
+				block_set(r, Q, kh, pr->c[q], Cq[q], ldc, mh,
+					  kh);
+			written[q] = 1;
+		}
+	}
+	free(TA);
+	if (status != 0) return status;
+
+	// Odd n: the last column of A times the last row of B
+	if (n % 2)
+		leaf(r, A + 2 * nh, lda, B + 2 * nh * ldb, ldb, C, ldc, 2 * mh,
+		     1, 2 * kh, 1);
+	// Odd k: the last column of C
+	if (k % 2)
+		leaf(r, A, lda, B + 2 * kh, ldb, C + 2 * kh, ldc, 2 * mh, n, 1,
+		     0);
+	// Odd m: the last row of C
+	if (m % 2)
+		leaf(r, A + 2 * mh * lda, lda, B, ldb, C + 2 * mh * ldc, ldc, 1,
+		     n, k, 0);
+	return 0;
+}
+
+int strassen_matmat_i64(const int64_t *const A, const int64_t *const B,
+			int64_t *C, const size_t m, const size_t n,
+			const size_t k) {
+	// Two's complement wraps like unsigned arithmetic modulo 2^64
+	const struct ring r = {.p = 0};
+	return exact_matmat(&r, (const uint64_t *)A, n, (const uint64_t *)B, k,
+			    (uint64_t *)C, k, m, n, k);
+}
+
+int strassen_matmat_mod(const uint64_t *const A, const uint64_t *const B,
+			uint64_t *C, const size_t m, const size_t n,
+			const size_t k, const uint64_t p) {
+	struct ring r;
+	if (ring_init(&r, p) != 0) return -1;
+	return exact_matmat(&r, A, n, B, k, C, k, m, n, k);
+}
+
+// Inverse of a modulo p by the extended Euclidean algorithm, 0 if none
+static uint64_t inverse_mod(const uint64_t a, const uint64_t p) {
+	int64_t t = 0, new_t = 1;
+	int64_t rem = (int64_t)p, new_rem = (int64_t)(a % p);
+	while (new_rem != 0) {
+		const int64_t q = rem / new_rem, tt = t - q * new_t,
+			      tr = rem - q * new_rem;
+		t = new_t;
+		new_t = tt;
+		rem = new_rem;
+		new_rem = tr;
+	}
+	if (rem != 1) return 0;
+	return (uint64_t)(t < 0 ? t + (int64_t)p : t);
+}
+
+// X = A^-1 mod p by Gauss-Jordan elimination with pivoting
+static int gauss_jordan_mod(const uint64_t p, const uint64_t *A,
+			    const size_t lda, uint64_t *X, const size_t ldx,
+			    const size_t n) {
+	uint64_t *a = malloc(n * n * sizeof(uint64_t));
+	if (a == NULL) return -1;
+	for (size_t i = 0; i < n; i++) {
+		memcpy(&a[i * n], &A[i * lda], n * sizeof(uint64_t));
+		for (size_t j = 0; j < n; j++) X[i * ldx + j] = i == j;
+	}
+
+	int status = 0;
+	for (size_t col = 0; col < n && status == 0; col++) {
+		size_t piv = col;
+		while (piv < n && a[piv * n + col] == 0) piv++;
+		if (piv == n) {
+			status = -1;
+			break;
+		}
+		if (piv != col) {
+			for (size_t j = 0; j < n; j++) {
+				uint64_t t = a[piv * n + j];
+				a[piv * n + j] = a[col * n + j];
+				a[col * n + j] = t;
+				t = X[piv * ldx + j];
+				X[piv * ldx + j] = X[col * ldx + j];
+				X[col * ldx + j] = t;
+			}
+		}
+		const uint64_t inv = inverse_mod(a[col * n + col], p);
+		if (inv == 0) {
+			status = -1;
+			break;
+		}
+		for (size_t j = 0; j < n; j++) {
+			a[col * n + j] = a[col * n + j] * inv % p;
+			X[col * ldx + j] = X[col * ldx + j] * inv % p;
+		}
+		for (size_t i = 0; i < n; i++) {
+			const uint64_t f = a[i * n + col];
+			if (i == col || f == 0) continue;
+			// row_i -= f * row_col
+			const uint64_t g = p - f;
+			for (size_t j = 0; j < n; j++) {
+				a[i * n + j] = (a[i * n + j] +
+						g * a[col * n + j]) % p;
+				X[i * ldx + j] = (X[i * ldx + j] +
+						  g * X[col * ldx + j]) % p;
+			}
+		}
+	}
+	free(a);
+	return status;
+}
+
+// X = A^-1 by the block recursion, -1 if a leading block is singular
+static int invert_rec(const struct ring *r, const uint64_t *A,
+		      const size_t lda, uint64_t *X, const size_t ldx,
+		      const size_t n) {
+	if (n <= EXACT_LEAF_SIZE)
+		return gauss_jordan_mod(r->p, A, lda, X, ldx, n);
+
+	// Uneven halves, no padding needed
+	const size_t h = n / 2, g = n - h;
+	const uint64_t *a = A, *b = A + h, *c = A + h * lda,
+		       *d = A + h * lda + h;
+	uint64_t *e = X, *x12 = X + h, *x21 = X + h * ldx, *t = X + h * ldx + h;
+
+	uint64_t *ce = malloc((2 * g * h + g * g + h * h) * sizeof(uint64_t));
+	if (ce == NULL) return -1;
+	uint64_t *eb = ce + g * h, *Z = eb + h * g, *temp = Z + g * g;
+
+	// E = A11^-1, Z = A22 - A21 * E * A12, T = Z^-1
+	int status = invert_rec(r, a, lda, e, ldx, h);
+	if (status == 0)
+		status = exact_matmat(r, c, lda, e, ldx, ce, h, g, h, h);
+	if (status == 0)
+		status = exact_matmat(r, ce, h, b, lda, Z, g, g, h, g);
+	if (status == 0) {
+		block_add(r, d, lda, Z, g, -1, Z, g, g, g);
+		status = invert_rec(r, Z, g, t, ldx, g);
+	}
+
+	// X12 = -E*B*T, X21 = -T*C*E, X11 = E + E*B*T*C*E = E - X12*C*E
+	if (status == 0)
+		status = exact_matmat(r, e, ldx, b, lda, eb, g, h, h, g);
+	if (status == 0)
+		status = exact_matmat(r, eb, g, t, ldx, x12, ldx, h, g, g);
+	if (status == 0)
+		status = exact_matmat(r, t, ldx, ce, h, x21, ldx, g, g, h);
+	if (status == 0)
+		status = exact_matmat(r, x12, ldx, ce, h, temp, h, h, g, h);
+	if (status == 0) {
+		block_set(r, x12, ldx, -1, x12, ldx, h, g);
+		block_set(r, x21, ldx, -1, x21, ldx, g, h);
+		block_add(r, e, ldx, temp, h, 1, e, ldx, h, h);
+	}
+
+	free(ce);
+	return status;
+}
+
+int strassen_invert_mod(const uint64_t *const A, uint64_t *inverse_A,
+			const size_t n, const uint64_t p) {
+	struct ring r;
+	if (ring_init(&r, p) != 0) return -1;
+	if (invert_rec(&r, A, n, inverse_A, n, n) == 0) return 0;
+
+	// A leading block was singular (or memory ran out), pivot globally
+	return gauss_jordan_mod(p, A, n, inverse_A, n, n);
+}
@@ -4,177 +4,453 @@
  * AUTHORS: Thomas Gantz, Laura Paxton, Jan Marxen
  */
 
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "../include/IO.h"
 #include "../include/block_utilities.h"
+#include "../include/fixed_kernels.h"
 #include "../include/naive_matmat.h"
-#include "../include/strassen_matmat.h"
-
-static void id_pad_matrix(double **A, size_t n, size_t *new_n) {
-	*new_n = (n % 2 == 0) ? n : n + 1;
-	if (!(n % 2 == 0)) {
-		double *padded_A =
-		    (double *)calloc((*new_n) * (*new_n), sizeof(double));
-		for (size_t i = 0; i < n; i++) {
-			for (size_t j = 0; j < n; j++) {
-				padded_A[i * (*new_n) + j] = (*A)[i * n + j];
+#include "../include/profile.h"
+#include "../include/strassen_inv.h"
+#include "../include/strassen_plan.h"
+
+static double *alloc_zero_block(const size_t size) {
+	PROF_BEGIN(t_alloc);
+	double *block = (double *)calloc(size, sizeof(double));
+	PROF_END(t_alloc, PROF_ALLOC, size * sizeof(double));
+	return block;
+}
+
+// Write the identity into inverse_A if A is the identity
+static int invert_identity(const double *const A, double *inverse_A,
+			   const size_t n) {
+	if (!block_is_identity(A, 0, n, n)) return 0;
+	for (size_t i = 0; i < n * n; i++) inverse_A[i] = 0.0;
+	for (size_t i = 0; i < n; i++) inverse_A[i * n + i] = 1.0;
+	return 1;
+}
+
+struct invert_ctx;
+
+// C = A*B for contiguous blocks, the multiplication used by the recursion
+// Return: 0 on success, -1 if memory ran out.
+typedef int (*block_matmat)(struct invert_ctx *ctx, const double *const A,
+			    const double *const B, double *C, const size_t m,
+			    const size_t n, const size_t k);
+
+// State of one inversion
+struct invert_ctx {
+	block_matmat matmat;
+	const char *name;
+	int levels;	    // Strassen levels of the products, as max_levels
+	size_t live, peak;  // scratch bytes held and their high-water mark
+	struct inverse_info *info;  // running determinant, NULL if not needed
+};
+
+static void hold_bytes(struct invert_ctx *ctx, const size_t bytes) {
+	ctx->live += bytes;
+	if (ctx->live > ctx->peak) ctx->peak = ctx->live;
+}
+
+static void hold(struct invert_ctx *ctx, const size_t doubles) {
+	hold_bytes(ctx, doubles * sizeof(double));
+}
+
+// Free a held block and forget it
+static void release(struct invert_ctx *ctx, double **block,
+		    const size_t doubles) {
+	free(*block);
+	*block = NULL;
+	ctx->live -= doubles * sizeof(double);
+}
+
+// Bytes of the plan, nodes and workspace of the product mxn * nxk with at
+// most `levels` levels
+static size_t product_bytes(const size_t m, const size_t n, const size_t k,
+			    const int levels) {
+	const struct strassen_plan_options options = {
+	    .max_levels = levels, .external_workspace = 1};
+	struct strassen_plan *plan = strassen_plan(m, n, k, &options);
+	if (plan == NULL) return 0;
+	const size_t bytes = strassen_plan_bytes(plan);
+	strassen_plan_destroy(plan);
+	return bytes;
+}
+
+// Planned Strassen multiplication, which neither pads nor modifies A and B
+static int planned_matmat(struct invert_ctx *ctx, const double *const A,
+			  const double *const B, double *C, const size_t m,
+			  const size_t n, const size_t k) {
+	const struct strassen_plan_options options = {.max_levels =
+							  ctx->levels};
+	struct strassen_plan *plan = strassen_plan(m, n, k, &options);
+	if (plan == NULL) return -1;
+	const size_t bytes = strassen_plan_bytes(plan);
+	hold_bytes(ctx, bytes);
+	strassen_execute(plan, A, B, C);
+	ctx->live -= bytes;
+	strassen_plan_destroy(plan);
+	return 0;
+}
+
+static int leaf_matmat(struct invert_ctx *ctx, const double *const A,
+		       const double *const B, double *C, const size_t m,
+		       const size_t n, const size_t k) {
+	(void)ctx;
+	PROF_BEGIN(t_leaf);
+	naive_matmat((double *)A, (double *)B, C, m, n, k);
+	PROF_END(t_leaf, PROF_LEAF, (m * n + n * k + m * k) * sizeof(double));
+	return 0;
+}
+
+// Multiply the determinant in info by that of the small block A (size nxn,
+// at most FIXED_KERNEL_MAX), from Gaussian elimination with partial
+// pivoting
+static void leaf_det(struct inverse_info *info, const double *const A,
+		     const size_t n) {
+	double T[FIXED_KERNEL_MAX * FIXED_KERNEL_MAX];
+	memcpy(T, A, n * n * sizeof(double));
+	for (size_t j = 0; j < n; j++) {
+		size_t p = j;
+		for (size_t i = j + 1; i < n; i++)
+			if (fabs(T[i * n + j]) > fabs(T[p * n + j])) p = i;
+		if (T[p * n + j] == 0.0) {
+			info->det_sign = 0;
+			info->log_abs_det = -INFINITY;
+			return;
+		}
+		if (p != j) {
+			for (size_t l = j; l < n; l++) {
+				const double t = T[j * n + l];
+				T[j * n + l] = T[p * n + l];
+				T[p * n + l] = t;
 			}
+			info->det_sign = -info->det_sign;
 		}
-		// Fill diagonal padding with 1
-		for (size_t i = n; i < *new_n; i++) {
-			padded_A[i * (*new_n) + i] = 1;
+		const double pivot = T[j * n + j];
+		if (pivot < 0.0) info->det_sign = -info->det_sign;
+		info->log_abs_det += log(fabs(pivot));
+		for (size_t i = j + 1; i < n; i++) {
+			const double f = T[i * n + j] / pivot;
+			for (size_t l = j + 1; l < n; l++)
+				T[i * n + l] -= f * T[j * n + l];
 		}
-		free(*A);
-		*A = padded_A;
 	}
 }
 
-static void id_depad_matrix(double **padded_A, const size_t n,
-			    const size_t og_n) {
-	if (n == og_n) {
-		return;
+// Sizes the fixed-size kernels invert without recursion
+static int fixed_size(const size_t n) {
+	return n <= FIXED_KERNEL_MAX && (n & (n - 1)) == 0;
+}
+
+// Copy of the block of A (size rows x cols, A has n columns) at `start`
+static double *take_block(struct invert_ctx *ctx, const double *const A,
+			  const size_t start, const size_t rows,
+			  const size_t cols, const size_t n) {
+	hold(ctx, rows * cols);
+	return create_sub_block(A, start, rows, cols, n);
+}
+
+static double *take_zero_block(struct invert_ctx *ctx, const size_t size) {
+	hold(ctx, size);
+	return alloc_zero_block(size);
+}
+
+// Blocks held by one level of the recursion, NULL when not held
+struct held_blocks {
+	double *a, *b, *c, *d, *e, *ce, *ceb, *Z, *t, *eb, *ebt, *tce, *ebtce;
+};
+
+// Free the blocks a failed level still holds
+static void drop_held(struct held_blocks *h) {
+	double *const blocks[] = {h->a,	 h->b,	 h->c,	 h->d,	  h->e,
+				  h->ce, h->ceb, h->Z,	 h->t,	  h->eb,
+				  h->ebt, h->tce, h->ebtce};
+	for (size_t i = 0; i < sizeof(blocks) / sizeof(blocks[0]); i++)
+		free(blocks[i]);
+}
+
+static int invert_blocks(struct invert_ctx *ctx, const double *const A,
+			 double *inverse_A, const size_t n);
+
+// One block step of `invert_blocks` for A (size nxn) that is neither small
+// nor the identity, the blocks are kept in h until they are released
+// Return: 0 on success, -1 if memory ran out.
+static int invert_split(struct invert_ctx *ctx, const double *const A,
+			double *inverse_A, const size_t n,
+			struct held_blocks *h) {
+	// Blocks a (size n1xn1) and d (size n2xn2) on the diagonal, b (size
+	// n1xn2) and c (size n2xn1) off it
+	const size_t n1 = n / 2, n2 = n - n1;
+	const size_t at_b = n1, at_c = n1 * n, at_d = n1 * n + n1;
+	const block_matmat matmat = ctx->matmat;
+
+	// Products with a zero off-diagonal block (block triangular or block
+	// diagonal A) are zero and skipped
+	const int b_zero = block_is_zero(A, at_b, n1, n2, n);
+	const int c_zero = block_is_zero(A, at_c, n2, n1, n);
+
+	// Recursive inversion of a
+	h->e = take_zero_block(ctx, n1 * n1);
+	h->a = take_block(ctx, A, 0, n1, n1, n);
+	if (h->e == NULL || h->a == NULL) return -1;
+	if (invert_blocks(ctx, h->a, h->e, n1) != 0) return -1;
+	release(ctx, &h->a, n1 * n1);
+
+	// Schur complement Z = d - c*e*b and its inverse t
+	h->ce = take_zero_block(ctx, n2 * n1);
+	if (h->ce == NULL) return -1;
+	if (!c_zero) {
+		h->c = take_block(ctx, A, at_c, n2, n1, n);
+		if (h->c == NULL ||
+		    matmat(ctx, h->c, h->e, h->ce, n2, n1, n1) != 0)
+			return -1;
+		release(ctx, &h->c, n2 * n1);
 	}
-	double *A = (double *)malloc(og_n * og_n * sizeof(double));
-	for (size_t i = 0; i < og_n; i++) {
-		for (size_t j = 0; j < og_n; j++) {
-			A[i * og_n + j] = (*padded_A)[i * n + j];
-		}
+	h->ceb = take_zero_block(ctx, n2 * n2);
+	if (h->ceb == NULL) return -1;
+	if (!c_zero && !b_zero) {
+		h->b = take_block(ctx, A, at_b, n1, n2, n);
+		if (h->b == NULL ||
+		    matmat(ctx, h->ce, h->b, h->ceb, n2, n1, n2) != 0)
+			return -1;
+		release(ctx, &h->b, n1 * n2);
 	}
-	free(*padded_A);
-	*padded_A = A;
+	h->d = take_block(ctx, A, at_d, n2, n2, n);
+	if (h->d == NULL) return -1;
+	h->Z = darray_add(h->d, h->ceb, n2 * n2, -1.0);
+	if (h->Z == NULL) return -1;
+	hold(ctx, n2 * n2);
+	release(ctx, &h->d, n2 * n2);
+	release(ctx, &h->ceb, n2 * n2);
+	h->t = take_zero_block(ctx, n2 * n2);
+	if (h->t == NULL) return -1;
+	if (invert_blocks(ctx, h->Z, h->t, n2) != 0) return -1;
+	release(ctx, &h->Z, n2 * n2);
+
+	// ebt = e*b*t, the upper right block up to its sign
+	if (!b_zero) {
+		h->eb = take_zero_block(ctx, n1 * n2);
+		h->b = take_block(ctx, A, at_b, n1, n2, n);
+		if (h->eb == NULL || h->b == NULL ||
+		    matmat(ctx, h->e, h->b, h->eb, n1, n1, n2) != 0)
+			return -1;
+		release(ctx, &h->b, n1 * n2);
+		h->ebt = take_zero_block(ctx, n1 * n2);
+		if (h->ebt == NULL ||
+		    matmat(ctx, h->eb, h->t, h->ebt, n1, n2, n2) != 0)
+			return -1;
+		release(ctx, &h->eb, n1 * n2);
+	} else {
+		h->ebt = take_zero_block(ctx, n1 * n2);
+		if (h->ebt == NULL) return -1;
+	}
+
+	// Lower blocks -t*c*e and t, then the upper blocks e + ebt*c*e and
+	// -ebt; the products are not in place
+	h->tce = take_zero_block(ctx, n2 * n1);
+	if (h->tce == NULL) return -1;
+	if (!c_zero && matmat(ctx, h->t, h->ce, h->tce, n2, n2, n1) != 0)
+		return -1;
+	const double *const tce = h->tce, *const t = h->t;
+	PROF_BEGIN(t_lower);
+	for (size_t i = 0; i < n2; i++) {
+		for (size_t j = 0; j < n1; j++)
+			inverse_A[(n1 + i) * n + j] = -tce[i * n1 + j];
+		for (size_t j = 0; j < n2; j++)
+			inverse_A[(n1 + i) * n + n1 + j] = t[i * n2 + j];
+	}
+	PROF_END(t_lower, PROF_ADD, 3 * n2 * n * sizeof(double));
+	release(ctx, &h->tce, n2 * n1);
+	release(ctx, &h->t, n2 * n2);
+
+	h->ebtce = take_zero_block(ctx, n1 * n1);
+	if (h->ebtce == NULL) return -1;
+	if (!b_zero && !c_zero &&
+	    matmat(ctx, h->ebt, h->ce, h->ebtce, n1, n2, n1) != 0)
+		return -1;
+	const double *const e = h->e, *const ebtce = h->ebtce;
+	const double *const ebt = h->ebt;
+	PROF_BEGIN(t_upper);
+	for (size_t i = 0; i < n1; i++) {
+		for (size_t j = 0; j < n1; j++)
+			inverse_A[i * n + j] =
+			    e[i * n1 + j] + ebtce[i * n1 + j];
+		for (size_t j = 0; j < n2; j++)
+			inverse_A[i * n + n1 + j] = -ebt[i * n2 + j];
+	}
+	PROF_END(t_upper, PROF_ADD, 3 * n1 * n * sizeof(double));
+	release(ctx, &h->ebtce, n1 * n1);
+	release(ctx, &h->e, n1 * n1);
+	release(ctx, &h->ce, n2 * n1);
+	release(ctx, &h->ebt, n1 * n2);
+	return 0;
 }
 
-void strassen_invert_strassen_matmat(double **A, double **inverse_A, size_t n) {
-	if (n == 1) {
-		(*inverse_A)[0] = 1 / (*A)[0];
-		return;
+// Recursive block inversion of A (size nxn) into inverse_A. Odd sizes are
+// split into blocks of n/2 and n - n/2, so nothing is padded. A is left
+// unchanged, so its blocks are copied only right before they are used and
+// every block is freed as soon as it is no longer needed; `invert_estimate`
+// follows the same order. With det(A) = det(a) * det(Z) the determinant is
+// the product of those of the leaves, the identity contributes 1.
+// Return: 0 on success, -1 if memory ran out, then inverse_A is undefined.
+static int invert_blocks(struct invert_ctx *ctx, const double *const A,
+			 double *inverse_A, const size_t n) {
+	PROF_ENTER(t_call);
+
+	// Small sizes go to the unrolled fixed-size kernels
+	PROF_BEGIN(t_fixed);
+	if (n <= FIXED_KERNEL_MAX && fixed_invert(n, A, inverse_A)) {
+		PROF_END(t_fixed, PROF_LEAF, 2 * n * n * sizeof(double));
+		if (ctx->info != NULL) leaf_det(ctx->info, A, n);
+		PROF_LEAVE(t_call, ctx->name, n, n, n);
+		return 0;
 	}
 
-	size_t og_n = n;
-	id_pad_matrix(A, og_n, &n);
-	id_pad_matrix(inverse_A, og_n, &n);
-
-	// Define starting indices for submatrices
-	const size_t start_a = 0, start_b = n / 2, start_c = n / 2 * n,
-		     start_d = start_c + start_b;
-
-	// Divide matrix into blocks
-	double *a = create_block(*A, start_a, n, n);
-	double *b = create_block(*A, start_b, n, n);
-	double *c = create_block(*A, start_c, n, n);
-	double *d = create_block(*A, start_d, n, n);
-
-	// Recursive inversion of submatrices
-	double *e = (double *)calloc(n * n / 4, sizeof(double));
-	strassen_invert_strassen_matmat(&a, &e, n / 2);
-
-	double *ce = (double *)malloc(n * n / 4 * sizeof(double));
-	strassen_matmat(&c, &e, &ce, n / 2, n / 2, n / 2);
-
-	double *temp1 = (double *)malloc(n * n / 4 * sizeof(double));
-	strassen_matmat(&ce, &b, &temp1, n / 2, n / 2, n / 2);
-
-	double *Z = darray_add(d, temp1, n * n / 4, -1.0);
-	double *t = (double *)calloc(n * n / 4, sizeof(double));
-	strassen_invert_strassen_matmat(&Z, &t, n / 2);
-
-	// Compute necessary intermediate products
-	double *temp2 = (double *)malloc(n * n / 4 * sizeof(double));
-	double *ebt = (double *)malloc(n * n / 4 * sizeof(double));
-	strassen_matmat(&e, &b, &temp1, n / 2, n / 2, n / 2);
-	strassen_matmat(&temp1, &t, &ebt, n / 2, n / 2, n / 2);
-	strassen_matmat(&ebt, &ce, &temp2, n / 2, n / 2, n / 2);
-	strassen_matmat(&t, &ce, &temp1, n / 2, n / 2, n / 2);
-
-	// Assemble inverse matrix from blocks
-	mat_inplace_block_add(*inverse_A, e, temp2, start_a, n, n, 1.0, 1.0);
-	mat_inplace_block_add(*inverse_A, ebt, NULL, start_b, n, n, -1.0, 0.0);
-	mat_inplace_block_add(*inverse_A, temp1, NULL, start_c, n, n, -1.0,
-			      0.0);
-	mat_inplace_block_add(*inverse_A, t, NULL, start_d, n, n, 1.0, 0.0);
-
-	free(a);
-	free(b);
-	free(c);
-	free(d);
-	free(e);
-	free(t);
-	free(temp1);
-	free(temp2);
-	free(ce);
-	free(ebt);
-	free(Z);
-
-	// Remove padding
-	id_depad_matrix(A, n, og_n);
-	id_depad_matrix(inverse_A, n, og_n);
-}
-
-void strassen_invert_naive_matmat(double **A, double **inverse_A, size_t n) {
-	if (n == 1) {
-		(*inverse_A)[0] = 1 / (*A)[0];
-		return;
+	if (invert_identity(A, inverse_A, n)) {
+		PROF_LEAVE(t_call, ctx->name, n, n, n);
+		return 0;
 	}
 
-	size_t og_n = n;
-	id_pad_matrix(A, og_n, &n);
-	id_pad_matrix(inverse_A, og_n, &n);
-
-	// Define starting indices for submatrices
-	const size_t start_a = 0, start_b = n / 2, start_c = n / 2 * n,
-		     start_d = start_c + start_b;
-
-	// Divide matrix into blocks
-	double *a = create_block(*A, start_a, n, n);
-	double *b = create_block(*A, start_b, n, n);
-	double *c = create_block(*A, start_c, n, n);
-	double *d = create_block(*A, start_d, n, n);
-
-	// Recursive inversion of submatrices
-	double *e = (double *)calloc(n * n / 4, sizeof(double));
-	strassen_invert_naive_matmat(&a, &e, n / 2);
-
-	double *ce = (double *)malloc(n * n / 4 * sizeof(double));
-	naive_matmat(c, e, ce, n / 2, n / 2, n / 2);
-
-	double *temp1 = (double *)malloc(n * n / 4 * sizeof(double));
-	naive_matmat(ce, b, temp1, n / 2, n / 2, n / 2);
-
-	double *Z = darray_add(d, temp1, n * n / 4, -1.0);
-	double *t = (double *)calloc(n * n / 4, sizeof(double));
-	strassen_invert_naive_matmat(&Z, &t, n / 2);
-
-	// Compute necessary intermediate products
-	double *temp2 = (double *)malloc(n * n / 4 * sizeof(double));
-	double *ebt = (double *)malloc(n * n / 4 * sizeof(double));
-	naive_matmat(e, b, temp1, n / 2, n / 2, n / 2);
-	naive_matmat(temp1, t, ebt, n / 2, n / 2, n / 2);
-	naive_matmat(ebt, ce, temp2, n / 2, n / 2, n / 2);
-	naive_matmat(t, ce, temp1, n / 2, n / 2, n / 2);
-
-	// Assemble inverse matrix from blocks
-	mat_inplace_block_add(*inverse_A, e, temp2, start_a, n, n, 1.0, 1.0);
-	mat_inplace_block_add(*inverse_A, ebt, NULL, start_b, n, n, -1.0, 0.0);
-	mat_inplace_block_add(*inverse_A, temp1, NULL, start_c, n, n, -1.0,
-			      0.0);
-	mat_inplace_block_add(*inverse_A, t, NULL, start_d, n, n, 1.0, 0.0);
-
-	free(a);
-	free(b);
-	free(c);
-	free(d);
-	free(e);
-	free(t);
-	free(temp1);
-	free(temp2);
-	free(ce);
-	free(ebt);
-	free(Z);
-
-	// Remove padding
-	id_depad_matrix(A, n, og_n);
-	id_depad_matrix(inverse_A, n, og_n);
+	struct held_blocks held = {NULL};
+	const int status = invert_split(ctx, A, inverse_A, n, &held);
+	if (status != 0) drop_held(&held);
+
+	PROF_LEAVE(t_call, ctx->name, n, n, n);
+	return status;
+}
+
+// Sizes already estimated, at most two distinct sizes per recursion level
+struct estimate_memo {
+	size_t n[128], bytes[128];
+	size_t count;
+};
+
+// Scratch bytes held in `invert_estimate`, with their high-water mark
+struct estimate {
+	size_t live, peak;
+};
+
+static void estimate_hold(struct estimate *e, const size_t bytes) {
+	e->live += bytes;
+	if (e->live > e->peak) e->peak = e->live;
+}
+
+// Plan of a product or the peak of a recursive inversion, held and
+// released again
+static void estimate_call(struct estimate *e, const size_t bytes) {
+	estimate_hold(e, bytes);
+	e->live -= bytes;
 }
 
+#define PRODUCT(m, n, k) product_bytes(m, n, k, levels)
+
+// Peak scratch bytes of `invert_blocks` for size n when every product is
+// dense and no block is the identity, so an upper bound for any input
+static size_t invert_estimate(struct estimate_memo *memo, const size_t n,
+			      const int levels) {
+	if (fixed_size(n)) return 0;
+	for (size_t i = 0; i < memo->count; i++)
+		if (memo->n[i] == n) return memo->bytes[i];
+
+	const size_t n1 = n / 2, n2 = n - n1, s = sizeof(double);
+	struct estimate e = {0, 0};
+	estimate_hold(&e, 2 * n1 * n1 * s);  // e, a
+	estimate_call(&e, invert_estimate(memo, n1, levels));
+	e.live -= n1 * n1 * s;		     // a
+	estimate_hold(&e, 2 * n2 * n1 * s);  // ce, c
+	estimate_call(&e, PRODUCT(n2, n1, n1));
+	e.live -= n2 * n1 * s;		     // c
+	estimate_hold(&e, n2 * n2 * s);	     // ceb
+	estimate_hold(&e, n1 * n2 * s);	     // b
+	estimate_call(&e, PRODUCT(n2, n1, n2));
+	e.live -= n1 * n2 * s;		     // b
+	estimate_hold(&e, 2 * n2 * n2 * s);  // d, Z
+	e.live -= 2 * n2 * n2 * s;	     // d, ceb
+	estimate_hold(&e, n2 * n2 * s);	     // t
+	estimate_call(&e, invert_estimate(memo, n2, levels));
+	e.live -= n2 * n2 * s;		     // Z
+	estimate_hold(&e, 2 * n1 * n2 * s);  // eb, b
+	estimate_call(&e, PRODUCT(n1, n1, n2));
+	e.live -= n1 * n2 * s;		     // b
+	estimate_hold(&e, n1 * n2 * s);	     // ebt
+	estimate_call(&e, PRODUCT(n1, n2, n2));
+	e.live -= n1 * n2 * s;		     // eb
+	estimate_hold(&e, n2 * n1 * s);	     // tce
+	estimate_call(&e, PRODUCT(n2, n2, n1));
+	e.live -= (n2 * n1 + n2 * n2) * s;  // tce, t
+	estimate_hold(&e, n1 * n1 * s);	     // ebtce
+	estimate_call(&e, PRODUCT(n1, n2, n1));
+
+	if (memo->count < 128) {
+		memo->n[memo->count] = n;
+		memo->bytes[memo->count++] = e.peak;
+	}
+	return e.peak;
+}
+
+#undef PRODUCT
+
+static int invert(const double *const A, double *inverse_A, const size_t n,
+		  const block_matmat matmat, const char *name) {
+	struct invert_ctx ctx = {.matmat = matmat, .name = name};
+	return invert_blocks(&ctx, A, inverse_A, n);
+}
+
+int strassen_invert(const double *const A, double *inverse_A,
+		    const size_t n) {
+	return invert(A, inverse_A, n, planned_matmat, "strassen_invert");
+}
+
+int strassen_invert_info(const double *const A, double *inverse_A,
+			 const size_t n, struct inverse_info *info) {
+	*info = (struct inverse_info){.det_sign = 1, .log_abs_det = 0.0};
+	struct invert_ctx ctx = {.matmat = planned_matmat,
+				 .name = "strassen_invert_info",
+				 .info = info};
+	if (invert_blocks(&ctx, A, inverse_A, n) != 0) return -1;
+	info->cond1 = block_norm1(A, n, n) * block_norm1(inverse_A, n, n);
+	return 0;
+}
+
+int strassen_invert_budget(const double *const A, double *inverse_A,
+			   const size_t n, struct strassen_memory *memory) {
+	// Most Strassen levels first: unlimited, then a bound that shrinks
+	// down to none
+	int max_depth = 0;
+	while (((size_t)1 << max_depth) < n) max_depth++;
+	int levels = 0;
+	for (int L = max_depth + 1;; L--) {
+		levels = L > max_depth ? 0 : L > 0 ? L : -1;
+		struct estimate_memo memo = {.count = 0};
+		memory->estimate = invert_estimate(&memo, n, levels);
+		if (memory->budget == 0 || memory->estimate <= memory->budget)
+			break;
+		if (L <= 0) {
+			memory->peak = 0;
+			memory->levels = levels;
+			return -1;  // even the classical schedule is too big
+		}
+	}
+
+	struct invert_ctx ctx = {.matmat = planned_matmat,
+				 .name = "strassen_invert_budget",
+				 .levels = levels};
+	const int status = invert_blocks(&ctx, A, inverse_A, n);
+	memory->peak = ctx.peak;
+	memory->levels = levels;
+	return status;
+}
+
+int strassen_invert_strassen_matmat(double **A, double **inverse_A, size_t n) {
+	return invert(*A, *inverse_A, n, planned_matmat,
+		      "strassen_invert_strassen_matmat");
+}
+
+int strassen_invert_naive_matmat(double **A, double **inverse_A, size_t n) {
+	return invert(*A, *inverse_A, n, leaf_matmat,
+		      "strassen_invert_naive_matmat");
+}
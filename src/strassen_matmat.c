@@ -8,159 +8,337 @@
 #include <stdlib.h>
 
 #include "../include/block_utilities.h"
+#include "../include/fixed_kernels.h"
 #include "../include/naive_matmat.h"
+#include "../include/profile.h"
+#include "../include/strassen_matmat.h"
+#include "../include/strassen_plan.h"
 
-static void pad_matrix(double **A, size_t m, size_t n, size_t *new_m,
-		       size_t *new_n) {
-	*new_m = (m % 2 == 0) ? m : m + 1;  // Ensure rows are even
-	*new_n = (n % 2 == 0) ? n : n + 1;  // Ensure columns are even
+// Cost of one element of a block addition relative to one multiply-add, the
+// additions are memory bound and run far below peak
+#define ADD_COST 8.0
 
-	if (!(m % 2 == 0) || !(n % 2 == 0)) {
-		// Allocate new memory for the padded matrix
-		double *padded_A =
-		    (double *)calloc((*new_m) * (*new_n), sizeof(double));
+static double *alloc_block(const size_t size) {
+	PROF_BEGIN(t_alloc);
+	double *block = (double *)malloc(size * sizeof(double));
+	PROF_END(t_alloc, PROF_ALLOC, size * sizeof(double));
+	return block;
+}
+
+static size_t max3(const size_t a, const size_t b, const size_t c) {
+	const size_t ab = a > b ? a : b;
+	return ab > c ? ab : c;
+}
+
+static size_t min3(const size_t a, const size_t b, const size_t c) {
+	const size_t ab = a < b ? a : b;
+	return ab < c ? ab : c;
+}
+
+enum strassen_step strassen_choose_step(const size_t m, const size_t n,
+					const size_t k,
+					const size_t leaf_size) {
+	// Degenerate shapes have dedicated vector kernels
+	if (k == 1) return STEP_GEMV;
+	if (m == 1) return STEP_GEVM;
+	if (n == 1) return STEP_OUTER;
+
+	// If matrices are too small, fallback to naive matrix multiplication
+	if (m < leaf_size && n < leaf_size && k < leaf_size) return STEP_LEAF;
+
+	// One Strassen step saves a product of size m/2 x n/2 x k/2 but adds
+	// 7 blocks of A and of B and 12 blocks of C (quarter size each)
+	const double saved = (double)m * n * k / 8.0;
+	const double added =
+	    ADD_COST * (7.0 * m * n + 7.0 * n * k + 12.0 * m * k) / 4.0;
+
+	// Split elongated or unprofitable shapes along the dominant dimension
+	const size_t largest = max3(m, n, k);
+	if (largest >= 2 * min3(m, n, k) || saved <= added) {
+		if (largest == m) return STEP_SPLIT_M;
+		if (largest == k) return STEP_SPLIT_K;
+		return STEP_SPLIT_N;
+	}
+
+	return STEP_STRASSEN;
+}
+
+double strassen_matmat_cost(const size_t m, const size_t n, const size_t k,
+			    const size_t leaf_size) {
+	const double mul = (double)m * n * k;
+	switch (strassen_choose_step(m, n, k, leaf_size)) {
+		case STEP_SPLIT_M:
+			return strassen_matmat_cost(m / 2, n, k, leaf_size) +
+			       strassen_matmat_cost(m - m / 2, n, k, leaf_size);
+		case STEP_SPLIT_N:
+			// The second half is added onto the first
+			return strassen_matmat_cost(m, n / 2, k, leaf_size) +
+			       strassen_matmat_cost(m, n - n / 2, k,
+						    leaf_size) +
+			       ADD_COST * m * k;
+		case STEP_SPLIT_K:
+			return strassen_matmat_cost(m, n, k / 2, leaf_size) +
+			       strassen_matmat_cost(m, n, k - k / 2, leaf_size);
+		case STEP_STRASSEN: {
+			// Odd dimensions are peeled with vector kernels
+			const size_t me = m & ~(size_t)1, ne = n & ~(size_t)1,
+				     ke = k & ~(size_t)1;
+			const double peel = mul - (double)me * ne * ke;
+			return 7.0 * strassen_matmat_cost(m / 2, n / 2, k / 2,
+							  leaf_size) +
+			       ADD_COST *
+				   (7.0 * m * n + 7.0 * n * k + 12.0 * m * k) /
+				   4.0 +
+			       peel;
+		}
+		default:
+			return mul;
+	}
+}
+
+// C = A*x for a vector x (k == 1)
+static void gemv(const double *const A, const double *const x, double *C,
+		 const size_t m, const size_t n) {
+	for (size_t i = 0; i < m; i++) {
+		double sum = 0.0;
+		for (size_t l = 0; l < n; l++) sum += A[i * n + l] * x[l];
+		C[i] = sum;
+	}
+}
 
-		// Copy the original data into the padded matrix
-		for (size_t i = 0; i < m; i++)
-			for (size_t j = 0; j < n; j++)
-				padded_A[i * (*new_n) + j] = (*A)[i * n + j];
+// C = x*B for a row vector x (m == 1)
+static void gevm(const double *const x, const double *const B, double *C,
+		 const size_t n, const size_t k) {
+	for (size_t j = 0; j < k; j++) C[j] = 0.0;
+	for (size_t l = 0; l < n; l++) {
+		for (size_t j = 0; j < k; j++) C[j] += x[l] * B[l * k + j];
+	}
+}
 
-		free(*A);	// Free the old memory
-		*A = padded_A;	// Point to the new padded matrix
+// C = x*y for a column vector x and a row vector y (n == 1)
+static void outer_product(const double *const x, const double *const y,
+			  double *C, const size_t m, const size_t k) {
+	for (size_t i = 0; i < m; i++) {
+		for (size_t j = 0; j < k; j++) C[i * k + j] = x[i] * y[j];
 	}
 }
 
-static void depad_matrix(double **padded_A, size_t m, size_t n, size_t og_m,
-			 size_t og_n) {
-	// If no padding was applied, no action is needed
-	if (m == og_m && n == og_n) {
-		return;
+// Classic split of one dimension into two (possibly uneven) halves, no
+// padding is needed
+static void split_matmat(double **A, double **B, double **C, const size_t m,
+			 const size_t n, const size_t k,
+			 const enum strassen_step step) {
+	if (step == STEP_SPLIT_M) {
+		// [C1; C2] = [A1; A2] * B
+		const size_t m1 = m / 2, m2 = m - m1;
+		double *A1 = create_sub_block(*A, 0, m1, n, n);
+		double *A2 = create_sub_block(*A, m1 * n, m2, n, n);
+		double *C1 = alloc_block(m1 * k);
+		double *C2 = alloc_block(m2 * k);
+		strassen_matmat(&A1, B, &C1, m1, n, k);
+		strassen_matmat(&A2, B, &C2, m2, n, k);
+		set_sub_block(*C, C1, 0, m1, k, k);
+		set_sub_block(*C, C2, m1 * k, m2, k, k);
+		free(A1);
+		free(A2);
+		free(C1);
+		free(C2);
+	} else if (step == STEP_SPLIT_K) {
+		// [C1 C2] = A * [B1 B2]
+		const size_t k1 = k / 2, k2 = k - k1;
+		double *B1 = create_sub_block(*B, 0, n, k1, k);
+		double *B2 = create_sub_block(*B, k1, n, k2, k);
+		double *C1 = alloc_block(m * k1);
+		double *C2 = alloc_block(m * k2);
+		strassen_matmat(A, &B1, &C1, m, n, k1);
+		strassen_matmat(A, &B2, &C2, m, n, k2);
+		set_sub_block(*C, C1, 0, m, k1, k);
+		set_sub_block(*C, C2, k1, m, k2, k);
+		free(B1);
+		free(B2);
+		free(C1);
+		free(C2);
+	} else {
+		// C = [A1 A2] * [B1; B2] = A1*B1 + A2*B2
+		const size_t n1 = n / 2, n2 = n - n1;
+		double *A1 = create_sub_block(*A, 0, m, n1, n);
+		double *A2 = create_sub_block(*A, n1, m, n2, n);
+		double *B1 = create_sub_block(*B, 0, n1, k, k);
+		double *B2 = create_sub_block(*B, n1 * k, n2, k, k);
+		double *C2 = alloc_block(m * k);
+		strassen_matmat(&A1, &B1, C, m, n1, k);
+		strassen_matmat(&A2, &B2, &C2, m, n2, k);
+		strided_block_acc(*C, k, C2, k, m, k, 1.0, 1.0);
+		free(A1);
+		free(A2);
+		free(B1);
+		free(B2);
+		free(C2);
 	}
+}
 
-	// Allocate memory for the original matrix without padded extra space
-	double *A = (double *)malloc(og_m * og_n * sizeof(double));
+// Structure of a quadrant that lets products be pruned
+enum block_kind { BLOCK_DENSE, BLOCK_ZERO, BLOCK_IDENTITY };
 
-	// Copy valid elements back from the padded matrix
-	for (size_t i = 0; i < og_m; i++) {
-		for (size_t j = 0; j < og_n; j++) {
-			A[i * og_n + j] = (*padded_A)[i * n + j];
+static enum block_kind classify_block(const double *const A,
+				      const size_t start, const size_t rows,
+				      const size_t cols, const size_t ld) {
+	if (block_is_zero(A, start, rows, cols, ld)) return BLOCK_ZERO;
+	if (rows == cols && block_is_identity(A, start, rows, ld))
+		return BLOCK_IDENTITY;
+	return BLOCK_DENSE;
+}
+
+// Classic 2x2 block product that skips every pair with a zero quadrant and
+// adds the other factor directly for identity quadrants. Only taken when
+// fewer than 8 dense products remain, otherwise a Strassen step does less
+// work.
+// Return: 1 if C was computed, 0 if no quadrant is zero or identity.
+static int structured_matmat(double **A, double **B, double **C,
+			     const size_t m, const size_t n, const size_t k) {
+	// Uneven halves, no padding needed
+	const size_t rows[2] = {m / 2, m - m / 2};
+	const size_t inner[2] = {n / 2, n - n / 2};
+	const size_t cols[2] = {k / 2, k - k / 2};
+
+	enum block_kind kind_a[2][2], kind_b[2][2];
+	int dense_products = 0;
+	for (int i = 0; i < 2; i++) {
+		for (int l = 0; l < 2; l++) {
+			kind_a[i][l] = classify_block(
+			    *A, i * rows[0] * n + l * inner[0], rows[i],
+			    inner[l], n);
+			kind_b[i][l] = classify_block(
+			    *B, i * inner[0] * k + l * cols[0], inner[i],
+			    cols[l], k);
 		}
 	}
+	for (int i = 0; i < 2; i++)
+		for (int l = 0; l < 2; l++)
+			for (int j = 0; j < 2; j++)
+				dense_products +=
+				    kind_a[i][l] == BLOCK_DENSE &&
+				    kind_b[l][j] == BLOCK_DENSE;
+	if (dense_products == 8) return 0;
 
-	free(*padded_A);  // Free padded memory
-	*padded_A = A;	  // Point to the depadded version
+	for (size_t i = 0; i < m * k; i++) (*C)[i] = 0;
+	for (int i = 0; i < 2; i++) {
+		for (int j = 0; j < 2; j++) {
+			double *R = *C + i * rows[0] * k + j * cols[0];
+			for (int l = 0; l < 2; l++) {
+				const size_t start_a =
+				    i * rows[0] * n + l * inner[0];
+				const size_t start_b =
+				    l * inner[0] * k + j * cols[0];
+				if (kind_a[i][l] == BLOCK_ZERO ||
+				    kind_b[l][j] == BLOCK_ZERO)
+					continue;
+				if (kind_a[i][l] == BLOCK_IDENTITY) {
+					strided_block_acc(R, k, *B + start_b, k,
+							  rows[i], cols[j], 1.0,
+							  1.0);
+					continue;
+				}
+				if (kind_b[l][j] == BLOCK_IDENTITY) {
+					strided_block_acc(R, k, *A + start_a, n,
+							  rows[i], cols[j], 1.0,
+							  1.0);
+					continue;
+				}
+				double *a = create_sub_block(
+				    *A, start_a, rows[i], inner[l], n);
+				double *b = create_sub_block(
+				    *B, start_b, inner[l], cols[j], k);
+				double *p = alloc_block(rows[i] * cols[j]);
+				strassen_matmat(&a, &b, &p, rows[i], inner[l],
+						cols[j]);
+				strided_block_acc(R, k, p, cols[j], rows[i],
+						  cols[j], 1.0, 1.0);
+				free(a);
+				free(b);
+				free(p);
+			}
+		}
+	}
+	return 1;
 }
 
 void strassen_matmat(double **A, double **B, double **C, size_t m, size_t n,
 		     size_t k) {
-	// If matrices are too small, fallback to naive matrix multiplication
-	if (m < 512 && n < 512 && k < 512) {
+	PROF_ENTER(t_call);
+
+	const enum strassen_step step =
+	    strassen_choose_step(m, n, k, STRASSEN_LEAF_SIZE);
+	if (step == STEP_LEAF) {
+		PROF_BEGIN(t_leaf);
+		if (m != n || n != k ||
+		    !fixed_matmat(n, *A, n, *B, k, *C, k, 0))
+			naive_matmat(*A, *B, *C, m, n, k);
+		PROF_END(t_leaf, PROF_LEAF,
+			 (m * n + n * k + m * k) * sizeof(double));
+	} else if (step == STEP_GEMV || step == STEP_GEVM ||
+		   step == STEP_OUTER) {
+		// Handle degenerate vector shapes without recursion
+		PROF_BEGIN(t_leaf);
+		if (step == STEP_GEMV)
+			gemv(*A, *B, *C, m, n);
+		else if (step == STEP_GEVM)
+			gevm(*A, *B, *C, n, k);
+		else
+			outer_product(*A, *B, *C, m, k);
+		PROF_END(t_leaf, PROF_LEAF,
+			 (m * n + n * k + m * k) * sizeof(double));
+	} else if (step != STEP_STRASSEN) {
+		split_matmat(A, B, C, m, n, k, step);
+	} else if (structured_matmat(A, B, C, m, n, k)) {
+		// Zero or identity quadrants were pruned
+	} else if (strassen_matmat_r(*A, *B, *C, m, n, k) != 0) {
+		// Dense quadrants: the Strassen step and everything below it
+		// run through a plan, which peels odd dimensions with vector
+		// kernels as `strassen_matmat_cost` assumes. Without memory for
+		// the plan the product is computed classically.
 		naive_matmat(*A, *B, *C, m, n, k);
-	} else if (m == 1 && n == 1) {
-		// Handle base case of single-element multiplication
-		for (size_t i = 0; i < m * k; i++) (*C)[i] = (*A)[0] * (*B)[i];
-	} else if (n == 1 && k == 1) {
-		// Handle special single-row/column edge case
-		for (size_t i = 0; i < m * k; i++) (*C)[i] = (*A)[i] * (*B)[0];
-	} else {
-		// Initialize result matrix to zero
-		for (size_t i = 0; i < m * k; i++) (*C)[i] = 0;
-
-		// Pad matrices to ensure they have compatible even dimensions
-		size_t og_m = m;
-		size_t og_n = n;
-		size_t og_k = k;
-		pad_matrix(A, og_m, og_n, &m, &n);
-		pad_matrix(B, og_n, og_k, &n, &k);
-		pad_matrix(C, og_m, og_k, &m, &k);
-
-		// Subdivide matrices into blocks for Strassen's recursive
-		// computation
-		const size_t start_a = 0;
-		const size_t start_x = 0;
-		const size_t start_r11 = 0;
-		const size_t start_b = n / 2;
-		const size_t start_y = k / 2;
-		const size_t start_r12 = k / 2;
-		const size_t start_c = m / 2 * n;
-		const size_t start_z = n / 2 * k;
-		const size_t start_r21 = m / 2 * k;
-		const size_t start_d = start_c + start_b;
-		const size_t start_t = start_y + start_z;
-		const size_t start_r22 = start_r12 + start_r21;
-
-		// Extract matrix blocks (allocate contiguous memory dynamically
-		// for sub-matrices)
-		double *a = create_block(*A, start_a, m, n);
-		double *d = create_block(*A, start_d, m, n);
-		double *y = create_block(*B, start_y, n, k);
-		double *z = create_block(*B, start_z, n, k);
-
-		double *tempA =
-		    (double *)malloc(m / 2 * n / 2 * sizeof(double));
-		double *tempB =
-		    (double *)malloc(n / 2 * k / 2 * sizeof(double));
-
-		// Strassen's recursive multiplications
-		double *q1 = (double *)malloc(m * k / 4 * sizeof(double));
-		darray_block_add(*B, tempB, start_x, start_z, n, k, 1.0);
-		strassen_matmat(&a, &tempB, &q1, m / 2, n / 2, k / 2);
-		free(a);
-
-		double *q2 = (double *)malloc(m * k / 4 * sizeof(double));
-		darray_block_add(*B, tempB, start_y, start_t, n, k, 1.0);
-		strassen_matmat(&d, &tempB, &q2, m / 2, n / 2, k / 2);
-		free(d);
-
-		double *q3 = (double *)malloc(m * k / 4 * sizeof(double));
-		darray_block_add(*A, tempA, start_d, start_a, m, n, -1.0);
-		darray_block_add(*B, tempB, start_z, start_y, n, k, -1.0);
-		strassen_matmat(&tempA, &tempB, &q3, m / 2, n / 2, k / 2);
-
-		double *q4 = (double *)malloc(m * k / 4 * sizeof(double));
-		darray_block_add(*A, tempA, start_b, start_d, m, n, -1.0);
-		darray_block_add(*B, tempB, start_z, start_t, n, k, 1.0);
-		strassen_matmat(&tempA, &tempB, &q4, m / 2, n / 2, k / 2);
-
-		double *q5 = (double *)malloc(m * k / 4 * sizeof(double));
-		darray_block_add(*A, tempA, start_b, start_a, m, n, -1.0);
-		strassen_matmat(&tempA, &z, &q5, m / 2, n / 2, k / 2);
-		free(z);
-
-		double *q6 = (double *)malloc(m * k / 4 * sizeof(double));
-		darray_block_add(*A, tempA, start_c, start_a, m, n, -1.0);
-		darray_block_add(*B, tempB, start_x, start_y, n, k, 1.0);
-		strassen_matmat(&tempA, &tempB, &q6, m / 2, n / 2, k / 2);
-
-		double *q7 = (double *)malloc(m * k / 4 * sizeof(double));
-		darray_block_add(*A, tempA, start_c, start_d, m, n, -1.0);
-		strassen_matmat(&tempA, &y, &q7, m / 2, n / 2, k / 2);
-		free(y);
-
-		// Calculate the R blocks
-		// R11
-		mat_inplace_block_add(*C, q1, q5, start_r11, m, k, 1.0, 1.0);
-		// R21
-		mat_inplace_block_add(*C, q1, q3, start_r21, m, k, 1.0, 1.0);
-		mat_inplace_block_add(*C, q6, q7, start_r21, m, k, 1.0, -1.0);
-		// R12
-		mat_inplace_block_add(*C, q2, q3, start_r12, m, k, 1.0, 1.0);
-		mat_inplace_block_add(*C, q4, q5, start_r12, m, k, 1.0, -1.0);
-		// R22
-		mat_inplace_block_add(*C, q2, q7, start_r22, m, k, 1.0, 1.0);
-
-		free(q1);
-		free(q2);
-		free(q3);
-		free(q4);
-		free(q5);
-		free(q6);
-		free(q7);
-
-		// Cleanup padding
-		depad_matrix(A, m, n, og_m, og_n);
-		depad_matrix(B, n, k, og_n, og_k);
-		depad_matrix(C, m, k, og_m, og_k);
 	}
+
+	PROF_LEAVE(t_call, "strassen_matmat", m, n, k);
 }
 
+int strassen_matmat_r(const double *const A, const double *const B,
+		      double *C, const size_t m, const size_t n,
+		      const size_t k) {
+	// The plan and its workspace belong to this call only
+	struct strassen_plan *plan = strassen_plan(m, n, k, NULL);
+	if (plan == NULL) return -1;
+	strassen_execute(plan, A, B, C);
+	strassen_plan_destroy(plan);
+	return 0;
+}
+
+int strassen_matmat_budget(const double *const A, const double *const B,
+			   double *C, const size_t m, const size_t n,
+			   const size_t k, struct strassen_memory *memory) {
+	// The workspace is allocated only once the plan is known to fit
+	const struct strassen_plan_options options = {
+	    .memory_budget = memory->budget, .external_workspace = 1};
+	struct strassen_plan *plan = strassen_plan(m, n, k, &options);
+	memory->peak = 0;
+	if (plan == NULL) return -1;
+	memory->levels = plan->options.max_levels;
+	memory->estimate = strassen_plan_bytes(plan);
+	double *workspace = NULL;
+	if (memory->budget == 0 || memory->estimate <= memory->budget)
+		workspace = malloc((plan->workspace_size + 1) * sizeof(double));
+	if (workspace == NULL) {
+		strassen_plan_destroy(plan);
+		return -1;
+	}
+
+	// Plan, nodes and workspace are all held for the whole product
+	memory->peak = sizeof(struct strassen_plan) +
+		       plan->num_nodes * sizeof(struct strassen_plan_node) +
+		       plan->workspace_size * sizeof(double);
+	strassen_execute_ws(plan, A, B, C, workspace);
+	free(workspace);
+	strassen_plan_destroy(plan);
+	return 0;
+}
@@ -0,0 +1,836 @@
+/*
+ * DESC: Module for reusable execution plans of Strassen multiplication.
+ * AUTHORS: Thomas Gantz, Laura Paxton, Jan Marxen
+ */
+#include "../include/strassen_plan.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/block_utilities.h"
+#include "../include/fixed_kernels.h"
+#include "../include/profile.h"
+
+// Version of the text format written by strassen_plan_save
+#define PLAN_FORMAT_VERSION 1
+
+// Stand-in for an unlimited number of Strassen levels
+#define UNLIMITED_LEVELS 64
+
+// Nodes under construction, levels[i] is the Strassen budget of nodes[i]
+struct plan_builder {
+	struct strassen_plan_node *nodes;
+	int *levels;
+	size_t num_nodes;
+	size_t capacity;
+	size_t leaf_size;
+};
+
+static size_t max_size(const size_t a, const size_t b) {
+	return a > b ? a : b;
+}
+
+// Workspace of a Strassen step itself: one product, one sum of A blocks and
+// one sum of B blocks, all for the even part of the problem
+static size_t strassen_step_workspace(const size_t m, const size_t n,
+				      const size_t k) {
+	return (m / 2) * (n / 2) + (n / 2) * (k / 2) + (m / 2) * (k / 2);
+}
+
+// Classic split of the largest dimension, used once the Strassen levels are
+// exhausted
+static enum strassen_step classic_split(const size_t m, const size_t n,
+					const size_t k) {
+	if (m >= n && m >= k) return STEP_SPLIT_M;
+	if (k >= n) return STEP_SPLIT_K;
+	return STEP_SPLIT_N;
+}
+
+// Index of the node for the shape, -1 if memory ran out
+static int build_node(struct plan_builder *b, const size_t m, const size_t n,
+		      const size_t k, const int levels) {
+	// Share nodes of equal shape and budget
+	for (size_t i = 0; i < b->num_nodes; i++) {
+		const struct strassen_plan_node *node = &b->nodes[i];
+		if (node->m == m && node->n == n && node->k == k &&
+		    b->levels[i] == levels)
+			return (int)i;
+	}
+
+	// Reserve the slot before the children so that the root is node 0
+	if (b->num_nodes == b->capacity) {
+		const size_t capacity = b->capacity ? 2 * b->capacity : 16;
+		struct strassen_plan_node *nodes =
+		    realloc(b->nodes, capacity * sizeof(*b->nodes));
+		if (nodes == NULL) return -1;
+		b->nodes = nodes;
+		int *levels_of = realloc(b->levels, capacity * sizeof(int));
+		if (levels_of == NULL) return -1;
+		b->levels = levels_of;
+		b->capacity = capacity;
+	}
+	const int idx = (int)b->num_nodes++;
+	b->nodes[idx] = (struct strassen_plan_node){.m = 0, .child = {-1, -1}};
+	b->levels[idx] = levels;
+
+	struct strassen_plan_node node = {.m = m,
+					  .n = n,
+					  .k = k,
+					  .child = {-1, -1},
+					  .workspace = 0};
+	node.step = strassen_choose_step(m, n, k, b->leaf_size);
+	if (node.step == STEP_STRASSEN && levels == 0)
+		node.step = classic_split(m, n, k);
+
+	int c0, c1;
+	switch (node.step) {
+		case STEP_STRASSEN:
+			c0 = build_node(b, m / 2, n / 2, k / 2, levels - 1);
+			if (c0 < 0) return -1;
+			node.child[0] = c0;
+			node.workspace = strassen_step_workspace(m, n, k) +
+					 b->nodes[c0].workspace;
+			break;
+		case STEP_SPLIT_M:
+			c0 = build_node(b, m / 2, n, k, levels);
+			c1 = build_node(b, m - m / 2, n, k, levels);
+			break;
+		case STEP_SPLIT_N:
+			c0 = build_node(b, m, n / 2, k, levels);
+			c1 = build_node(b, m, n - n / 2, k, levels);
+			break;
+		case STEP_SPLIT_K:
+			c0 = build_node(b, m, n, k / 2, levels);
+			c1 = build_node(b, m, n, k - k / 2, levels);
+			break;
+		default:
+			// Leaf kernels need no workspace
+			c0 = c1 = -1;
+			break;
+	}
+	if (node.step == STEP_SPLIT_M || node.step == STEP_SPLIT_N ||
+	    node.step == STEP_SPLIT_K) {
+		if (c0 < 0 || c1 < 0) return -1;
+		// Both halves run one after the other in the same workspace
+		node.child[0] = c0;
+		node.child[1] = c1;
+		node.workspace =
+		    max_size(b->nodes[c0].workspace, b->nodes[c1].workspace);
+	}
+
+	b->nodes[idx] = node;
+	return idx;
+}
+
+// Largest number of Strassen steps on any path of the plan
+static int strassen_depth(const struct strassen_plan *plan, const int idx) {
+	const struct strassen_plan_node *node = &plan->nodes[idx];
+	int depth = 0;
+	for (int c = 0; c < 2; c++)
+		if (node->child[c] >= 0) {
+			const int d = strassen_depth(plan, node->child[c]);
+			if (d > depth) depth = d;
+		}
+	return depth + (node->step == STEP_STRASSEN);
+}
+
+struct strassen_plan *strassen_plan(
+    const size_t m, const size_t n, const size_t k,
+    const struct strassen_plan_options *options) {
+	struct strassen_plan *plan = calloc(1, sizeof(struct strassen_plan));
+	if (plan == NULL) return NULL;
+
+	plan->m = m;
+	plan->n = n;
+	plan->k = k;
+	if (options != NULL) plan->options = *options;
+	if (plan->options.leaf_size == 0)
+		plan->options.leaf_size = STRASSEN_LEAF_SIZE;
+
+	int levels = plan->options.max_levels;
+	if (levels == 0)
+		levels = UNLIMITED_LEVELS;
+	else if (levels < 0)
+		levels = 0;
+	for (;;) {
+		struct plan_builder b = {.leaf_size = plan->options.leaf_size};
+		const int root = build_node(&b, m, n, k, levels);
+		free(b.levels);
+		if (root < 0) {
+			free(b.nodes);
+			b.nodes = NULL;
+		}
+		plan->nodes = b.nodes;
+		plan->num_nodes = b.num_nodes;
+		if (plan->nodes == NULL) break;
+		plan->workspace_size = plan->nodes[0].workspace;
+
+		// Give up Strassen levels until the plan fits the budget,
+		// without any the products need no workspace
+		const size_t budget = plan->options.memory_budget;
+		const int depth = strassen_depth(plan, 0);
+		if (budget == 0 || levels == 0 || depth == 0 ||
+		    strassen_plan_bytes(plan) <= budget)
+			break;
+		levels = depth - 1;
+		free(plan->nodes);
+	}
+	plan->options.max_levels = levels == UNLIMITED_LEVELS ? 0
+				   : levels > 0		      ? levels
+							      : -1;
+	if (!plan->options.external_workspace)
+		plan->workspace = malloc(max_size(plan->workspace_size, 1) *
+					 sizeof(double));
+	if (plan->nodes == NULL ||
+	    (!plan->options.external_workspace && plan->workspace == NULL)) {
+		strassen_plan_destroy(plan);
+		return NULL;
+	}
+
+	return plan;
+}
+
+void strassen_plan_destroy(struct strassen_plan *plan) {
+	if (plan == NULL) return;
+	free(plan->nodes);
+	free(plan->workspace);
+	free(plan);
+}
+
+size_t strassen_plan_bytes(const struct strassen_plan *plan) {
+	return sizeof(struct strassen_plan) +
+	       plan->num_nodes * sizeof(struct strassen_plan_node) +
+	       plan->workspace_size * sizeof(double);
+}
+
+// C = A*B + beta*C for strided views, beta is 0 or 1
+static void leaf_matmat(const double *A, const size_t lda, const double *B,
+			const size_t ldb, double *C, const size_t ldc,
+			const size_t m, const size_t n, const size_t k,
+			const int beta) {
+	if (m == n && n == k && fixed_matmat(n, A, lda, B, ldb, C, ldc, beta))
+		return;
+	for (size_t i = 0; i < m; i++) {
+		double *c = &C[i * ldc];
+		if (!beta)
+			for (size_t j = 0; j < k; j++) c[j] = 0.0;
+		// Row-wise updates keep the innermost loop contiguous
+		for (size_t l = 0; l < n; l++) {
+			const double a = A[i * lda + l];
+			const double *b = &B[l * ldb];
+			for (size_t j = 0; j < k; j++) c[j] += a * b[j];
+		}
+	}
+}
+
+// C = A*x + beta*C for a column vector x with stride ldb (k == 1)
+static void leaf_gemv(const double *A, const size_t lda, const double *x,
+		      const size_t ldb, double *C, const size_t ldc,
+		      const size_t m, const size_t n, const int beta) {
+	for (size_t i = 0; i < m; i++) {
+		double sum = beta ? C[i * ldc] : 0.0;
+		for (size_t l = 0; l < n; l++)
+			sum += A[i * lda + l] * x[l * ldb];
+		C[i * ldc] = sum;
+	}
+}
+
+// `packed`, if not NULL, is a cursor into the A-side sums of a prepared
+// operand, which replace the sums of A blocks (see strassen_prepare_a)
+static void exec_node(const struct strassen_plan *plan, const int idx,
+		      const double *A, const size_t lda, const double *B,
+		      const size_t ldb, double *C, const size_t ldc, double *ws,
+		      const int beta, const double **packed);
+
+// One product of a Strassen step: (A[a1] + sa * A[a2]) * (B[b1] + sb * B[b2])
+// is added with weight c[i] to quadrant i of C. Quadrants are numbered
+// 11, 12, 21, 22 -> 0, 1, 2, 3, an unused second operand is -1.
+struct strassen_product {
+	int a1, a2;
+	double sa;
+	int b1, b2;
+	double sb;
+	double c[4];
+};
+
+static const struct strassen_product products[STRASSEN_PRODUCTS] = {
+    {0, -1, 0.0, 0, 2, 1.0, {1, 0, 1, 0}},    // q1 = a * (x + z)
+    {3, -1, 0.0, 1, 3, 1.0, {0, 1, 0, 1}},    // q2 = d * (y + t)
+    {3, 0, -1.0, 2, 1, -1.0, {0, 1, 1, 0}},   // q3 = (d - a) * (z - y)
+    {1, 3, -1.0, 2, 3, 1.0, {0, 1, 0, 0}},    // q4 = (b - d) * (z + t)
+    {1, 0, -1.0, 2, -1, 0.0, {1, -1, 0, 0}},  // q5 = (b - a) * z
+    {2, 0, -1.0, 0, 1, 1.0, {0, 0, 1, 0}},    // q6 = (c - a) * (x + y)
+    {2, 3, -1.0, 1, -1, 0.0, {0, 0, -1, 1}},  // q7 = (c - d) * y
+};
+
+// Views of the four quadrants of a matrix with hr x hc quadrants
+static void quadrants(const double *M, const size_t ld, const size_t hr,
+		      const size_t hc, const double *q[4]) {
+	q[0] = M;
+	q[1] = M + hc;
+	q[2] = M + hr * ld;
+	q[3] = M + hr * ld + hc;
+}
+
+// Operand of a product: a quadrant view, or the sum of two written to T
+static const double *operand(const double *const q[4], const size_t ld,
+			     const int i1, const int i2, const double s,
+			     double *T, const size_t rows, const size_t cols,
+			     size_t *ld_out) {
+	if (i2 < 0) {
+		*ld_out = ld;
+		return q[i1];
+	}
+	strided_block_add(q[i1], ld, q[i2], ld, T, cols, rows, cols, s);
+	*ld_out = cols;
+	return T;
+}
+
+size_t strassen_product_workspace(const struct strassen_plan *plan,
+				  const int idx) {
+	const struct strassen_plan_node *node = &plan->nodes[idx];
+	const size_t hm = node->m / 2, hn = node->n / 2, hk = node->k / 2;
+	return hm * hn + hn * hk + plan->nodes[node->child[0]].workspace;
+}
+
+static void execute_product(const struct strassen_plan *plan, const int idx,
+			    const int p, const double *const A,
+			    const size_t lda, const double *const B,
+			    const size_t ldb, double *Q, double *ws,
+			    const double **packed) {
+	const struct strassen_plan_node *node = &plan->nodes[idx];
+	const size_t hm = node->m / 2, hn = node->n / 2, hk = node->k / 2;
+	const struct strassen_product *prod = &products[p];
+
+	// Workspace layout: sum of A blocks, sum of B blocks, child workspace
+	double *tempA = ws;
+	double *tempB = tempA + hm * hn;
+	double *child_ws = tempB + hn * hk;
+
+	const double *qa[4], *qb[4];
+	quadrants(A, lda, hm, hn, qa);
+	quadrants(B, ldb, hn, hk, qb);
+
+	size_t lda_op, ldb_op;
+	const double *a_op;
+	if (packed != NULL && prod->a2 >= 0) {  // sum prepared in advance
+		a_op = *packed;
+		lda_op = hn;
+		*packed += hm * hn;
+	} else {
+		a_op = operand(qa, lda, prod->a1, prod->a2, prod->sa, tempA,
+			       hm, hn, &lda_op);
+	}
+	const double *b_op = operand(qb, ldb, prod->b1, prod->b2, prod->sb,
+				     tempB, hn, hk, &ldb_op);
+	exec_node(plan, node->child[0], a_op, lda_op, b_op, ldb_op, Q, hk,
+		  child_ws, 0, packed);
+}
+
+void strassen_execute_product(const struct strassen_plan *plan,
+			      const int idx, const int p,
+			      const double *const A, const size_t lda,
+			      const double *const B, const size_t ldb,
+			      double *Q, double *ws) {
+	execute_product(plan, idx, p, A, lda, B, ldb, Q, ws, NULL);
+}
+
+// Peel the odd dimensions after the Strassen step on the even part
+static void peel(const struct strassen_plan_node *node, const double *A,
+		 const size_t lda, const double *B, const size_t ldb,
+		 double *C, const size_t ldc, const int beta) {
+	const size_t m = node->m, n = node->n, k = node->k;
+	const size_t me = m & ~(size_t)1, ne = n & ~(size_t)1,
+		     ke = k & ~(size_t)1;
+
+	PROF_BEGIN(t_peel);
+	if (n != ne) {
+		// Rank-1 update with the last column of A and last row of B
+		leaf_matmat(A + ne, lda, B + ne * ldb, ldb, C, ldc, me, 1, ke,
+			    1);
+	}
+	if (k != ke) {
+		// Last column of C over all rows
+		leaf_gemv(A, lda, B + ke, ldb, C + ke, ldc, m, n, beta);
+	}
+	if (m != me) {
+		// Last row of C without the corner done above
+		leaf_matmat(A + me * lda, lda, B, ldb, C + me * ldc, ldc, 1, n,
+			    ke, beta);
+	}
+	PROF_END(t_peel, PROF_LEAF, (m + n + k) * sizeof(double));
+}
+
+void strassen_execute_assemble(const struct strassen_plan *plan,
+			       const int idx, const double *const *Q,
+			       const double *const A, const size_t lda,
+			       const double *const B, const size_t ldb,
+			       double *C, const size_t ldc, const int beta) {
+	const struct strassen_plan_node *node = &plan->nodes[idx];
+	const size_t hm = node->m / 2, hk = node->k / 2;
+
+	double *r[4] = {C, C + hk, C + hm * ldc, C + hm * ldc + hk};
+	for (int i = 0; i < 4; i++) {
+		// The first contribution overwrites unless beta == 1
+		double b = beta ? 1.0 : 0.0;
+		for (int p = 0; p < STRASSEN_PRODUCTS; p++) {
+			if (products[p].c[i] == 0.0) continue;
+			strided_block_acc(r[i], ldc, Q[p], hk, hm, hk,
+					  products[p].c[i], b);
+			b = 1.0;
+		}
+	}
+
+	peel(node, A, lda, B, ldb, C, ldc, beta);
+}
+
+// One Strassen step on the even part of the problem with a single product
+// buffer: every product is added to C as soon as it is computed
+static void exec_strassen(const struct strassen_plan *plan, const int idx,
+			  const double *A, const size_t lda, const double *B,
+			  const size_t ldb, double *C, const size_t ldc,
+			  double *ws, const int beta, const double **packed) {
+	const struct strassen_plan_node *node = &plan->nodes[idx];
+	const size_t hm = node->m / 2, hk = node->k / 2;
+
+	// Workspace layout: product, then the workspace of one product
+	double *q = ws;
+	double *product_ws = q + hm * hk;
+
+	double *r[4] = {C, C + hk, C + hm * ldc, C + hm * ldc + hk};
+	// The first contribution to a quadrant overwrites it unless beta == 1
+	double b[4];
+	for (int i = 0; i < 4; i++) b[i] = beta ? 1.0 : 0.0;
+
+	for (int p = 0; p < STRASSEN_PRODUCTS; p++) {
+		execute_product(plan, idx, p, A, lda, B, ldb, q, product_ws,
+				packed);
+		for (int i = 0; i < 4; i++) {
+			if (products[p].c[i] == 0.0) continue;
+			strided_block_acc(r[i], ldc, q, hk, hm, hk,
+					  products[p].c[i], b[i]);
+			b[i] = 1.0;
+		}
+	}
+
+	peel(node, A, lda, B, ldb, C, ldc, beta);
+}
+
+static void exec_node(const struct strassen_plan *plan, const int idx,
+		      const double *A, const size_t lda, const double *B,
+		      const size_t ldb, double *C, const size_t ldc, double *ws,
+		      const int beta, const double **packed) {
+	const struct strassen_plan_node *node = &plan->nodes[idx];
+	const size_t m = node->m, n = node->n, k = node->k;
+	PROF_ENTER(t_call);
+
+	switch (node->step) {
+		case STEP_LEAF:
+		case STEP_GEVM:
+		case STEP_OUTER: {
+			PROF_BEGIN(t_leaf);
+			leaf_matmat(A, lda, B, ldb, C, ldc, m, n, k, beta);
+			PROF_END(t_leaf, PROF_LEAF,
+				 (m * n + n * k + m * k) * sizeof(double));
+			break;
+		}
+		case STEP_GEMV: {
+			PROF_BEGIN(t_leaf);
+			leaf_gemv(A, lda, B, ldb, C, ldc, m, n, beta);
+			PROF_END(t_leaf, PROF_LEAF,
+				 (m * n + n + m) * sizeof(double));
+			break;
+		}
+		case STEP_SPLIT_M: {
+			const size_t m1 = m / 2;
+			exec_node(plan, node->child[0], A, lda, B, ldb, C, ldc,
+				  ws, beta, packed);
+			exec_node(plan, node->child[1], A + m1 * lda, lda, B,
+				  ldb, C + m1 * ldc, ldc, ws, beta, packed);
+			break;
+		}
+		case STEP_SPLIT_K: {
+			const size_t k1 = k / 2;
+			// Halves of equal shape share the node and read the
+			// same prepared sums (see prepare_node)
+			const double *rewind = packed ? *packed : NULL;
+			exec_node(plan, node->child[0], A, lda, B, ldb, C, ldc,
+				  ws, beta, packed);
+			if (packed != NULL && node->child[0] == node->child[1])
+				*packed = rewind;
+			exec_node(plan, node->child[1], A, lda, B + k1, ldb,
+				  C + k1, ldc, ws, beta, packed);
+			break;
+		}
+		case STEP_SPLIT_N: {
+			// The second half accumulates onto the first
+			const size_t n1 = n / 2;
+			exec_node(plan, node->child[0], A, lda, B, ldb, C, ldc,
+				  ws, beta, packed);
+			exec_node(plan, node->child[1], A + n1, lda,
+				  B + n1 * ldb, ldb, C, ldc, ws, 1, packed);
+			break;
+		}
+		case STEP_STRASSEN:
+			exec_strassen(plan, idx, A, lda, B, ldb, C, ldc, ws,
+				      beta, packed);
+			break;
+	}
+
+	PROF_LEAVE(t_call, "strassen_execute", m, n, k);
+}
+
+void strassen_execute_ws(const struct strassen_plan *plan,
+			 const double *const A, const double *const B,
+			 double *C, double *workspace) {
+	exec_node(plan, 0, A, plan->n, B, plan->k, C, plan->k, workspace, 0,
+		  NULL);
+}
+
+void strassen_execute(const struct strassen_plan *plan, const double *const A,
+		      const double *const B, double *C) {
+	strassen_execute_ws(plan, A, B, C, plan->workspace);
+}
+
+/* ####################################################### */
+/* Prepared left operands */
+
+// Doubles of A-side sums below node idx, in the order exec_node uses them
+static size_t packed_size(const struct strassen_plan *plan, const int idx) {
+	const struct strassen_plan_node *node = &plan->nodes[idx];
+	switch (node->step) {
+		case STEP_STRASSEN: {
+			const size_t sum = (node->m / 2) * (node->n / 2);
+			const size_t child = packed_size(plan, node->child[0]);
+			size_t size = 0;
+			for (int p = 0; p < STRASSEN_PRODUCTS; p++)
+				size += (products[p].a2 >= 0 ? sum : 0) + child;
+			return size;
+		}
+		case STEP_SPLIT_K:
+			// Both halves meet the same A, a shared node needs
+			// its sums once
+			if (node->child[0] == node->child[1])
+				return packed_size(plan, node->child[0]);
+			return packed_size(plan, node->child[0]) +
+			       packed_size(plan, node->child[1]);
+		case STEP_SPLIT_M:
+		case STEP_SPLIT_N:
+			return packed_size(plan, node->child[0]) +
+			       packed_size(plan, node->child[1]);
+		default:
+			return 0;
+	}
+}
+
+// Write the A-side sums below node idx for the view A at *cursor, in the
+// order exec_node consumes them
+static void prepare_node(const struct strassen_plan *plan, const int idx,
+			 const double *A, const size_t lda, double **cursor) {
+	const struct strassen_plan_node *node = &plan->nodes[idx];
+	switch (node->step) {
+		case STEP_STRASSEN: {
+			const size_t hm = node->m / 2, hn = node->n / 2;
+			const double *qa[4];
+			quadrants(A, lda, hm, hn, qa);
+			for (int p = 0; p < STRASSEN_PRODUCTS; p++) {
+				const struct strassen_product *prod =
+				    &products[p];
+				size_t lda_op = lda;
+				const double *a_op = qa[prod->a1];
+				if (prod->a2 >= 0) {
+					double *T = *cursor;
+					*cursor += hm * hn;
+					a_op = operand(qa, lda, prod->a1,
+						       prod->a2, prod->sa, T,
+						       hm, hn, &lda_op);
+				}
+				prepare_node(plan, node->child[0], a_op,
+					     lda_op, cursor);
+			}
+			break;
+		}
+		case STEP_SPLIT_M:
+			prepare_node(plan, node->child[0], A, lda, cursor);
+			prepare_node(plan, node->child[1],
+				     A + (node->m / 2) * lda, lda, cursor);
+			break;
+		case STEP_SPLIT_K:
+			// Both halves of B meet the whole of A. If the halves
+			// have the same shape they share the node and the
+			// execution reads the same sums twice.
+			prepare_node(plan, node->child[0], A, lda, cursor);
+			if (node->child[0] != node->child[1])
+				prepare_node(plan, node->child[1], A, lda,
+					     cursor);
+			break;
+		case STEP_SPLIT_N:
+			prepare_node(plan, node->child[0], A, lda, cursor);
+			prepare_node(plan, node->child[1], A + node->n / 2,
+				     lda, cursor);
+			break;
+		default:
+			break;
+	}
+}
+
+struct strassen_prepared *strassen_prepare_a(
+    const struct strassen_plan *plan, const double *const A) {
+	struct strassen_prepared *prep =
+	    calloc(1, sizeof(struct strassen_prepared));
+	if (prep == NULL) return NULL;
+	prep->plan = plan;
+	prep->packed_size = packed_size(plan, 0);
+	prep->A = malloc(max_size(plan->m * plan->n, 1) * sizeof(double));
+	prep->packed = malloc(max_size(prep->packed_size, 1) * sizeof(double));
+	if (prep->A == NULL || prep->packed == NULL) {
+		strassen_prepared_destroy(prep);
+		return NULL;
+	}
+
+	memcpy(prep->A, A, plan->m * plan->n * sizeof(double));
+	double *cursor = prep->packed;
+	prepare_node(plan, 0, prep->A, plan->n, &cursor);
+	return prep;
+}
+
+void strassen_prepared_destroy(struct strassen_prepared *prep) {
+	if (prep == NULL) return;
+	free(prep->A);
+	free(prep->packed);
+	free(prep);
+}
+
+void strassen_execute_prepared_ws(const struct strassen_prepared *prep,
+				  const double *const B, double *C,
+				  double *workspace) {
+	const struct strassen_plan *plan = prep->plan;
+	const double *cursor = prep->packed;
+	exec_node(plan, 0, prep->A, plan->n, B, plan->k, C, plan->k,
+		  workspace, 0, &cursor);
+}
+
+void strassen_execute_prepared(const struct strassen_prepared *prep,
+			       const double *const B, double *C) {
+	strassen_execute_prepared_ws(prep, B, C, prep->plan->workspace);
+}
+
+/* ####################################################### */
+/* Accuracy-targeted plans */
+
+double strassen_error_bound(const size_t n, const int levels) {
+	// Higham's bound with leaves of size n/2^L multiplied classically,
+	// 12^L ((n/2^L)^2 + 5 n/2^L) - 5n
+	const double dn = (double)n;
+	const double growth =
+	    pow(3.0, levels) * dn * dn + 5.0 * dn * (pow(6.0, levels) - 1.0);
+	return growth * (DBL_EPSILON / 2);
+}
+
+// Largest absolute entry of A (size mxn)
+static double max_norm(const double *const A, const size_t m, const size_t n) {
+	double norm = 0.0;
+	for (size_t i = 0; i < m * n; i++) norm = fmax(norm, fabs(A[i]));
+	return norm;
+}
+
+// Lower bound of the largest entry of C = A*B from one product with a
+// random sign vector x: |(C*x)_i| <= k * max|C|. Costs two matrix-vector
+// products, the signs come from a local generator so no state is shared.
+static double product_norm_estimate(const double *const A,
+				    const double *const B, const size_t m,
+				    const size_t n, const size_t k) {
+	double *x = malloc(k * sizeof(double));
+	double *y = malloc(n * sizeof(double));
+	if (x == NULL || y == NULL) {
+		free(x);
+		free(y);
+		return 0.0;
+	}
+	uint64_t state = 0x9e3779b97f4a7c15ULL;
+	for (size_t j = 0; j < k; j++) {
+		state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+		x[j] = state >> 63 ? 1.0 : -1.0;
+	}
+	for (size_t l = 0; l < n; l++) {  // y = B*x
+		double sum = 0.0;
+		for (size_t j = 0; j < k; j++) sum += B[l * k + j] * x[j];
+		y[l] = sum;
+	}
+	double norm = 0.0;
+	for (size_t i = 0; i < m; i++) {  // A*y
+		double sum = 0.0;
+		for (size_t l = 0; l < n; l++) sum += A[i * n + l] * y[l];
+		norm = fmax(norm, fabs(sum));
+	}
+	free(x);
+	free(y);
+	return norm / (double)k;
+}
+
+int strassen_accuracy_levels(const double *const A, const double *const B,
+			     const size_t m, const size_t n, const size_t k,
+			     const double tolerance, const int max_levels) {
+	const double scale = max_norm(A, m, n) * max_norm(B, n, k);
+	const double target =
+	    tolerance * product_norm_estimate(A, B, m, n, k);
+	if (!(scale > 0.0)) return max_levels;	// C = 0 is exact at any depth
+
+	int levels = 0;
+	while (levels < max_levels &&
+	       strassen_error_bound(n, levels + 1) * scale <= target)
+		levels++;
+	return levels;
+}
+
+int strassen_matmat_tol(const double *const A, const double *const B,
+			double *C, const size_t m, const size_t n,
+			const size_t k, const double tolerance) {
+	struct strassen_plan *plan = strassen_plan(m, n, k, NULL);
+	if (plan == NULL) return -1;
+	const int depth = strassen_depth(plan, 0);
+	const int levels =
+	    strassen_accuracy_levels(A, B, m, n, k, tolerance, depth);
+	if (levels < depth) {
+		// Replan with the reduced budget, deeper products split
+		// classically
+		strassen_plan_destroy(plan);
+		const struct strassen_plan_options options = {
+		    .max_levels = levels > 0 ? levels : -1};
+		plan = strassen_plan(m, n, k, &options);
+		if (plan == NULL) return -1;
+	}
+	strassen_execute(plan, A, B, C);
+	strassen_plan_destroy(plan);
+	return levels;
+}
+
+int strassen_plan_save(const struct strassen_plan *plan, FILE *file) {
+	int err = 0;
+	err |= fprintf(file, "strassen_plan %d\n", PLAN_FORMAT_VERSION) < 0;
+	err |= fprintf(file, "%zu %zu %zu %zu %d\n", plan->m, plan->n,
+		       plan->k, plan->options.leaf_size,
+		       plan->options.max_levels) < 0;
+	err |= fprintf(file, "%zu %zu\n", plan->num_nodes,
+		       plan->workspace_size) < 0;
+	for (size_t i = 0; i < plan->num_nodes; i++) {
+		const struct strassen_plan_node *node = &plan->nodes[i];
+		err |= fprintf(file, "%d %zu %zu %zu %d %d %zu\n",
+			       (int)node->step, node->m, node->n, node->k,
+			       node->child[0], node->child[1],
+			       node->workspace) < 0;
+	}
+	return err ? -1 : 0;
+}
+
+// Check that child `c` of a node exists and has the expected shape
+static int check_child(const struct strassen_plan *plan, const int c,
+		       const size_t m, const size_t n, const size_t k) {
+	if (c < 0 || (size_t)c >= plan->num_nodes) return 0;
+	const struct strassen_plan_node *child = &plan->nodes[c];
+	return child->m == m && child->n == n && child->k == k && m > 0 &&
+	       n > 0 && k > 0;
+}
+
+// Structural consistency of a loaded plan, so that executing it cannot
+// access memory outside the operands or the workspace
+static int check_plan(const struct strassen_plan *plan) {
+	if (plan->num_nodes == 0) return 0;
+	const struct strassen_plan_node *root = &plan->nodes[0];
+	if (root->m != plan->m || root->n != plan->n || root->k != plan->k ||
+	    root->workspace > plan->workspace_size)
+		return 0;
+
+	for (size_t i = 0; i < plan->num_nodes; i++) {
+		const struct strassen_plan_node *node = &plan->nodes[i];
+		const size_t m = node->m, n = node->n, k = node->k;
+		const int c0 = node->child[0], c1 = node->child[1];
+		int ok = 0;
+		switch (node->step) {
+			case STEP_LEAF:
+				ok = c0 == -1 && c1 == -1;
+				break;
+			case STEP_GEMV:
+				ok = k == 1 && c0 == -1 && c1 == -1;
+				break;
+			case STEP_GEVM:
+				ok = m == 1 && c0 == -1 && c1 == -1;
+				break;
+			case STEP_OUTER:
+				ok = n == 1 && c0 == -1 && c1 == -1;
+				break;
+			case STEP_SPLIT_M:
+				ok = check_child(plan, c0, m / 2, n, k) &&
+				     check_child(plan, c1, m - m / 2, n, k);
+				break;
+			case STEP_SPLIT_N:
+				ok = check_child(plan, c0, m, n / 2, k) &&
+				     check_child(plan, c1, m, n - n / 2, k);
+				break;
+			case STEP_SPLIT_K:
+				ok = check_child(plan, c0, m, n, k / 2) &&
+				     check_child(plan, c1, m, n, k - k / 2);
+				break;
+			case STEP_STRASSEN:
+				ok = check_child(plan, c0, m / 2, n / 2,
+						 k / 2) &&
+				     c1 == -1 &&
+				     node->workspace >=
+					 strassen_step_workspace(m, n, k) +
+					     plan->nodes[c0].workspace;
+				break;
+		}
+		if (ok && c1 >= 0)
+			ok = node->workspace >= plan->nodes[c0].workspace &&
+			     node->workspace >= plan->nodes[c1].workspace;
+		if (!ok) return 0;
+	}
+	return 1;
+}
+
+struct strassen_plan *strassen_plan_load(FILE *file) {
+	int version;
+	if (fscanf(file, "strassen_plan %d", &version) != 1 ||
+	    version != PLAN_FORMAT_VERSION)
+		return NULL;
+
+	struct strassen_plan *plan = calloc(1, sizeof(struct strassen_plan));
+	if (plan == NULL) return NULL;
+
+	int ok = fscanf(file, "%zu %zu %zu %zu %d", &plan->m, &plan->n,
+			&plan->k, &plan->options.leaf_size,
+			&plan->options.max_levels) == 5 &&
+		 fscanf(file, "%zu %zu", &plan->num_nodes,
+			&plan->workspace_size) == 2 &&
+		 plan->num_nodes > 0;
+	if (ok) {
+		plan->nodes =
+		    calloc(plan->num_nodes, sizeof(struct strassen_plan_node));
+		ok = plan->nodes != NULL;
+	}
+	for (size_t i = 0; ok && i < plan->num_nodes; i++) {
+		struct strassen_plan_node *node = &plan->nodes[i];
+		int step;
+		ok = fscanf(file, "%d %zu %zu %zu %d %d %zu", &step, &node->m,
+			    &node->n, &node->k, &node->child[0],
+			    &node->child[1], &node->workspace) == 7 &&
+		     step >= STEP_LEAF && step <= STEP_STRASSEN;
+		node->step = (enum strassen_step)step;
+	}
+	if (ok) ok = check_plan(plan);
+	if (ok) {
+		plan->workspace = malloc(max_size(plan->workspace_size, 1) *
+					 sizeof(double));
+		ok = plan->workspace != NULL;
+	}
+
+	if (!ok) {
+		strassen_plan_destroy(plan);
+		return NULL;
+	}
+	return plan;
+}
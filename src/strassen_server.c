@@ -0,0 +1,588 @@
+/*
+ * DESC: Long-running matrix service on a Unix domain socket.
+ * AUTHORS: Thomas Gantz, Laura Paxton, Jan Marxen
+ *
+ * Usage: ./strassen_server [--socket=<path>] [--threads=<count>]
+ *
+ * The worker pool, the plans of recently seen shapes and their workspace stay
+ * alive between requests. Operands live in shared memory segments attached
+ * by the clients (see service.h). Small multiplications that arrive together
+ * are submitted to the executor as one batch job, everything else as a job
+ * of its own; the executor keeps the plans of recent shapes. Latency
+ * percentiles and throughput are reported to clients on request and printed
+ * on shutdown (SIGINT/SIGTERM).
+ */
+#define _GNU_SOURCE  // accept4, pipe2
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../include/executor.h"
+#include "../include/service.h"
+
+// Maximal number of connected clients
+#define MAX_CLIENTS 64
+// Multiplications with at most this many multiply-adds are batched
+#define BATCH_WORK ((uint64_t)128 * 128 * 128)
+// Maximal number of requests in one batch
+#define BATCH_MAX 256
+// Number of most recent latencies the percentiles are taken over
+#define LATENCY_SAMPLES 65536
+
+// Shared memory segment of a client, referenced by the client and its jobs
+struct segment {
+	char *base;
+	size_t size;
+	int refs;
+};
+
+struct client {
+	int fd;	 // -1 once the connection is closed
+	struct segment *segment;
+	int inflight;  // requests not yet answered, the slot is kept until 0
+};
+
+// Request running on the executor
+struct job {
+	struct client *client;
+	struct segment *segment;
+	uint32_t id;
+	double start;
+	int status;
+	struct strassen_future *future;
+	struct job *next;
+};
+
+// Request of a batch
+struct pending {
+	struct client *client;
+	struct segment *segment;
+	uint32_t id;
+	double start;
+};
+
+// Small multiplications of one poll round, run as one executor job
+struct batch {
+	struct pending pending[BATCH_MAX];
+	struct strassen_batch_item items[BATCH_MAX];
+	size_t len;
+	struct strassen_future *future;
+	struct batch *next;
+};
+
+// Arrival and latency of the most recent answers
+struct stats {
+	double starts[LATENCY_SAMPLES];
+	double samples[LATENCY_SAMPLES];
+	uint64_t count;
+};
+
+static struct {
+	struct strassen_executor *executor;
+	struct client clients[MAX_CLIENTS];
+	struct batch *batch;  // batch of this poll round, NULL if empty
+	struct stats stats;
+
+	// Jobs and batches finished by the workers, handed back through the
+	// wake pipe
+	pthread_mutex_t done_lock;
+	struct job *done;
+	struct batch *done_batches;
+	int wake[2];
+} server = {.done_lock = PTHREAD_MUTEX_INITIALIZER};
+
+static volatile sig_atomic_t stop;
+
+static void on_signal(int sig) {
+	(void)sig;
+	stop = 1;
+}
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + 1e-9 * (double)ts.tv_nsec;
+}
+
+static void segment_release(struct segment *segment) {
+	if (segment == NULL || --segment->refs > 0) return;
+	munmap(segment->base, segment->size);
+	free(segment);
+}
+
+// Matrix (rows x cols) at byte offset off, NULL if it is not inside segment
+static double *operand(const struct segment *segment, const uint64_t off,
+		       const uint64_t rows, const uint64_t cols) {
+	if (segment == NULL || off % sizeof(double) != 0) return NULL;
+	const uint64_t elements = segment->size / sizeof(double);
+	if (rows == 0 || cols == 0 || cols > elements / rows) return NULL;
+	const uint64_t bytes = rows * cols * sizeof(double);
+	if (off > segment->size || bytes > segment->size - off) return NULL;
+	return (double *)(segment->base + off);
+}
+
+// Whether the byte ranges of two operands in a segment share any byte
+static int overlaps(const uint64_t a, const uint64_t a_bytes, const uint64_t b,
+		    const uint64_t b_bytes) {
+	return a < b + b_bytes && b < a + a_bytes;
+}
+
+// m*n*k <= BATCH_WORK without overflowing, all sizes are at least 1
+static int is_small(const uint64_t m, const uint64_t n, const uint64_t k) {
+	return n <= BATCH_WORK && k <= BATCH_WORK / n &&
+	       m <= BATCH_WORK / (n * k);
+}
+
+static void record_latency(const double start) {
+	struct stats *s = &server.stats;
+	s->starts[s->count % LATENCY_SAMPLES] = start;
+	s->samples[s->count % LATENCY_SAMPLES] = now() - start;
+	s->count++;
+}
+
+static int compare_double(const void *a, const void *b) {
+	const double x = *(const double *)a, y = *(const double *)b;
+	return (x > y) - (x < y);
+}
+
+// Time in which at least one of the recent requests was in flight: the
+// union of their intervals from arrival to answer. Idle gaps between
+// bursts do not count.
+static double busy_time(const struct stats *s, const size_t len,
+			double *scratch) {
+	// Intervals sorted by arrival, each as (start, end) pair
+	for (size_t i = 0; i < len; i++) {
+		scratch[2 * i] = s->starts[i];
+		scratch[2 * i + 1] = s->starts[i] + s->samples[i];
+	}
+	qsort(scratch, len, 2 * sizeof(double), compare_double);
+
+	double busy = 0.0, begin = scratch[0], end = scratch[1];
+	for (size_t i = 1; i < len; i++) {
+		if (scratch[2 * i] > end) {
+			busy += end - begin;
+			begin = scratch[2 * i];
+		}
+		if (scratch[2 * i + 1] > end) end = scratch[2 * i + 1];
+	}
+	return busy + (end - begin);
+}
+
+static void fill_stats(struct service_response *resp) {
+	const struct stats *s = &server.stats;
+	const size_t len =
+	    s->count < LATENCY_SAMPLES ? s->count : LATENCY_SAMPLES;
+	resp->count = s->count;
+	if (len == 0) return;
+
+	double *sorted = malloc(2 * len * sizeof(double));
+	if (sorted == NULL) return;
+	memcpy(sorted, s->samples, len * sizeof(double));
+	qsort(sorted, len, sizeof(double), compare_double);
+	resp->p50 = sorted[(len - 1) / 2];
+	resp->p99 = sorted[(len - 1) * 99 / 100];
+	const double busy = busy_time(s, len, sorted);
+	resp->throughput = busy > 0 ? (double)len / busy : 0.0;
+	free(sorted);
+}
+
+static void respond(struct client *client, const uint32_t id,
+		    const int status) {
+	if (client->fd < 0) return;
+	const struct service_response resp = {.id = id, .status = status};
+	send(client->fd, &resp, sizeof(resp), MSG_NOSIGNAL);
+}
+
+// Answer a request that went through the batch or the executor
+static void finish(struct client *client, const uint32_t id,
+		   const int status, const double start) {
+	record_latency(start);
+	respond(client, id, status);
+	client->inflight--;
+}
+
+static void close_client(struct client *client) {
+	close(client->fd);
+	client->fd = -1;
+	segment_release(client->segment);
+	client->segment = NULL;
+}
+
+static void wake_loop(void) {
+	const char byte = 0;
+	while (write(server.wake[1], &byte, 1) < 0 && errno == EINTR) {
+	}
+}
+
+// Runs on a worker thread, the loop picks the job up through the pipe
+static void job_done(struct strassen_future *future, const int status,
+		     void *arg) {
+	(void)future;
+	struct job *job = arg;
+	job->status = status;
+	pthread_mutex_lock(&server.done_lock);
+	job->next = server.done;
+	server.done = job;
+	pthread_mutex_unlock(&server.done_lock);
+	wake_loop();
+}
+
+// Same for a batch, its items carry their own status
+static void batch_done(struct strassen_future *future, const int status,
+		       void *arg) {
+	(void)future;
+	(void)status;
+	struct batch *batch = arg;
+	pthread_mutex_lock(&server.done_lock);
+	batch->next = server.done_batches;
+	server.done_batches = batch;
+	pthread_mutex_unlock(&server.done_lock);
+	wake_loop();
+}
+
+// Answer every request of the batch and drop it
+static void finish_batch(struct batch *batch) {
+	for (size_t i = 0; i < batch->len; i++) {
+		struct pending *p = &batch->pending[i];
+		finish(p->client, p->id, batch->items[i].status, p->start);
+		segment_release(p->segment);
+	}
+	strassen_future_release(batch->future);
+	free(batch);
+}
+
+static void collect_done(void) {
+	char drain[64];
+	while (read(server.wake[0], drain, sizeof(drain)) > 0) {
+	}
+	pthread_mutex_lock(&server.done_lock);
+	struct job *job = server.done;
+	struct batch *batch = server.done_batches;
+	server.done = NULL;
+	server.done_batches = NULL;
+	pthread_mutex_unlock(&server.done_lock);
+
+	while (job != NULL) {
+		struct job *next = job->next;
+		finish(job->client, job->id, job->status, job->start);
+		strassen_future_release(job->future);
+		segment_release(job->segment);
+		free(job);
+		job = next;
+	}
+	while (batch != NULL) {
+		struct batch *next = batch->next;
+		finish_batch(batch);
+		batch = next;
+	}
+}
+
+// Hand the small multiplications gathered so far to the executor
+static void submit_batch(void) {
+	struct batch *batch = server.batch;
+	if (batch == NULL) return;
+	server.batch = NULL;
+	batch->future = strassen_submit_batch(server.executor, batch->items,
+					      batch->len, batch_done, batch);
+	if (batch->future != NULL) return;
+	for (size_t i = 0; i < batch->len; i++) batch->items[i].status = -1;
+	finish_batch(batch);
+}
+
+// Add a small multiplication to the batch of this poll round
+static int add_to_batch(struct client *client,
+			const struct service_request *req, const double *A,
+			const double *B, double *C, const double start) {
+	if (server.batch == NULL) {
+		server.batch = malloc(sizeof(struct batch));
+		if (server.batch == NULL) return -1;
+		server.batch->len = 0;
+	}
+	struct batch *batch = server.batch;
+	batch->pending[batch->len] =
+	    (struct pending){client, client->segment, req->id, start};
+	batch->items[batch->len] = (struct strassen_batch_item){
+	    .A = A, .B = B, .C = C, .m = req->m, .n = req->n, .k = req->k};
+	client->segment->refs++;
+	if (++batch->len == BATCH_MAX) submit_batch();
+	return 0;
+}
+
+static void submit(struct client *client, const struct service_request *req,
+		   const double start) {
+	struct segment *seg = client->segment;
+	const uint64_t m = req->m, n = req->n, k = req->k;
+	const double *A = NULL, *B = NULL;
+	double *C = NULL;
+	switch (req->op) {
+		case SERVICE_MATMAT:
+			A = operand(seg, req->a, m, n);
+			B = operand(seg, req->b, n, k);
+			C = operand(seg, req->c, m, k);
+			break;
+		case SERVICE_INVERT:
+			A = operand(seg, req->a, n, n);
+			B = A;
+			C = operand(seg, req->c, n, n);
+			break;
+		case SERVICE_SOLVE:
+			A = operand(seg, req->a, n, n);
+			B = operand(seg, req->b, n, k);
+			C = operand(seg, req->c, n, k);
+			break;
+	}
+	if (A == NULL || B == NULL || C == NULL) {
+		respond(client, req->id, -1);
+		return;
+	}
+
+	// The output is written while the inputs are read, so it must not
+	// share memory with them. Operands lie inside the segment, the ends
+	// of their ranges cannot overflow.
+	const uint64_t rows_a = req->op == SERVICE_MATMAT ? m : n;
+	const uint64_t cols_b = req->op == SERVICE_INVERT ? n : k;
+	const uint64_t a_bytes = rows_a * n * sizeof(double);
+	const uint64_t b_bytes = n * cols_b * sizeof(double);
+	const uint64_t c_bytes = rows_a * cols_b * sizeof(double);
+	if (overlaps(req->c, c_bytes, req->a, a_bytes) ||
+	    (req->op != SERVICE_INVERT &&
+	     overlaps(req->c, c_bytes, req->b, b_bytes))) {
+		respond(client, req->id, -1);
+		return;
+	}
+
+	client->inflight++;
+	if (req->op == SERVICE_MATMAT && is_small(m, n, k) &&
+	    add_to_batch(client, req, A, B, C, start) == 0)
+		return;
+
+	struct job *job = malloc(sizeof(struct job));
+	if (job == NULL) {
+		finish(client, req->id, -1, start);
+		return;
+	}
+	*job = (struct job){.client = client,
+			    .segment = seg,
+			    .id = req->id,
+			    .start = start};
+	seg->refs++;
+	if (req->op == SERVICE_MATMAT)
+		job->future = strassen_submit_matmat(server.executor, A, B, C,
+						     m, n, k, job_done, job);
+	else if (req->op == SERVICE_INVERT)
+		job->future = strassen_submit_invert(server.executor, A, C, n,
+						     job_done, job);
+	else
+		job->future = strassen_submit_solve(server.executor, A, B, C,
+						    n, k, job_done, job);
+	if (job->future == NULL) {
+		segment_release(seg);
+		free(job);
+		finish(client, req->id, -1, start);
+	}
+}
+
+static void attach(struct client *client, const struct service_request *req,
+		   const int fd) {
+	struct segment *seg = NULL;
+	if (fd >= 0 && req->m > 0) seg = malloc(sizeof(struct segment));
+	if (seg != NULL) {
+		seg->base = mmap(NULL, req->m, PROT_READ | PROT_WRITE,
+				 MAP_SHARED, fd, 0);
+		seg->size = req->m;
+		seg->refs = 1;
+		if (seg->base == MAP_FAILED) {
+			free(seg);
+			seg = NULL;
+		}
+	}
+	if (fd >= 0) close(fd);
+	if (seg != NULL) {
+		segment_release(client->segment);
+		client->segment = seg;
+	}
+	respond(client, req->id, seg != NULL ? 0 : -1);
+}
+
+// Receive every request that is already queued on the connection
+static void serve_client(struct client *client) {
+	for (;;) {
+		struct service_request req;
+		union {
+			char buf[CMSG_SPACE(sizeof(int))];
+			struct cmsghdr align;
+		} control;
+		struct iovec iov = {.iov_base = &req, .iov_len = sizeof(req)};
+		struct msghdr msg = {.msg_iov = &iov,
+				     .msg_iovlen = 1,
+				     .msg_control = control.buf,
+				     .msg_controllen = sizeof(control.buf)};
+		const ssize_t len = recvmsg(client->fd, &msg, MSG_DONTWAIT);
+		if (len < 0 && (errno == EAGAIN || errno == EINTR)) return;
+		if (len <= 0) {
+			close_client(client);
+			return;
+		}
+		const double start = now();
+
+		int fd = -1;
+		struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+		if (cmsg != NULL && cmsg->cmsg_level == SOL_SOCKET &&
+		    cmsg->cmsg_type == SCM_RIGHTS)
+			memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+
+		if ((size_t)len != sizeof(req)) {
+			if (fd >= 0) close(fd);
+			respond(client, 0, -1);
+			continue;
+		}
+		if (req.op == SERVICE_ATTACH) {
+			attach(client, &req, fd);
+			continue;
+		}
+		if (fd >= 0) close(fd);
+		if (req.op == SERVICE_STATS) {
+			struct service_response resp = {.id = req.id};
+			fill_stats(&resp);
+			send(client->fd, &resp, sizeof(resp), MSG_NOSIGNAL);
+		} else if (req.op == SERVICE_MATMAT ||
+			   req.op == SERVICE_INVERT ||
+			   req.op == SERVICE_SOLVE) {
+			submit(client, &req, start);
+		} else {
+			respond(client, req.id, -1);
+		}
+	}
+}
+
+static int listen_on(const char *path) {
+	struct sockaddr_un addr = {.sun_family = AF_UNIX};
+	if (strlen(path) >= sizeof(addr.sun_path)) return -1;
+	strcpy(addr.sun_path, path);
+
+	const int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+	if (fd < 0) return -1;
+	unlink(path);
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+	    listen(fd, MAX_CLIENTS) != 0) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+static void accept_client(const int listen_fd) {
+	const int fd = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+	if (fd < 0) return;
+	for (int i = 0; i < MAX_CLIENTS; i++) {
+		struct client *client = &server.clients[i];
+		if (client->fd < 0 && client->inflight == 0) {
+			*client = (struct client){.fd = fd};
+			return;
+		}
+	}
+	close(fd);  // No free slot
+}
+
+static void print_stats(void) {
+	struct service_response resp = {0};
+	fill_stats(&resp);
+	printf("# requests: %llu, p50: %.3f ms, p99: %.3f ms, "
+	       "throughput: %.1f req/s\n",
+	       (unsigned long long)resp.count, resp.p50 * 1e3,
+	       resp.p99 * 1e3, resp.throughput);
+}
+
+int main(int argc, char *argv[]) {
+	const char *path = SERVICE_SOCKET_PATH;
+	size_t threads = 0;
+	for (int arg = 1; arg < argc; arg++) {
+		if (strncmp(argv[arg], "--socket=", 9) == 0) {
+			path = argv[arg] + 9;
+		} else if (strncmp(argv[arg], "--threads=", 10) == 0) {
+			threads = strtoul(argv[arg] + 10, NULL, 10);
+		} else {
+			fprintf(stderr,
+				"Usage: %s [--socket=<path>] "
+				"[--threads=<count>]\n",
+				argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	// Without SA_RESTART, a signal interrupts poll and ends the loop. The
+	// workers start with both signals blocked so the loop receives them.
+	struct sigaction sa = {.sa_handler = on_signal};
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+	signal(SIGPIPE, SIG_IGN);
+	sigset_t signals;
+	sigemptyset(&signals);
+	sigaddset(&signals, SIGINT);
+	sigaddset(&signals, SIGTERM);
+	pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+	for (int i = 0; i < MAX_CLIENTS; i++) server.clients[i].fd = -1;
+	const int listen_fd = listen_on(path);
+	if (listen_fd < 0 || pipe2(server.wake, O_NONBLOCK | O_CLOEXEC) != 0) {
+		fprintf(stderr, "Could not listen on %s\n", path);
+		return EXIT_FAILURE;
+	}
+	server.executor = strassen_executor_create(threads);
+	if (server.executor == NULL) {
+		fprintf(stderr, "Could not start the worker pool\n");
+		return EXIT_FAILURE;
+	}
+	pthread_sigmask(SIG_UNBLOCK, &signals, NULL);
+	printf("# listening on %s\n", path);
+	fflush(stdout);
+
+	struct pollfd fds[MAX_CLIENTS + 2];
+	struct client *polled[MAX_CLIENTS];
+	while (!stop) {
+		fds[0] = (struct pollfd){.fd = listen_fd, .events = POLLIN};
+		fds[1] =
+		    (struct pollfd){.fd = server.wake[0], .events = POLLIN};
+		nfds_t nfds = 2;
+		for (int i = 0; i < MAX_CLIENTS; i++) {
+			if (server.clients[i].fd < 0) continue;
+			polled[nfds - 2] = &server.clients[i];
+			fds[nfds++] = (struct pollfd){
+			    .fd = server.clients[i].fd, .events = POLLIN};
+		}
+
+		if (poll(fds, nfds, -1) < 0) {
+			if (errno == EINTR) continue;
+			break;
+		}
+		if (fds[1].revents) collect_done();
+		for (nfds_t i = 2; i < nfds; i++)
+			if (fds[i].revents) serve_client(polled[i - 2]);
+		// Small multiplications of this round go out as one job
+		submit_batch();
+		if (fds[0].revents) accept_client(listen_fd);
+	}
+
+	// Let the running jobs finish before reporting
+	strassen_executor_destroy(server.executor);
+	collect_done();
+	print_stats();
+
+	for (int i = 0; i < MAX_CLIENTS; i++)
+		if (server.clients[i].fd >= 0) close_client(&server.clients[i]);
+	close(listen_fd);
+	unlink(path);
+	return EXIT_SUCCESS;
+}
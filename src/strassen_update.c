@@ -0,0 +1,100 @@
+/*
+ * DESC: Module for low-rank updates of an inverse.
+ * AUTHORS: Thomas Gantz, Laura Paxton, Jan Marxen
+ */
+#include "../include/strassen_update.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/naive_lu.h"
+#include "../include/strassen_matmat.h"
+
+int strassen_update_inverse(double *inverse_A, const double *const U,
+			    const double *const V, const size_t n,
+			    const size_t k) {
+	if (n == 0 || k == 0) return 0;
+
+	double *X = malloc(n * k * sizeof(double));	 // A^-1 * U
+	double *Y = malloc(k * n * sizeof(double));	 // V * A^-1
+	double *S = malloc(k * k * sizeof(double));	 // I + V * A^-1 * U
+	double *Z = malloc(k * n * sizeof(double));	 // S^-1 * Y
+	double *T = malloc(n * n * sizeof(double));	 // X * Z
+	int status = X && Y && S && Z && T ? 0 : -1;
+
+	if (status == 0) status = strassen_matmat_r(inverse_A, U, X, n, n, k);
+	if (status == 0) status = strassen_matmat_r(V, inverse_A, Y, k, n, n);
+	if (status == 0) status = strassen_matmat_r(V, X, S, k, n, k);
+	if (status == 0) {
+		for (size_t i = 0; i < k; i++) S[i * k + i] += 1.0;
+		status = gauss_jordan_invert(S, k);
+	}
+	if (status == 0) status = strassen_matmat_r(S, Y, Z, k, k, n);
+	if (status == 0) status = strassen_matmat_r(X, Z, T, n, k, n);
+	if (status == 0)
+		for (size_t i = 0; i < n * n; i++) inverse_A[i] -= T[i];
+
+	free(X);
+	free(Y);
+	free(S);
+	free(Z);
+	free(T);
+	return status;
+}
+
+int strassen_border_inverse(const double *const inverse_A,
+			    const double *const B, const double *const C,
+			    const double *const D, double *inverse_out,
+			    const size_t n, const size_t k) {
+	const size_t ld = n + k;  // row stride of the output
+	if (k == 0) {
+		memcpy(inverse_out, inverse_A, n * n * sizeof(double));
+		return 0;
+	}
+	if (n == 0) {  // nothing to border, invert D
+		memcpy(inverse_out, D, k * k * sizeof(double));
+		return gauss_jordan_invert(inverse_out, k);
+	}
+
+	double *X = malloc(n * k * sizeof(double));	 // A^-1 * B
+	double *Y = malloc(k * n * sizeof(double));	 // C * A^-1
+	double *S = malloc(k * k * sizeof(double));	 // D - C * A^-1 * B
+	double *Z = malloc(k * n * sizeof(double));	 // S^-1 * Y
+	double *W = malloc(n * k * sizeof(double));	 // X * S^-1
+	double *T = malloc(n * n * sizeof(double));	 // X * Z
+	int status = X && Y && S && Z && W && T ? 0 : -1;
+
+	if (status == 0) status = strassen_matmat_r(inverse_A, B, X, n, n, k);
+	if (status == 0) status = strassen_matmat_r(C, inverse_A, Y, k, n, n);
+	if (status == 0) status = strassen_matmat_r(C, X, S, k, n, k);
+	if (status == 0) {
+		for (size_t i = 0; i < k * k; i++) S[i] = D[i] - S[i];
+		status = gauss_jordan_invert(S, k);
+	}
+	if (status == 0) status = strassen_matmat_r(S, Y, Z, k, k, n);
+	if (status == 0) status = strassen_matmat_r(X, S, W, n, k, k);
+	if (status == 0) status = strassen_matmat_r(X, Z, T, n, k, n);
+
+	if (status == 0) {
+		for (size_t i = 0; i < n; i++) {
+			for (size_t j = 0; j < n; j++)
+				inverse_out[i * ld + j] =
+				    inverse_A[i * n + j] + T[i * n + j];
+			for (size_t j = 0; j < k; j++)
+				inverse_out[i * ld + n + j] = -W[i * k + j];
+		}
+		for (size_t i = 0; i < k; i++) {
+			double *row = inverse_out + (n + i) * ld;
+			for (size_t j = 0; j < n; j++) row[j] = -Z[i * n + j];
+			memcpy(row + n, S + i * k, k * sizeof(double));
+		}
+	}
+
+	free(X);
+	free(Y);
+	free(S);
+	free(Z);
+	free(W);
+	free(T);
+	return status;
+}
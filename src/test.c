@@ -5,19 +5,37 @@
 #include <cblas.h>
 #include <lapacke.h>
 #include <math.h>
+#include <pthread.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <time.h>
 #include <unistd.h>
 
 #include "../include/IO.h"
+#include "../include/block_utilities.h"
+#include "../include/executor.h"
+#include "../include/inverse_cache.h"
+#include "../include/matrix_gen.h"
 #include "../include/naive_lu.h"
 #include "../include/naive_matmat.h"
+#include "../include/perf_counters.h"
+#include "../include/strassen_chain.h"
+#include "../include/strassen_chol.h"
+#include "../include/strassen_complex.h"
+#include "../include/strassen_exact.h"
 #include "../include/strassen_inv.h"
 #include "../include/strassen_matmat.h"
+#include "../include/strassen_plan.h"
+#include "../include/strassen_update.h"
+#include "../include/verify.h"
+
+static enum verify_mode verify_mode = VERIFY_REFERENCE;
+
+void set_verify_mode(const enum verify_mode mode) { verify_mode = mode; }
 
 void flush_cache() {
 	const size_t cache_size = 32 * 1024 * 1024;  // 32 MB (adjust if needed)
@@ -32,22 +50,32 @@ void flush_cache() {
 	}
 }
 
-static double randfrom() {
-	double a =
-	    (double)rand() / RAND_MAX;	// Generate a random double in [0, 1]
-	int p_o_m =
-	    a < 0.5 ? 1
-		    : 0;  // Decide if the number will be positive or negative
-	return p_o_m * (-1) +
-	       (double)rand() /
-		   RAND_MAX;  // Return a random double with the chosen sign
+// Seed of the run, every generated matrix takes the next stream after it
+static uint64_t test_seed, test_stream, verify_stream;
+
+void set_test_seed(const uint64_t seed) {
+	test_seed = seed;
+	test_stream = 0;
+	verify_stream = 0;
 }
 
+static uint64_t next_seed(void) { return test_seed + test_stream++; }
+
+// Random vectors of the Freivalds checks count down from ~seed, so checking
+// does not shift the streams of the test matrices
+static uint64_t next_verify_seed(void) { return ~test_seed - verify_stream++; }
+
 void gen_rand_matrix(double *A, const size_t m, const size_t n) {
-	for (size_t i = 0; i < m * n;
-	     i++) {  // Fill the matrix with random values
-		A[i] = randfrom();
-	}
+	gen_uniform(A, m * n, next_seed(), 0);
+}
+
+void gen_invertible_matrix(double *A, const size_t n) {
+	// The eigenvalues of the uniform part fill a disc of radius about
+	// sqrt(n/3), the shift keeps A and its leading blocks away from
+	// singular while every block stays dense
+	gen_uniform(A, n * n, next_seed(), 0);
+	const double shift = 2.0 * sqrt((double)n);
+	for (size_t i = 0; i < n; i++) A[i * n + i] += shift;
 }
 
 int compare_mat(const double *const A, const double *const B, const size_t m,
@@ -59,55 +87,431 @@ int compare_mat(const double *const A, const double *const B, const size_t m,
 	return 1;		   // Matrices are equal within tolerance
 }
 
-double test_naive_matmat(double **A, double **B, const size_t m, const size_t n,
-			 const size_t k, const double eps) {
+// Validate C = A*B with the selected verification mode
+static int check_matmat(const double *const A, const double *const B,
+			const double *const C, const size_t m, const size_t n,
+			const size_t k, const double eps) {
+	if (verify_mode == VERIFY_FREIVALDS)
+		return freivalds_matmat(A, B, C, m, n, k, FREIVALDS_ROUNDS,
+					FREIVALDS_MATMAT_TOL,
+					next_verify_seed(), NULL);
+
 	double *C_gt = malloc(
 	    m * k * sizeof(double));  // Ground truth matrix (using cblas)
-	cblas_dgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, m, k, n, 1., *A,
-		    n, *B, k, 0., C_gt, k);
+	cblas_dgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, m, k, n, 1., A,
+		    n, B, k, 0., C_gt, k);
+	const int correct = compare_mat(C, C_gt, m, k, eps);
+	free(C_gt);
 
+	return correct;
+}
+
+// Validate inverse_A = A^-1 with the selected verification mode
+static int check_inverse(const double *const A, const double *const inverse_A,
+			 const size_t n, const double eps) {
+	if (verify_mode == VERIFY_FREIVALDS)
+		return freivalds_invert(A, inverse_A, n, FREIVALDS_ROUNDS, eps,
+					next_verify_seed(), NULL);
+
+	double *inverse_A_gt = calloc(
+	    n * n, sizeof(double));  // Allocate memory for ground truth inverse
+	int *ipiv = malloc(
+	    n * sizeof(int));  // Pivot indices for ground truth inversion
+
+	// Compute ground truth inverse using LAPACK
+	memcpy(inverse_A_gt, A,
+	       n * n * sizeof(double));	 // Copy input matrix to ground truth
+	LAPACKE_dgetrf(LAPACK_ROW_MAJOR, n, n, inverse_A_gt, n,
+		       ipiv);  // Perform LU decomposition
+	LAPACKE_dgetri(LAPACK_ROW_MAJOR, n, inverse_A_gt, n,
+		       ipiv);  // Compute inverse from LU factors
+	const int correct = compare_mat(inverse_A, inverse_A_gt, n, n, eps);
+
+	free(ipiv);
+	free(inverse_A_gt);
+
+	return correct;
+}
+
+double test_naive_matmat(double **A, double **B, const size_t m, const size_t n,
+			 const size_t k, const double eps) {
 	double *C = malloc(m * k * sizeof(double));  // Result matrix
 	clock_t start = clock();		     // Record start time
+	perf_begin();
 	naive_matmat(*A, *B, C, m, n,
 		     k);	// Perform naive matrix multiplication
+	perf_end();
 	clock_t end = clock();	// Record end time
 	double time_spent =
 	    (double)(end - start) / CLOCKS_PER_SEC;  // Calculate elapsed time
 
 	double result = -1.0;
-	if (compare_mat(C, C_gt, m, k, eps))
+	if (check_matmat(*A, *B, C, m, n, k, eps))
 		result = time_spent;  // Validate result
 
 	free(C);
-	free(C_gt);
 
 	return result;
 }
 
 double test_strassen_matmat(double **A, double **B, const size_t m,
 			    const size_t n, const size_t k, const double eps) {
-	double *C_gt = malloc(m * k * sizeof(double));	// Ground truth matrix
-	cblas_dgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, m, k, n, 1., *A,
-		    n, *B, k, 0., C_gt, k);
-
 	double *C = malloc(m * k * sizeof(double));  // Result matrix
 	clock_t start = clock();		     // Record start time
+	perf_begin();
 	strassen_matmat(A, B, &C, m, n,
 			k);	// Perform Strassen's matrix multiplication
+	perf_end();
 	clock_t end = clock();	// Record end time
 	double time_spent =
 	    (double)(end - start) / CLOCKS_PER_SEC;  // Calculate elapsed time
 
 	double result = -1.0;
-	if (compare_mat(C, C_gt, m, k, eps))
+	if (check_matmat(*A, *B, C, m, n, k, eps))
+		result = time_spent;  // Validate result
+
+	free(C);
+
+	return result;
+}
+
+double test_strassen_execute(const double *const A, const double *const B,
+			     const size_t m, const size_t n, const size_t k,
+			     const double eps) {
+	// Planning and workspace allocation are not part of the timing
+	struct strassen_plan *plan = strassen_plan(m, n, k, NULL);
+
+	double *C = malloc(m * k * sizeof(double));  // Result matrix
+	clock_t start = clock();		     // Record start time
+	perf_begin();
+	strassen_execute(plan, A, B, C);	     // Execute the plan
+	perf_end();
+	clock_t end = clock();			     // Record end time
+	double time_spent =
+	    (double)(end - start) / CLOCKS_PER_SEC;  // Calculate elapsed time
+
+	double result = -1.0;
+	if (check_matmat(A, B, C, m, n, k, eps))
 		result = time_spent;  // Validate result
 
+	free(C);
+	strassen_plan_destroy(plan);
+
+	return result;
+}
+
+double test_strassen_prepared(const double *const A, const size_t m,
+			     const size_t n, const size_t k, const size_t count,
+			     const double eps) {
+	// Planning and preparation of A are not part of the timing
+	struct strassen_plan *plan = strassen_plan(m, n, k, NULL);
+	struct strassen_prepared *prep = strassen_prepare_a(plan, A);
+
+	double *B = malloc(count * n * k * sizeof(double));
+	double *C = malloc(count * m * k * sizeof(double));
+	gen_rand_matrix(B, count * n, k);
+
+	clock_t start = clock();  // Record start time
+	perf_begin();
+	for (size_t r = 0; r < count; r++)
+		strassen_execute_prepared(prep, B + r * n * k, C + r * m * k);
+	perf_end();
+	clock_t end = clock();	// Record end time
+	double time_spent = (double)(end - start) / CLOCKS_PER_SEC /
+			    (double)(count > 0 ? count : 1);
+
+	int correct = 1;
+	for (size_t r = 0; r < count; r++)
+		correct &= check_matmat(A, B + r * n * k, C + r * m * k, m, n,
+					k, eps);
+
+	free(B);
+	free(C);
+	strassen_prepared_destroy(prep);
+	strassen_plan_destroy(plan);
+
+	return correct ? time_spent : -1.0;
+}
+
+double test_strassen_matmat_tol(const double *const A, const double *const B,
+				const size_t m, const size_t n, const size_t k,
+				const double tolerance) {
+	double *C = malloc(m * k * sizeof(double));  // Result matrix
+	clock_t start = clock();		     // Record start time
+	perf_begin();
+	const int levels = strassen_matmat_tol(A, B, C, m, n, k, tolerance);
+	perf_end();
+	clock_t end = clock();	// Record end time
+	double time_spent =
+	    (double)(end - start) / CLOCKS_PER_SEC;  // Calculate elapsed time
+
+	// Validate the relative error against the reference product
+	double *C_gt = malloc(m * k * sizeof(double));
+	cblas_dgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, m, k, n, 1., A,
+		    n, B, k, 0., C_gt, k);
+	double err = 0.0, norm = 0.0;
+	for (size_t i = 0; i < m * k; i++) {
+		err = fmax(err, fabs(C[i] - C_gt[i]));
+		norm = fmax(norm, fabs(C_gt[i]));
+	}
+
+	double result = -1.0;
+	if (levels >= 0 && err <= tolerance * norm) result = time_spent;
+
 	free(C);
 	free(C_gt);
 
 	return result;
 }
 
+// Compare the lower triangles of C and C_gt (size nxn)
+static int compare_lower(const double *const C, const double *const C_gt,
+			 const size_t n, const double eps) {
+	for (size_t i = 0; i < n; i++)
+		for (size_t j = 0; j <= i; j++)
+			if (fabs(C[i * n + j] - C_gt[i * n + j]) > eps)
+				return 0;
+	return 1;
+}
+
+double test_strassen_syrk(const double *const A, const size_t m,
+			  const size_t n, const double eps) {
+	double *C = malloc(m * m * sizeof(double));  // Result matrix
+	clock_t start = clock();		     // Record start time
+	perf_begin();
+	const int status =
+	    strassen_syrk(A, C, m, n, SYRK_A_AT);  // Lower triangle of A*A^T
+	perf_end();
+	clock_t end = clock();	// Record end time
+	double time_spent =
+	    (double)(end - start) / CLOCKS_PER_SEC;  // Calculate elapsed time
+
+	// Validate A*A^T and, untimed, A^T*A against CBLAS
+	double *C_gt = malloc(m * m * sizeof(double));
+	cblas_dsyrk(CblasRowMajor, CblasLower, CblasNoTrans, m, n, 1., A, n,
+		    0., C_gt, m);
+	int correct = status == 0 && compare_lower(C, C_gt, m, eps);
+	C = realloc(C, n * n * sizeof(double));
+	C_gt = realloc(C_gt, n * n * sizeof(double));
+	correct = correct && strassen_syrk(A, C, n, m, SYRK_AT_A) == 0;
+	cblas_dsyrk(CblasRowMajor, CblasLower, CblasTrans, n, m, 1., A, n, 0.,
+		    C_gt, n);
+	correct = correct && compare_lower(C, C_gt, n, eps);
+
+	free(C);
+	free(C_gt);
+
+	return correct ? time_spent : -1.0;
+}
+
+double test_strassen_chain(const double *const A, const double *const B,
+			   const size_t m, const size_t n, const size_t k,
+			   const double eps) {
+	// Chain A * B * B^T * A^T with sizes mxn, nxk, kxn, nxm
+	double *BT = malloc(k * n * sizeof(double));
+	double *AT = malloc(n * m * sizeof(double));
+	for (size_t i = 0; i < n; i++)
+		for (size_t j = 0; j < k; j++) BT[j * n + i] = B[i * k + j];
+	for (size_t i = 0; i < m; i++)
+		for (size_t j = 0; j < n; j++) AT[j * m + i] = A[i * n + j];
+	const double *mats[4] = {A, B, BT, AT};
+	const size_t dims[5] = {m, n, k, n, m};
+
+	double *R = malloc(m * m * sizeof(double));  // Result matrix
+	clock_t start = clock();		     // Record start time
+	perf_begin();
+	const int status = strassen_chain(mats, dims, 4, R);  // Chain product
+	perf_end();
+	clock_t end = clock();				      // Record end time
+	double time_spent =
+	    (double)(end - start) / CLOCKS_PER_SEC;  // Calculate elapsed time
+
+	// Ground truth (A*B) * (A*B)^T using cblas
+	double *AB = malloc(m * k * sizeof(double));
+	double *R_gt = malloc(m * m * sizeof(double));
+	cblas_dgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, m, k, n, 1., A,
+		    n, B, k, 0., AB, k);
+	cblas_dgemm(CblasRowMajor, CblasNoTrans, CblasTrans, m, m, k, 1., AB,
+		    k, AB, k, 0., R_gt, m);
+
+	double result = -1.0;
+	if (status == 0 && compare_mat(R, R_gt, m, m, eps * n * k))
+		result = time_spent;  // Validate result
+
+	free(BT);
+	free(AT);
+	free(R);
+	free(AB);
+	free(R_gt);
+
+	return result;
+}
+
+double test_strassen_power(const double *const A, const size_t n,
+			   const unsigned long e, const double eps) {
+	// Scale A so that its powers neither explode nor vanish
+	double *A_scaled = malloc(n * n * sizeof(double));
+	const double scale = 1.0 / sqrt((double)n);
+	for (size_t i = 0; i < n * n; i++) A_scaled[i] = scale * A[i];
+
+	double *P = malloc(n * n * sizeof(double));  // Result matrix
+	clock_t start = clock();		     // Record start time
+	perf_begin();
+	const int status = strassen_power(A_scaled, P, n, e);  // Power
+	perf_end();
+	clock_t end = clock();  // Record end time
+	double time_spent =
+	    (double)(end - start) / CLOCKS_PER_SEC;  // Calculate elapsed time
+
+	// Ground truth by e successive multiplications using cblas
+	double *P_gt = calloc(n * n, sizeof(double));
+	double *temp = malloc(n * n * sizeof(double));
+	for (size_t i = 0; i < n; i++) P_gt[i * n + i] = 1.0;
+	for (unsigned long i = 0; i < e; i++) {
+		cblas_dgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, n, n, n,
+			    1., P_gt, n, A_scaled, n, 0., temp, n);
+		memcpy(P_gt, temp, n * n * sizeof(double));
+	}
+
+	double result = -1.0;
+	if (status == 0 && compare_mat(P, P_gt, n, n, eps))
+		result = time_spent;  // Validate result
+
+	free(A_scaled);
+	free(P);
+	free(P_gt);
+	free(temp);
+
+	return result;
+}
+
+// Wall clock time, clock() would add up the time of all worker threads
+static double wall_time(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + 1e-9 * (double)ts.tv_nsec;
+}
+
+double test_executor_matmat(const double *const A, const double *const B,
+			    const size_t m, const size_t n, const size_t k,
+			    const size_t jobs, const double eps) {
+	struct strassen_executor *executor = strassen_executor_create(0);
+	struct strassen_future **futures =
+	    malloc(jobs * sizeof(struct strassen_future *));
+	double *C = malloc(jobs * m * k * sizeof(double));  // Result matrices
+
+	double start = wall_time();  // Record start time
+	perf_begin();
+	for (size_t j = 0; j < jobs; j++)  // Keep all jobs in flight at once
+		futures[j] = strassen_submit_matmat(executor, A, B,
+						    C + j * m * k, m, n, k,
+						    NULL, NULL);
+	int failed = 0;
+	for (size_t j = 0; j < jobs; j++) {
+		failed |= futures[j] == NULL ||
+			  strassen_future_wait(futures[j]) != 0;
+		if (futures[j] != NULL) strassen_future_release(futures[j]);
+	}
+	double time_spent = wall_time() - start;  // Calculate elapsed time
+	// Workers are only counted once they have exited
+	strassen_executor_destroy(executor);
+	perf_end();
+
+	double result = -1.0;
+	if (!failed) {
+		result = time_spent;
+		for (size_t j = 0; j < jobs; j++)  // Validate every result
+			if (!check_matmat(A, B, C + j * m * k, m, n, k, eps))
+				result = -1.0;
+	}
+
+	free(futures);
+	free(C);
+
+	return result;
+}
+
+double test_executor_solve(const double *const A, const double *const B,
+			   const size_t n, const size_t k, const double eps) {
+	struct strassen_executor *executor = strassen_executor_create(0);
+	double *X = malloc(n * k * sizeof(double));  // Solution
+
+	double start = wall_time();  // Record start time
+	perf_begin();
+	struct strassen_future *future =
+	    strassen_submit_solve(executor, A, B, X, n, k, NULL, NULL);
+	int failed = future == NULL || strassen_future_wait(future) != 0;
+	double time_spent = wall_time() - start;  // Calculate elapsed time
+	if (future != NULL) strassen_future_release(future);
+	strassen_executor_destroy(executor);
+	perf_end();
+
+	double result = -1.0;
+	if (!failed && check_matmat(A, X, B, n, n, k, eps))
+		result = time_spent;  // Validate A*X = B
+
+	free(X);
+
+	return result;
+}
+
+// One caller of the reentrant multiplication on the shared operands
+struct shared_matmat {
+	const double *A, *B;
+	double *C;
+	size_t m, n, k;
+	int status;
+};
+
+static void *run_shared_matmat(void *arg) {
+	struct shared_matmat *call = arg;
+	call->status = strassen_matmat_r(call->A, call->B, call->C, call->m,
+					 call->n, call->k);
+	return NULL;
+}
+
+double test_strassen_matmat_r(const double *const A, const double *const B,
+			      const size_t m, const size_t n, const size_t k,
+			      const size_t threads, const double eps) {
+	// Read-only copies of A and B, any write to them would fault
+	const size_t bytes = (m * n + n * k) * sizeof(double);
+	double *shared = mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+			      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (shared == MAP_FAILED) return -1.0;
+	memcpy(shared, A, m * n * sizeof(double));
+	memcpy(shared + m * n, B, n * k * sizeof(double));
+	mprotect(shared, bytes, PROT_READ);
+
+	pthread_t *tids = malloc(threads * sizeof(pthread_t));
+	struct shared_matmat *calls =
+	    malloc(threads * sizeof(struct shared_matmat));
+	double *C = malloc(threads * m * k * sizeof(double));  // Results
+
+	double start = wall_time();  // Record start time
+	perf_begin();
+	for (size_t t = 0; t < threads; t++) {
+		calls[t] = (struct shared_matmat){
+		    shared, shared + m * n, C + t * m * k, m, n, k, -1};
+		pthread_create(&tids[t], NULL, run_shared_matmat, &calls[t]);
+	}
+	for (size_t t = 0; t < threads; t++) pthread_join(tids[t], NULL);
+	perf_end();
+	double time_spent = wall_time() - start;  // Calculate elapsed time
+
+	double result = time_spent;
+	for (size_t t = 0; t < threads; t++)  // Validate every result
+		if (calls[t].status != 0 ||
+		    !check_matmat(A, B, C + t * m * k, m, n, k, eps))
+			result = -1.0;
+
+	munmap(shared, bytes);
+	free(tids);
+	free(calls);
+	free(C);
+
+	return result;
+}
+
 int is_invertible(double *A, int n) {
 	int *ipiv = (int *)malloc(n * sizeof(int));  // Pivot indices
 	int info;
@@ -126,104 +530,659 @@ double test_strassen_invert_strassen_matmat(double **A, const size_t n,
 	double *inverse_A = calloc(
 	    n * n,
 	    sizeof(double));  // Allocate memory for Strassen's inverted matrix
-	double *inverse_A_gt = calloc(
-	    n * n, sizeof(double));  // Allocate memory for ground truth inverse
-	int *ipiv = malloc(
-	    n * sizeof(int));  // Pivot indices for ground truth inversion
+	clock_t start = clock();  // Record start time
+	perf_begin();
+	const int status = strassen_invert_strassen_matmat(
+	    A, &inverse_A, n);	// Perform Strassen's inversion
+	perf_end();
+	clock_t end = clock();		     // Record end time
+	double time_spent =
+	    (double)(end - start) / CLOCKS_PER_SEC;  // Calculate elapsed time
 
-	// Compute ground truth inverse using LAPACK
-	memcpy(inverse_A_gt, *A,
-	       n * n * sizeof(double));	 // Copy input matrix to ground truth
-	LAPACKE_dgetrf(LAPACK_ROW_MAJOR, n, n, inverse_A_gt, n,
-		       ipiv);  // Perform LU decomposition
-	LAPACKE_dgetri(LAPACK_ROW_MAJOR, n, inverse_A_gt, n,
-		       ipiv);  // Compute inverse from LU factors
+	double result = -1.0;
+	if (status == 0 &&
+	    check_inverse(*A, inverse_A, n,
+			  eps))	 // Validate result against ground truth
+		result = time_spent;
+
+	free(inverse_A);
+
+	return result;
+}
+
+// Fill A with `count` random entries in [0, p) from the test seed
+static void gen_mod(uint64_t *A, const size_t count, const uint64_t p) {
+	gen_bits(A, count, next_seed(), 0);
+	for (size_t i = 0; i < count; i++) A[i] %= p;
+}
+
+// Fill A with `count` random entries in [-2^20, 2^20) from the test seed
+static void gen_i64(int64_t *A, const size_t count) {
+	gen_bits((uint64_t *)A, count, next_seed(), 0);
+	for (size_t i = 0; i < count; i++)
+		A[i] = (int64_t)((uint64_t)A[i] >> 43) - (1 << 20);
+}
+
+// C = A*B mod p by the definition, one reduction per term
+static void naive_matmat_mod(const uint64_t *const A, const uint64_t *const B,
+			     uint64_t *C, const size_t m, const size_t n,
+			     const size_t k, const uint64_t p) {
+	for (size_t i = 0; i < m; i++) {
+		for (size_t j = 0; j < k; j++) {
+			uint64_t sum = 0;
+			for (size_t l = 0; l < n; l++)
+				sum = (sum + A[i * n + l] * B[l * k + j] % p) %
+				      p;
+			C[i * k + j] = sum;
+		}
+	}
+}
+
+double test_strassen_matmat_i64(const size_t m, const size_t n,
+				const size_t k) {
+	int64_t *A = malloc(m * n * sizeof(int64_t));
+	int64_t *B = malloc(n * k * sizeof(int64_t));
+	int64_t *C = malloc(m * k * sizeof(int64_t));
+	int64_t *C_gt = calloc(m * k, sizeof(int64_t));
+	// Entries in [-2^20, 2^20), the products fit int64 without wrapping
+	gen_i64(A, m * n);
+	gen_i64(B, n * k);
 
 	clock_t start = clock();  // Record start time
-	strassen_invert_strassen_matmat(A, &inverse_A,
-					n);  // Perform Strassen's inversion
+	perf_begin();
+	const int status = strassen_matmat_i64(A, B, C, m, n, k);
+	perf_end();
+	clock_t end = clock();	// Record end time
+	double time_spent =
+	    (double)(end - start) / CLOCKS_PER_SEC;  // Calculate elapsed time
+
+	// Ground truth by the definition
+	for (size_t i = 0; i < m; i++)
+		for (size_t l = 0; l < n; l++)
+			for (size_t j = 0; j < k; j++)
+				C_gt[i * k + j] += A[i * n + l] * B[l * k + j];
+
+	double result = -1.0;
+	if (status == 0 && memcmp(C, C_gt, m * k * sizeof(int64_t)) == 0)
+		result = time_spent;  // Bit-exact match
+
+	free(A);
+	free(B);
+	free(C);
+	free(C_gt);
+
+	return result;
+}
+
+double test_strassen_matmat_mod(const size_t m, const size_t n, const size_t k,
+				const uint64_t p) {
+	uint64_t *A = malloc(m * n * sizeof(uint64_t));
+	uint64_t *B = malloc(n * k * sizeof(uint64_t));
+	uint64_t *C = malloc(m * k * sizeof(uint64_t));
+	uint64_t *C_gt = malloc(m * k * sizeof(uint64_t));
+	gen_mod(A, m * n, p);
+	gen_mod(B, n * k, p);
+
+	clock_t start = clock();  // Record start time
+	perf_begin();
+	const int status = strassen_matmat_mod(A, B, C, m, n, k, p);
+	perf_end();
+	clock_t end = clock();	// Record end time
+	double time_spent =
+	    (double)(end - start) / CLOCKS_PER_SEC;  // Calculate elapsed time
+
+	naive_matmat_mod(A, B, C_gt, m, n, k, p);  // Ground truth
+
+	double result = -1.0;
+	if (status == 0 && memcmp(C, C_gt, m * k * sizeof(uint64_t)) == 0)
+		result = time_spent;  // Bit-exact match
+
+	free(A);
+	free(B);
+	free(C);
+	free(C_gt);
+
+	return result;
+}
+
+double test_strassen_invert_mod(const size_t n, const uint64_t p) {
+	uint64_t *A = malloc(n * n * sizeof(uint64_t));
+	uint64_t *inverse_A = malloc(n * n * sizeof(uint64_t));
+	uint64_t *P = malloc(n * n * sizeof(uint64_t));
+	gen_mod(A, n * n, p);
+
+	clock_t start = clock();  // Record start time
+	perf_begin();
+	const int status = strassen_invert_mod(A, inverse_A, n, p);
+	perf_end();
+	clock_t end = clock();	// Record end time
+	double time_spent =
+	    (double)(end - start) / CLOCKS_PER_SEC;  // Calculate elapsed time
+
+	double result = -1.0;
+	if (status == 0) {
+		// A * A^-1 must be exactly the identity
+		naive_matmat_mod(A, inverse_A, P, n, n, n, p);
+		int exact = 1;
+		for (size_t i = 0; i < n && exact; i++)
+			for (size_t j = 0; j < n && exact; j++)
+				exact = P[i * n + j] == (i == j);
+		if (exact) result = time_spent;
+	}
+
+	free(A);
+	free(inverse_A);
+	free(P);
+
+	return result;
+}
+
+double test_strassen_invert_triangular(const size_t n, const double eps) {
+	// Lower triangular with a dominant diagonal, so every level of the
+	// recursion sees a zero upper right block
+	double *A = calloc(n * n, sizeof(double));
+	for (size_t i = 0; i < n; i++) {
+		gen_rand_matrix(A + i * n, 1, i);
+		A[i * n + i] = (double)n;
+	}
+	double *inverse_A = calloc(n * n, sizeof(double));
+	clock_t start = clock();  // Record start time
+	perf_begin();
+	const int status = strassen_invert_strassen_matmat(
+	    &A, &inverse_A, n);	 // Perform Strassen's inversion
+	perf_end();
 	clock_t end = clock();		     // Record end time
 	double time_spent =
 	    (double)(end - start) / CLOCKS_PER_SEC;  // Calculate elapsed time
 
 	double result = -1.0;
-	if (compare_mat(inverse_A, inverse_A_gt, n, n,
-			eps))  // Validate result against ground truth
+	if (status == 0 &&
+	    check_inverse(A, inverse_A, n,
+			  eps))	 // Validate result against ground truth
 		result = time_spent;
 
-	free(ipiv);
+	free(A);
 	free(inverse_A);
-	free(inverse_A_gt);
 
 	return result;
 }
 
+double test_strassen_invert_spd(const size_t n, const double eps) {
+	double *A = malloc(n * n * sizeof(double));
+	gen_spd(A, n, next_seed(), 0);
+
+	double *inverse_A = malloc(n * n * sizeof(double));
+	clock_t start = clock();  // Record start time
+	perf_begin();
+	const int status =
+	    strassen_invert_spd(A, inverse_A, n);  // Perform SPD inversion
+	perf_end();
+	clock_t end = clock();			   // Record end time
+	double time_spent =
+	    (double)(end - start) / CLOCKS_PER_SEC;  // Calculate elapsed time
+
+	double result = -1.0;
+	if (status == 0 &&
+	    check_inverse(A, inverse_A, n,
+			  eps))	 // Validate result against ground truth
+		result = time_spent;
+
+	free(A);
+	free(inverse_A);
+
+	return result;
+}
+
+// Random A (size nxn) with a dominant diagonal and its inverse
+static void gen_inverted_matrix(double *A, double *inverse_A, const size_t n) {
+	gen_well_conditioned(A, n, next_seed(), 0);
+	lu_invert(A, inverse_A, n);
+}
+
+double test_strassen_update_inverse(const size_t n, const size_t k,
+				    const double eps) {
+	double *A = malloc(n * n * sizeof(double));
+	double *inverse_A = malloc(n * n * sizeof(double));
+	double *U = malloc(n * k * sizeof(double));
+	double *V = malloc(k * n * sizeof(double));
+	gen_inverted_matrix(A, inverse_A, n);
+	gen_rand_matrix(U, n, k);
+	gen_rand_matrix(V, k, n);
+
+	clock_t start = clock();  // Record start time
+	perf_begin();
+	const int status = strassen_update_inverse(inverse_A, U, V, n, k);
+	perf_end();
+	clock_t end = clock();	// Record end time
+	double time_spent =
+	    (double)(end - start) / CLOCKS_PER_SEC;  // Calculate elapsed time
+
+	// Validate against the inverse of A + U*V
+	cblas_dgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, n, n, k, 1., U,
+		    k, V, n, 1., A, n);
+	double result = -1.0;
+	if (status == 0 && check_inverse(A, inverse_A, n, eps))
+		result = time_spent;
+
+	free(A);
+	free(inverse_A);
+	free(U);
+	free(V);
+
+	return result;
+}
+
+double test_strassen_border_inverse(const size_t n, const size_t k,
+				    const double eps) {
+	const size_t N = n + k;
+	double *A = malloc(n * n * sizeof(double));
+	double *inverse_A = malloc(n * n * sizeof(double));
+	double *M = malloc(N * N * sizeof(double));  // Bordered matrix
+	double *inverse_M = malloc(N * N * sizeof(double));
+	gen_inverted_matrix(A, inverse_A, n);
+	gen_rand_matrix(M, N, N);
+	for (size_t i = 0; i < N; i++) M[i * N + i] += (double)N;
+	for (size_t i = 0; i < n; i++)
+		memcpy(M + i * N, A + i * n, n * sizeof(double));
+
+	// Borders B, C and D as separate matrices
+	double *B = malloc(n * k * sizeof(double));
+	double *C = malloc(k * n * sizeof(double));
+	double *D = malloc(k * k * sizeof(double));
+	for (size_t i = 0; i < n; i++)
+		memcpy(B + i * k, M + i * N + n, k * sizeof(double));
+	for (size_t i = 0; i < k; i++) {
+		memcpy(C + i * n, M + (n + i) * N, n * sizeof(double));
+		memcpy(D + i * k, M + (n + i) * N + n, k * sizeof(double));
+	}
+
+	clock_t start = clock();  // Record start time
+	perf_begin();
+	const int status =
+	    strassen_border_inverse(inverse_A, B, C, D, inverse_M, n, k);
+	perf_end();
+	clock_t end = clock();	// Record end time
+	double time_spent =
+	    (double)(end - start) / CLOCKS_PER_SEC;  // Calculate elapsed time
+
+	double result = -1.0;
+	if (status == 0 && check_inverse(M, inverse_M, N, eps))
+		result = time_spent;
+
+	free(A);
+	free(inverse_A);
+	free(M);
+	free(inverse_M);
+	free(B);
+	free(C);
+	free(D);
+
+	return result;
+}
+
+double test_inverse_cache(const size_t n, const double eps) {
+	// Room for two inverses, so the third matrix evicts the first
+	struct inverse_cache *cache =
+	    inverse_cache_create(2 * n * n * sizeof(double));
+	double *A[3], *inverse_A[3];
+	for (int i = 0; i < 3; i++) {
+		A[i] = malloc(n * n * sizeof(double));
+		inverse_A[i] = malloc(n * n * sizeof(double));
+		gen_inverted_matrix(A[i], inverse_A[i], n);
+	}
+	double *X = malloc(n * n * sizeof(double));
+	double *B = malloc(n * n * sizeof(double));
+	gen_rand_matrix(B, n, n);
+
+	int correct = 1;
+	inverse_cache_invert(cache, A[0], X, n);  // miss
+	correct &= check_inverse(A[0], X, n, eps);
+
+	// Time the repeated inversion, served from the cache
+	clock_t start = clock();  // Record start time
+	perf_begin();
+	inverse_cache_invert(cache, A[0], X, n);  // hit
+	perf_end();
+	clock_t end = clock();	// Record end time
+	double time_spent =
+	    (double)(end - start) / CLOCKS_PER_SEC;  // Calculate elapsed time
+	correct &= check_inverse(A[0], X, n, eps);
+
+	inverse_cache_solve(cache, A[0], B, X, n, n);  // hit
+	correct &= check_matmat(A[0], X, B, n, n, n, eps);
+	inverse_cache_invert(cache, A[1], X, n);  // miss
+	inverse_cache_invert(cache, A[2], X, n);  // miss, evicts A[0]
+	correct &= check_inverse(A[2], X, n, eps);
+	inverse_cache_invert(cache, A[0], X, n);  // miss, evicts A[1]
+	correct &= check_inverse(A[0], X, n, eps);
+
+	// A singular matrix fails and is not cached, so it misses again
+	memset(B, 0, n * n * sizeof(double));
+	correct &= inverse_cache_invert(cache, B, X, n) == -1;
+	correct &= inverse_cache_solve(cache, B, A[1], X, n, n) == -1;
+
+	const struct inverse_cache_stats stats = inverse_cache_stats(cache);
+	correct &= stats.hits == 2 && stats.misses == 6 &&
+		   stats.evictions == 2 && stats.entries == 2;
+
+	for (int i = 0; i < 3; i++) {
+		free(A[i]);
+		free(inverse_A[i]);
+	}
+	free(X);
+	free(B);
+	inverse_cache_destroy(cache);
+
+	return correct ? time_spent : -1.0;
+}
+
+// Sum of squares of the entries of A (size nxn)
+static double frobenius2(const double *const A, const size_t n) {
+	double sum = 0.0;
+	for (size_t i = 0; i < n * n; i++) sum += A[i] * A[i];
+	return sum;
+}
+
+double test_gen_matrix(const size_t n) {
+	// Thread invariance is checked on a size that is split over threads
+	const size_t N = n > 512 ? n : 512;
+	const uint64_t seed = next_seed();
+	double *A = malloc(N * N * sizeof(double));
+	double *B = malloc(N * N * sizeof(double));
+
+	clock_t start = clock();  // Record start time
+	perf_begin();
+	gen_uniform(A, n * n, seed, 0);
+	perf_end();
+	clock_t end = clock();	// Record end time
+	double time_spent =
+	    (double)(end - start) / CLOCKS_PER_SEC;  // Calculate elapsed time
+
+	int correct = 1;
+	for (size_t i = 0; i < n * n; i++)
+		correct &= A[i] >= -1.0 && A[i] < 1.0;
+
+	// Same output on one thread and on several
+	gen_uniform(A, N * N, seed, 1);
+	gen_uniform(B, N * N, seed, 3);
+	correct &= memcmp(A, B, N * N * sizeof(double)) == 0;
+	gen_well_conditioned(A, N, seed, 1);
+	gen_well_conditioned(B, N, seed, 3);
+	correct &= memcmp(A, B, N * N * sizeof(double)) == 0;
+	gen_conditioned(A, N, 100.0, seed, 1);
+	gen_conditioned(B, N, 100.0, seed, 3);
+	correct &= memcmp(A, B, N * N * sizeof(double)) == 0;
+	gen_spd(A, N, seed, 1);
+	gen_spd(B, N, seed, 3);
+	correct &= memcmp(A, B, N * N * sizeof(double)) == 0;
+
+	// The SPD matrix has a Cholesky factor
+	correct &= LAPACKE_dpotrf(LAPACK_ROW_MAJOR, 'L', N, B, N) == 0;
+
+	// Singular values d_i of the conditioned matrix go from 1 to 1/cond,
+	// their sums of squares are the squared norms of A and A^-1
+	const double cond = 100.0;
+	double d2 = 0.0, inverse_d2 = 0.0;
+	for (size_t i = 0; i < n; i++) {
+		const double d =
+		    n > 1 ? pow(cond, -(double)i / (double)(n - 1)) : 1.0;
+		d2 += d * d;
+		inverse_d2 += 1.0 / (d * d);
+	}
+	gen_conditioned(A, n, cond, seed, 0);
+	lu_invert(A, B, n);
+	correct &= fabs(frobenius2(A, n) - d2) <= 1e-8 * d2 &&
+		   fabs(frobenius2(B, n) - inverse_d2) <= 1e-8 * inverse_d2;
+
+	free(A);
+	free(B);
+
+	return correct ? time_spent : -1.0;
+}
+
+// Interleave the planes Zr and Zi (size count) into Z as re, im pairs
+static void interleave(const double *const Zr, const double *const Zi,
+		       double *Z, const size_t count) {
+	for (size_t i = 0; i < count; i++) {
+		Z[2 * i] = Zr[i];
+		Z[2 * i + 1] = Zi[i];
+	}
+}
+
+// Whether the split C (size mxk) is the interleaved reference C_gt
+static int compare_split(const double *const Cr, const double *const Ci,
+			 const double *const C_gt, const size_t count,
+			 const double eps) {
+	for (size_t i = 0; i < count; i++)
+		if (fabs(Cr[i] - C_gt[2 * i]) > eps ||
+		    fabs(Ci[i] - C_gt[2 * i + 1]) > eps)
+			return 0;
+	return 1;
+}
+
+double test_strassen_zmatmat(const size_t m, const size_t n, const size_t k,
+			     const double eps) {
+	double *A = malloc(2 * m * n * sizeof(double));	 // re and im planes
+	double *B = malloc(2 * n * k * sizeof(double));
+	double *C = malloc(2 * m * k * sizeof(double));
+	gen_rand_matrix(A, 2 * m, n);
+	gen_rand_matrix(B, 2 * n, k);
+
+	clock_t start = clock();  // Record start time
+	perf_begin();
+	const int status = strassen_zmatmat(A, A + m * n, B, B + n * k, C,
+					    C + m * k, m, n, k);
+	perf_end();
+	clock_t end = clock();	// Record end time
+	double time_spent =
+	    (double)(end - start) / CLOCKS_PER_SEC;  // Calculate elapsed time
+
+	// Reference product with CBLAS on interleaved copies
+	double *Az = malloc(2 * m * n * sizeof(double));
+	double *Bz = malloc(2 * n * k * sizeof(double));
+	double *Cz = malloc(2 * m * k * sizeof(double));
+	interleave(A, A + m * n, Az, m * n);
+	interleave(B, B + n * k, Bz, n * k);
+	const double one[2] = {1.0, 0.0}, zero[2] = {0.0, 0.0};
+	cblas_zgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, m, k, n, one,
+		    Az, n, Bz, k, zero, Cz, k);
+	const int correct =
+	    status == 0 && compare_split(C, C + m * k, Cz, m * k, eps);
+
+	free(A);
+	free(B);
+	free(C);
+	free(Az);
+	free(Bz);
+	free(Cz);
+
+	return correct ? time_spent : -1.0;
+}
+
+double test_strassen_zinvert(const size_t n, const double eps) {
+	// Random complex A with a dominant real diagonal
+	double *A = malloc(2 * n * n * sizeof(double));	 // re and im planes
+	double *X = malloc(2 * n * n * sizeof(double));
+	gen_rand_matrix(A, 2 * n, n);
+	for (size_t i = 0; i < n; i++) A[i * n + i] += 2.0 * n;
+
+	clock_t start = clock();  // Record start time
+	perf_begin();
+	const int status =
+	    strassen_zinvert(A, A + n * n, X, X + n * n, n);
+	perf_end();
+	clock_t end = clock();	// Record end time
+	double time_spent =
+	    (double)(end - start) / CLOCKS_PER_SEC;  // Calculate elapsed time
+
+	// A * X must be the identity
+	double *Az = malloc(2 * n * n * sizeof(double));
+	double *Xz = malloc(2 * n * n * sizeof(double));
+	double *P = malloc(2 * n * n * sizeof(double));
+	double *I_re = calloc(n * n, sizeof(double));
+	double *I_im = calloc(n * n, sizeof(double));
+	for (size_t i = 0; i < n; i++) I_re[i * n + i] = 1.0;
+	interleave(A, A + n * n, Az, n * n);
+	interleave(X, X + n * n, Xz, n * n);
+	const double one[2] = {1.0, 0.0}, zero[2] = {0.0, 0.0};
+	cblas_zgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, n, n, n, one,
+		    Az, n, Xz, n, zero, P, n);
+	const int correct =
+	    status == 0 && compare_split(I_re, I_im, P, n * n, eps);
+
+	free(A);
+	free(X);
+	free(Az);
+	free(Xz);
+	free(P);
+	free(I_re);
+	free(I_im);
+
+	return correct ? time_spent : -1.0;
+}
+
+double test_strassen_budget(const size_t n, const double eps) {
+	double *A = malloc(n * n * sizeof(double));
+	double *inverse_A = malloc(n * n * sizeof(double));
+	double *X = malloc(n * n * sizeof(double));
+	gen_inverted_matrix(A, inverse_A, n);
+
+	// One byte is too little for anything but the fixed kernels, the
+	// failed call reports the smallest estimate, which is then used
+	struct strassen_memory memory = {.budget = 1};
+	const int fits = strassen_invert_budget(A, X, n, &memory) == 0;
+	int correct = fits == (memory.estimate <= 1);
+	memory.budget = memory.estimate;
+
+	clock_t start = clock();  // Record start time
+	perf_begin();
+	int status = strassen_invert_budget(A, X, n, &memory);
+	perf_end();
+	clock_t end = clock();	// Record end time
+	double time_spent =
+	    (double)(end - start) / CLOCKS_PER_SEC;  // Calculate elapsed time
+
+	correct &= status == 0 && check_inverse(A, X, n, eps) &&
+		   memory.peak <= memory.estimate &&
+		   (memory.budget == 0 || memory.estimate <= memory.budget);
+
+	// A product within half of its unlimited plan, but no less than the
+	// classical plan, which a budget of one byte reports
+	struct strassen_memory product = {.budget = 1};
+	correct &= strassen_matmat_budget(A, inverse_A, X, n, n, n,
+					  &product) == -1;
+	const size_t least = product.estimate;
+	product.budget = 0;
+	strassen_matmat_budget(A, inverse_A, X, n, n, n, &product);
+	product.budget = product.estimate / 2 > least ? product.estimate / 2
+						      : least;
+	correct &= strassen_matmat_budget(A, inverse_A, X, n, n, n,
+					  &product) == 0 &&
+		   product.estimate <= product.budget &&
+		   product.peak <= product.budget &&
+		   check_matmat(A, inverse_A, X, n, n, n, eps);
+
+	free(A);
+	free(inverse_A);
+	free(X);
+
+	return correct ? time_spent : -1.0;
+}
+
 double test_strassen_invert_naive_matmat(double **A, const size_t n,
 					 const double eps) {
 	double *inverse_A = calloc(
 	    n * n, sizeof(double));  // Allocate memory for Naive inversion
-	double *inverse_A_gt = calloc(
-	    n * n, sizeof(double));  // Allocate memory for ground truth inverse
-	int *ipiv = malloc(
-	    n * sizeof(int));  // Pivot indices for ground truth inversion
-
-	// Compute ground truth inverse using LAPACK
-	memcpy(inverse_A_gt, *A,
-	       n * n * sizeof(double));	 // Copy input matrix to ground truth
-	LAPACKE_dgetrf(LAPACK_ROW_MAJOR, n, n, inverse_A_gt, n,
-		       ipiv);  // Perform LU decomposition
-	LAPACKE_dgetri(LAPACK_ROW_MAJOR, n, inverse_A_gt, n,
-		       ipiv);  // Compute inverse from LU factors
-
 	clock_t start = clock();  // Record start time
-	strassen_invert_naive_matmat(A, &inverse_A,
-				     n);  // Perform Naive inversion
+	perf_begin();
+	const int status = strassen_invert_naive_matmat(
+	    A, &inverse_A, n);	// Perform Naive inversion
+	perf_end();
 	clock_t end = clock();		  // Record end time
 	double time_spent =
 	    (double)(end - start) / CLOCKS_PER_SEC;  // Calculate elapsed time
 
 	double result = -1.0;
-	if (compare_mat(inverse_A, inverse_A_gt, n, n,
-			eps))  // Validate result against ground truth
+	if (status == 0 &&
+	    check_inverse(*A, inverse_A, n,
+			  eps))	 // Validate result against ground truth
 		result = time_spent;
 
-	free(ipiv);
 	free(inverse_A);
-	free(inverse_A_gt);
 
 	return result;
 }
 
+// Whether the determinant and condition number in info match LAPACK's
+// factorization of A (size nxn)
+static int check_inverse_info(const double *const A,
+			      const struct inverse_info *info, const size_t n,
+			      const double eps) {
+	double *T = malloc(n * n * sizeof(double));
+	int *ipiv = malloc(n * sizeof(int));
+	memcpy(T, A, n * n * sizeof(double));
+	LAPACKE_dgetrf(LAPACK_ROW_MAJOR, n, n, T, n, ipiv);
+
+	// det(A) = (-1)^swaps * prod(U_ii)
+	int sign = 1;
+	double log_abs_det = 0.0;
+	for (size_t i = 0; i < n; i++) {
+		if ((size_t)ipiv[i] != i + 1) sign = -sign;
+		if (T[i * n + i] < 0.0) sign = -sign;
+		log_abs_det += log(fabs(T[i * n + i]));
+	}
+	LAPACKE_dgetri(LAPACK_ROW_MAJOR, n, T, n, ipiv);
+	const double cond1 = block_norm1(A, n, n) * block_norm1(T, n, n);
+	free(T);
+	free(ipiv);
+
+	return info->det_sign == sign &&
+	       fabs(info->log_abs_det - log_abs_det) <=
+		   eps * fmax(1.0, fabs(log_abs_det)) &&
+	       fabs(info->cond1 - cond1) <= eps * cond1;
+}
+
+double test_strassen_invert_info(const double *const A, const size_t n,
+				 const double eps) {
+	double *inverse_A = malloc(n * n * sizeof(double));
+	struct inverse_info info;
+	clock_t start = clock();  // Record start time
+	perf_begin();
+	const int status = strassen_invert_info(A, inverse_A, n, &info);
+	perf_end();
+	clock_t end = clock();	// Record end time
+	double time_spent =
+	    (double)(end - start) / CLOCKS_PER_SEC;  // Calculate elapsed time
+
+	int correct = status == 0 && check_inverse(A, inverse_A, n, eps) &&
+		      check_inverse_info(A, &info, n, eps);
+
+	// The same by-products from the LU inversion
+	lu_invert_info(A, inverse_A, n, &info);
+	correct &= check_inverse_info(A, &info, n, eps);
+
+	free(inverse_A);
+
+	return correct ? time_spent : -1.0;
+}
+
 double test_lu_invert(const double *const A, const size_t n, const double eps) {
 	double *inverse_A =
 	    calloc(n * n, sizeof(double));  // Allocate memory for LU inversion
-	double *inverse_A_gt = calloc(
-	    n * n, sizeof(double));  // Allocate memory for ground truth inverse
-	int *ipiv = malloc(
-	    n * sizeof(int));  // Pivot indices for ground truth inversion
-
-	// Compute ground truth inverse using LAPACK
-	memcpy(inverse_A_gt, A,
-	       n * n * sizeof(double));	 // Copy input matrix to ground truth
-	LAPACKE_dgetrf(LAPACK_ROW_MAJOR, n, n, inverse_A_gt, n,
-		       ipiv);  // Perform LU decomposition
-	LAPACKE_dgetri(LAPACK_ROW_MAJOR, n, inverse_A_gt, n,
-		       ipiv);  // Compute inverse from LU factors
-
 	clock_t start = clock();     // Record start time
+	perf_begin();
 	lu_invert(A, inverse_A, n);  // Perform LU-based inversion
+	perf_end();
 	clock_t end = clock();	     // Record end time
 	double time_spent =
 	    (double)(end - start) / CLOCKS_PER_SEC;  // Calculate elapsed time
 
 	double result = -1.0;
-	if (compare_mat(inverse_A, inverse_A_gt, n, n,
-			eps))  // Validate result against ground truth
+	if (check_inverse(A, inverse_A, n,
+			  eps))	 // Validate result against ground truth
 		result = time_spent;
 
-	free(ipiv);
 	free(inverse_A);
-	free(inverse_A_gt);
 
 	return result;
 }
@@ -0,0 +1,145 @@
+/*
+ * DESC: Module for randomized O(n^2) result verification (Freivalds).
+ * AUTHORS: Thomas Gantz, Laura Paxton, Jan Marxen
+ */
+#include "../include/verify.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+// y = M*x for M of size mxn
+static void matvec(const double *const M, const double *const x, double *y,
+		   const size_t m, const size_t n) {
+	for (size_t i = 0; i < m; i++) {
+		double sum = 0.0;
+		for (size_t j = 0; j < n; j++) sum += M[i * n + j] * x[j];
+		y[i] = sum;
+	}
+}
+
+// y = |M|*x for M of size mxn
+static void abs_matvec(const double *const M, const double *const x,
+		       double *y, const size_t m, const size_t n) {
+	for (size_t i = 0; i < m; i++) {
+		double sum = 0.0;
+		for (size_t j = 0; j < n; j++) sum += fabs(M[i * n + j]) * x[j];
+		y[i] = sum;
+	}
+}
+
+static double norm2(const double *const x, const size_t size) {
+	double sum = 0.0;
+	for (size_t i = 0; i < size; i++) sum += x[i] * x[i];
+	return sqrt(sum);
+}
+
+// Next 64 random bits of a SplitMix64 stream, kept apart from rand() so
+// that verifying does not change the matrices of later tests
+static uint64_t next_bits(uint64_t *state) {
+	uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+// Fill x with random entries +-1
+static void rand_sign_vector(double *x, const size_t size, uint64_t *state) {
+	for (size_t i = 0; i < size; i += 64) {
+		const uint64_t bits = next_bits(state);
+		for (size_t j = i; j < size && j < i + 64; j++)
+			x[j] = (bits >> (j - i)) & 1 ? 1.0 : -1.0;
+	}
+}
+
+static void fill_report(struct verify_report *report, const double residual,
+			const int rounds, const int passed) {
+	if (report == NULL) return;
+	report->residual = residual;
+	report->error_bound = ldexp(1.0, -rounds);
+	report->rounds = rounds;
+	report->passed = passed;
+}
+
+int freivalds_matmat(const double *const A, const double *const B,
+		     const double *const C, const size_t m, const size_t n,
+		     const size_t k, const int rounds, const double eps,
+		     uint64_t seed, struct verify_report *report) {
+	double *x = (double *)malloc(k * sizeof(double));
+	double *Bx = (double *)malloc(n * sizeof(double));
+	double *ABx = (double *)malloc(m * sizeof(double));
+	double *Cx = (double *)malloc(m * sizeof(double));
+	double *scale = (double *)malloc(m * sizeof(double));
+
+	// Scale of row i of the product, |A|*|B|*|x| with |x| = 1, in units
+	// of the rounding error n*u of an inner product
+	for (size_t j = 0; j < k; j++) x[j] = 1.0;
+	abs_matvec(B, x, Bx, n, k);
+	abs_matvec(A, Bx, scale, m, n);
+	const double unit = (double)(n > 0 ? n : 1) * DBL_EPSILON;
+	for (size_t i = 0; i < m; i++) scale[i] *= unit;
+
+	double worst = 0.0;
+	for (int r = 0; r < rounds; r++) {
+		rand_sign_vector(x, k, &seed);
+
+		// Both sides in O(mn + nk + mk)
+		matvec(B, x, Bx, n, k);
+		matvec(A, Bx, ABx, m, n);
+		matvec(C, x, Cx, m, k);
+
+		// Every row on its own, so one wrong entry is not hidden by
+		// the size of the whole product
+		for (size_t i = 0; i < m; i++) {
+			const double diff = fabs(ABx[i] - Cx[i]);
+			const double residual =
+			    scale[i] > 0.0 ? diff / scale[i]
+					   : (diff > 0.0 ? INFINITY : 0.0);
+			// A NaN stays the worst residual
+			if (isnan(residual) || residual > worst)
+				worst = residual;
+		}
+	}
+
+	const int passed = worst <= eps;
+	fill_report(report, worst, rounds, passed);
+
+	free(x);
+	free(Bx);
+	free(ABx);
+	free(Cx);
+	free(scale);
+
+	return passed;
+}
+
+int freivalds_invert(const double *const A, const double *const inverse_A,
+		     const size_t n, const int rounds, const double eps,
+		     uint64_t seed, struct verify_report *report) {
+	double *x = (double *)malloc(n * sizeof(double));
+	double *y = (double *)malloc(n * sizeof(double));
+	double *Ay = (double *)malloc(n * sizeof(double));
+
+	double worst = 0.0;
+	for (int r = 0; r < rounds; r++) {
+		rand_sign_vector(x, n, &seed);
+
+		// A*(inverse_A*x) should reproduce x
+		matvec(inverse_A, x, y, n, n);
+		matvec(A, y, Ay, n, n);
+
+		for (size_t i = 0; i < n; i++) Ay[i] -= x[i];
+		const double residual = norm2(Ay, n) / sqrt((double)n);
+		if (isnan(residual) || residual > worst) worst = residual;
+	}
+
+	const int passed = worst <= eps;
+	fill_report(report, worst, rounds, passed);
+
+	free(x);
+	free(y);
+	free(Ay);
+
+	return passed;
+}